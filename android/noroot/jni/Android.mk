@@ -10,10 +10,12 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES = \
 		  control/lisp_control.c         \
 		  control/lisp_ctrl_device.c     \
+		  control/lisp_fwd_state.c       \
 		  control/lisp_local_db.c        \
 		  control/lisp_map_cache.c       \
 		  control/lisp_xtr.c             \
 		  control/lisp_ms.c              \
+		  control/lisp_ms_worker.c       \
 		  control/control-data-plane/control-data-plane.c    \
 		  control/control-data-plane/vpnapi/cdp_vpnapi.c     \
 		  data-plane/data-plane.c        \
@@ -48,15 +50,21 @@ LOCAL_SRC_FILES = \
 		  lib/lbuf.c                     \
 		  lib/lisp_site.c                \
 		  lib/lmlog.c                    \
+		  lib/lpm.c                      \
 		  lib/mapping_db.c               \
 		  lib/map_cache_entry.c          \
 		  lib/map_local_entry.c			 \
+		  lib/obj_pool.c                 \
 		  lib/prefixes.c                 \
+		  lib/rate_limit.c               \
+		  lib/rcu.c                      \
+		  lib/fwd_gen.c                  \
 		  lib/routing_tables_lib.c       \
 		  lib/packets.c                  \
 		  lib/sockets.c                  \
 		  lib/sockets-util.c             \
 		  lib/shash.c                    \
+		  lib/spsc_ring.c                \
 		  lib/timers.c                   \
 		  lib/ttable.c                   \
 		  lib/util.c                     \
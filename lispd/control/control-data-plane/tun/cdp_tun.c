@@ -76,16 +76,24 @@ int
 tun_control_dp_init(lisp_ctrl_t *ctrl, ...)
 {
     int socket;
+    int reuseport;
     tun_ctr_dplane_data_t * data;
 
-    /* Generate receive sockets for control port (4342)*/
+    /* Generate receive sockets for control port (4342). Map-Server threads
+     * open their own sockets in the same port. Other devices don't share it */
+    reuseport = map_server_threads > 0 && ctrl_dev
+            && ctrl_dev_mode(ctrl_dev) == MS_MODE;
     if (default_rloc_afi != AF_INET6) {
-        socket = open_control_input_socket(AF_INET);
+        socket = reuseport ?
+                open_control_reuseport_input_socket(AF_INET) :
+                open_control_input_socket(AF_INET);
         sockmstr_register_read_listener(smaster, tun_control_dp_recv_msg, ctrl,socket);
     }
 
     if (default_rloc_afi != AF_INET) {
-        socket = open_control_input_socket(AF_INET6);
+        socket = reuseport ?
+                open_control_reuseport_input_socket(AF_INET6) :
+                open_control_input_socket(AF_INET6);
         sockmstr_register_read_listener(smaster, tun_control_dp_recv_msg, ctrl,socket);
     }
 
@@ -243,6 +243,32 @@ ctrl_get_forwarding_info(packet_tuple_t *tuple)
     return (ctrl_dev_get_fwd_entry(dev, tuple));
 }
 
+/* Called by the data plane for a packet whose forwarding info is temporal,
+ * with no route to the destination until the Map-Reply arrives. Takes
+ * ownership of 'b', allocated with lbuf_clone_packet, if it returns GOOD */
+int
+ctrl_queue_pending_packet(packet_tuple_t *tuple, lbuf_t *b)
+{
+    lisp_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    return (ctrl_dev_queue_packet(dev, tuple, b));
+}
+
+/* Hand the queued packets <lbuf_t *> of a resolved destination back to the
+ * data plane. They are not released */
+void
+ctrl_send_pending_packets(glist_t *pkts)
+{
+    glist_entry_t *it;
+
+    if (!data_plane->datap_output_queued) {
+        return;
+    }
+    glist_for_each_entry(it, pkts) {
+        data_plane->datap_output_queued((lbuf_t *)glist_entry_data(it));
+    }
+}
+
 int
 ctrl_register_device(lisp_ctrl_t *ctrl, lisp_ctrl_dev_t *dev)
 {
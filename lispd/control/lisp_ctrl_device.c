@@ -109,6 +109,15 @@ ctrl_dev_get_fwd_entry(lisp_ctrl_dev_t *dev, packet_tuple_t *tuple)
     return(dev->ctrl_class->get_fwd_entry(dev, tuple));
 }
 
+int
+ctrl_dev_queue_packet(lisp_ctrl_dev_t *dev, packet_tuple_t *tuple, lbuf_t *b)
+{
+    if (!dev->ctrl_class->queue_packet) {
+        return(BAD);
+    }
+    return(dev->ctrl_class->queue_packet(dev, tuple, b));
+}
+
 inline lisp_dev_type_e
 ctrl_dev_mode(lisp_ctrl_dev_t *dev)
 {
@@ -44,6 +44,8 @@ typedef struct ctrl_dev_class_t {
     int (*if_event)(lisp_ctrl_dev_t *, char *, lisp_addr_t *, lisp_addr_t *, uint8_t );
 
     fwd_info_t *(*get_fwd_entry)(lisp_ctrl_dev_t *, packet_tuple_t *);
+    /* keep a packet until its destination is resolved */
+    int (*queue_packet)(lisp_ctrl_dev_t *, packet_tuple_t *, lbuf_t *);
 } ctrl_dev_class_t;
 
 
@@ -71,6 +73,7 @@ inline lisp_dev_type_e ctrl_dev_mode(lisp_ctrl_dev_t *dev);
 inline lisp_ctrl_t * ctrl_dev_ctrl(lisp_ctrl_dev_t *dev);
 int ctrl_dev_set_ctrl(lisp_ctrl_dev_t *, lisp_ctrl_t *);
 fwd_info_t *ctrl_dev_get_fwd_entry(lisp_ctrl_dev_t *, packet_tuple_t *);
+int ctrl_dev_queue_packet(lisp_ctrl_dev_t *, packet_tuple_t *, lbuf_t *);
 
 
 /* PRIVATE functions, used by xtr and ms */
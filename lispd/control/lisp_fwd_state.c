@@ -0,0 +1,417 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <sys/eventfd.h>
+
+#include "lisp_fwd_state.h"
+#include "../iface_list.h"
+#include "../lispd_external.h"
+#include "../lib/lmlog.h"
+#include "../lib/rcu.h"
+#include "../lib/sockets.h"
+#include "../lib/util.h"
+
+static fwd_state_t *fwd_state_cur = NULL;
+static fwd_state_build_fct fwd_state_build = NULL;
+static void *fwd_state_build_arg = NULL;
+/* eventfd used to rebuild the snapshot once per event loop iteration */
+static sock_t *fwd_state_sock = NULL;
+static uint8_t fwd_state_pending = FALSE;
+
+
+fwd_state_t *
+fwd_state_new(fwd_policy_class *fwd_policy, void *fwd_policy_dev_parm)
+{
+    fwd_state_t *fs;
+
+    fs = xzalloc(sizeof(fwd_state_t));
+    fs->fwd_policy = fwd_policy;
+    fs->fwd_policy_dev_parm = fwd_policy_dev_parm;
+    fs->epoch = fwd_epoch_get();
+    fs->local_db = mdb_new();
+    fs->map_cache = mdb_new();
+
+    return (fs);
+}
+
+static fwd_state_local_t *
+fwd_state_local_new(fwd_state_t *fs, map_local_entry_t *mle)
+{
+    fwd_state_local_t *loc;
+
+    loc = xzalloc(sizeof(fwd_state_local_t));
+    loc->fwd_inf = fs->fwd_policy->export_map_inf(fs->fwd_policy_dev_parm,
+            map_local_entry_fwd_info(mle));
+    loc->gen = map_local_entry_gen(mle);
+    loc->gen_val = fwd_gen_get(loc->gen);
+
+    return (loc);
+}
+
+static void
+fwd_state_local_del(fwd_state_t *fs, fwd_state_local_t *loc)
+{
+    fs->fwd_policy->del_exported_map_inf(loc->fwd_inf);
+    free(loc);
+}
+
+void
+fwd_state_del(fwd_state_t *fs)
+{
+    fwd_state_mce_t *mce;
+    void *it;
+    int i;
+
+    if (!fs) {
+        return;
+    }
+
+    mdb_foreach_entry(fs->local_db, it) {
+        fwd_state_local_del(fs, (fwd_state_local_t *)it);
+    } mdb_foreach_entry_end;
+    mdb_del(fs->local_db, NULL);
+
+    mdb_foreach_entry(fs->map_cache, it) {
+        mce = (fwd_state_mce_t *)it;
+        if (mce->fwd_inf) {
+            fs->fwd_policy->del_exported_map_inf(mce->fwd_inf);
+        }
+        free(mce);
+    } mdb_foreach_entry_end;
+    mdb_del(fs->map_cache, NULL);
+
+    if (fs->all_locs) {
+        fwd_state_local_del(fs, fs->all_locs);
+    }
+    if (fs->petrs_inf) {
+        fs->fwd_policy->del_exported_map_inf(fs->petrs_inf);
+    }
+
+    for (i = 0; i < fs->n_rlocs; i++) {
+        lisp_addr_del(fs->rlocs[i].addr);
+    }
+    free(fs->rlocs);
+    free(fs);
+}
+
+int
+fwd_state_add_local_entry(fwd_state_t *fs, map_local_entry_t *mle)
+{
+    fwd_state_local_t *loc;
+
+    if (!map_local_entry_fwd_info(mle)) {
+        return (BAD);
+    }
+
+    loc = fwd_state_local_new(fs, mle);
+    if (mdb_add_entry(fs->local_db, map_local_entry_eid(mle), loc) != GOOD) {
+        fwd_state_local_del(fs, loc);
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
+void
+fwd_state_set_all_locs(fwd_state_t *fs, map_local_entry_t *mle)
+{
+    if (!mle || !map_local_entry_fwd_info(mle)) {
+        return;
+    }
+    fs->all_locs = fwd_state_local_new(fs, mle);
+}
+
+int
+fwd_state_add_mcache_entry(fwd_state_t *fs, mcache_entry_t *mce)
+{
+    fwd_state_mce_t *fs_mce;
+    mapping_t *map = mcache_entry_mapping(mce);
+
+    fs_mce = xzalloc(sizeof(fwd_state_mce_t));
+    fs_mce->active = mcache_entry_active(mce);
+    fs_mce->gen = mcache_entry_gen(mce);
+    fs_mce->gen_val = fwd_gen_get(fs_mce->gen);
+    if (mapping_locator_count(map) != 0 && mcache_entry_routing_info(mce)) {
+        fs_mce->fwd_inf = fs->fwd_policy->export_map_inf(
+                fs->fwd_policy_dev_parm, mcache_entry_routing_info(mce));
+    }
+
+    if (mdb_add_entry(fs->map_cache, mapping_eid(map), fs_mce) != GOOD) {
+        if (fs_mce->fwd_inf) {
+            fs->fwd_policy->del_exported_map_inf(fs_mce->fwd_inf);
+        }
+        free(fs_mce);
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
+void
+fwd_state_set_petrs(fwd_state_t *fs, mcache_entry_t *petrs)
+{
+    if (!petrs || mcache_has_locators(petrs) == FALSE) {
+        return;
+    }
+    fs->petrs_inf = fs->fwd_policy->export_map_inf(fs->fwd_policy_dev_parm,
+            mcache_entry_routing_info(petrs));
+}
+
+/* Resolve the output socket of each local RLOC. The interfaces list is
+ * owned by the control thread */
+void
+fwd_state_add_rlocs(fwd_state_t *fs, glist_t *rlocs)
+{
+    glist_entry_t *it;
+    lisp_addr_t *addr;
+    int i = 0;
+
+    if (glist_size(rlocs) == 0) {
+        return;
+    }
+
+    fs->rlocs = xzalloc(glist_size(rlocs) * sizeof(fwd_state_rloc_t));
+    glist_for_each_entry(it, rlocs) {
+        addr = (lisp_addr_t *)glist_entry_data(it);
+        fs->rlocs[i].addr = lisp_addr_clone(addr);
+        fs->rlocs[i].out_sock = get_out_socket_ptr_from_address(addr);
+        i++;
+    }
+    fs->n_rlocs = i;
+}
+
+/* Resolve the output sockets of the default interfaces, used for the packets
+ * forwarded natively */
+void
+fwd_state_set_default_socks(fwd_state_t *fs)
+{
+    iface_t *iface;
+
+    iface = get_any_output_iface(AF_INET);
+    if (iface) {
+        fs->default_sock_v4 = &iface->out_socket_v4;
+    }
+    iface = get_any_output_iface(AF_INET6);
+    if (iface) {
+        fs->default_sock_v6 = &iface->out_socket_v6;
+    }
+}
+
+int
+fwd_state_default_socket(fwd_state_t *fs, int afi)
+{
+    switch (afi) {
+    case AF_INET:
+        return (fs->default_sock_v4 ? *fs->default_sock_v4 : ERR_SOCKET);
+    case AF_INET6:
+        return (fs->default_sock_v6 ? *fs->default_sock_v6 : ERR_SOCKET);
+    default:
+        return (ERR_SOCKET);
+    }
+}
+
+/* Fill 'fwd_info' with the forwarding info of the flow of 'tuple'. Follows
+ * the same steps as the control device but only reads 'fs', so it may be
+ * called from any thread. Returns BAD if there is no map-cache entry for the
+ * destination and thus the control thread has to handle the miss */
+int
+fwd_state_get_fwd_info(fwd_state_t *fs, packet_tuple_t *tuple,
+        fwd_info_t *fwd_info)
+{
+    fwd_state_local_t *loc;
+    fwd_state_mce_t *mce;
+    fwd_entry_t *fe;
+    void *src_inf, *dst_inf;
+    int i;
+
+    /* Generations of the snapshot, which may be older than the current ones */
+    fwd_info->epoch = fs->epoch;
+
+    if (fs->all_locs) {
+        loc = fs->all_locs;
+    } else {
+        loc = mdb_lookup_entry(fs->local_db, &tuple->src_addr);
+        if (!loc) {
+            /* Not a local EID */
+            return (GOOD);
+        }
+    }
+    src_inf = loc->fwd_inf;
+    fwd_info_add_gen(fwd_info, loc->gen, loc->gen_val);
+
+    mce = mdb_lookup_entry(fs->map_cache, &tuple->dst_addr);
+    if (!mce) {
+        return (BAD);
+    }
+    fwd_info_add_gen(fwd_info, mce->gen, mce->gen_val);
+
+    if (mce->active == NOT_ACTIVE) {
+        /* Waiting for the Map-Reply */
+        fwd_info->temporal = TRUE;
+        dst_inf = fs->petrs_inf;
+    } else if (!mce->fwd_inf) {
+        /* Negative mapping */
+        dst_inf = fs->petrs_inf;
+    } else {
+        dst_inf = mce->fwd_inf;
+    }
+    if (!dst_inf) {
+        return (GOOD);
+    }
+
+    fs->fwd_policy->exported_get_fwd_info(src_inf, dst_inf, tuple, fwd_info);
+    if (!fwd_info->fwd_info && dst_inf != fs->petrs_inf && fs->petrs_inf) {
+        fs->fwd_policy->exported_get_fwd_info(src_inf, fs->petrs_inf, tuple,
+                fwd_info);
+    }
+
+    fe = (fwd_entry_t *)fwd_info->fwd_info;
+    if (!fe) {
+        return (GOOD);
+    }
+    for (i = 0; i < fs->n_rlocs; i++) {
+        if (lisp_addr_cmp(fe->srloc, fs->rlocs[i].addr) == 0) {
+            fe->out_sock = fs->rlocs[i].out_sock;
+            break;
+        }
+    }
+
+    return (GOOD);
+}
+
+/*
+ * Publication
+ */
+
+static void
+fwd_state_publish()
+{
+    fwd_state_t *old_fs, *new_fs;
+
+    if (!fwd_state_build) {
+        return;
+    }
+
+    new_fs = fwd_state_build(fwd_state_build_arg);
+    if (!new_fs) {
+        LMLOG(LDBG_1, "fwd_state_publish: Couldn't build the forwarding state");
+        return;
+    }
+
+    old_fs = fwd_state_cur;
+    rcu_assign_pointer(fwd_state_cur, new_fs);
+    if (old_fs) {
+        rcu_defer(old_fs, (rcu_del_fct)fwd_state_del);
+    }
+
+    LMLOG(LDBG_2, "Forwarding state published: %d local mappings, %d map "
+            "cache entries", mdb_n_entries(new_fs->local_db),
+            mdb_n_entries(new_fs->map_cache));
+}
+
+static int
+fwd_state_changed_cb(sock_t *sl)
+{
+    uint64_t count;
+
+    if (read(sl->fd, &count, sizeof(count)) != sizeof(count)
+            && errno != EAGAIN) {
+        LMLOG(LDBG_2, "fwd_state_changed_cb: read error: %s", strerror(errno));
+    }
+    fwd_state_pending = FALSE;
+    fwd_state_publish();
+
+    return (GOOD);
+}
+
+void
+fwd_state_set_builder(fwd_state_build_fct build_fct, void *arg)
+{
+    fwd_state_build = build_fct;
+    fwd_state_build_arg = arg;
+    fwd_state_changed();
+}
+
+int
+fwd_state_enable()
+{
+    int fd;
+
+    if (fwd_state_sock) {
+        return (GOOD);
+    }
+
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        LMLOG(LCRIT, "fwd_state_enable: eventfd: %s", strerror(errno));
+        return (BAD);
+    }
+    fwd_state_sock = sockmstr_register_read_listener(smaster,
+            fwd_state_changed_cb, NULL, fd);
+    if (!fwd_state_sock) {
+        close(fd);
+        return (BAD);
+    }
+    fwd_state_changed();
+
+    return (GOOD);
+}
+
+/* Readers must have been stopped */
+void
+fwd_state_disable()
+{
+    if (!fwd_state_sock) {
+        return;
+    }
+
+    sockmstr_unregister_read_listenedr(smaster, fwd_state_sock);
+    fwd_state_sock = NULL;
+    fwd_state_pending = FALSE;
+
+    rcu_reclaim_all();
+    fwd_state_del(fwd_state_cur);
+    fwd_state_cur = NULL;
+}
+
+/* Called by the control device each time its forwarding state changes. All
+ * the changes of an event loop iteration end up in a single snapshot */
+void
+fwd_state_changed()
+{
+    uint64_t one = 1;
+
+    if (!fwd_state_sock || !fwd_state_build || fwd_state_pending) {
+        return;
+    }
+
+    if (write(fwd_state_sock->fd, &one, sizeof(one)) != sizeof(one)) {
+        LMLOG(LDBG_2, "fwd_state_changed: write error: %s", strerror(errno));
+        return;
+    }
+    fwd_state_pending = TRUE;
+}
+
+/* Called from the data plane threads while online */
+fwd_state_t *
+fwd_state_current()
+{
+    return (rcu_dereference(fwd_state_cur));
+}
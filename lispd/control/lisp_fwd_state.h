@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LISP_FWD_STATE_H_
+#define LISP_FWD_STATE_H_
+
+#include "../fwd_policies/fwd_policy.h"
+#include "../lib/map_cache_entry.h"
+#include "../lib/map_local_entry.h"
+#include "../lib/mapping_db.h"
+#include "../liblisp/liblisp.h"
+
+/*
+ * Read-only snapshot of the forwarding state of the control device. It is
+ * rebuilt by the control thread whenever the map-cache, the local mappings
+ * or the state of the locators change, and published with RCU semantics so
+ * data plane threads can forward without locking and without asking the
+ * control thread, except to resolve map-cache misses.
+ */
+
+typedef struct fwd_state_local_ {
+    void *fwd_inf;
+    fwd_gen_t *gen;
+    uint32_t gen_val;
+} fwd_state_local_t;
+
+typedef struct fwd_state_mce_ {
+    uint8_t active;
+    /* NULL for negative mappings */
+    void *fwd_inf;
+    fwd_gen_t *gen;
+    uint32_t gen_val;
+} fwd_state_mce_t;
+
+typedef struct fwd_state_rloc_ {
+    lisp_addr_t *addr;
+    int *out_sock;
+} fwd_state_rloc_t;
+
+typedef struct fwd_state_ {
+    fwd_policy_class *fwd_policy;
+    void *fwd_policy_dev_parm;
+    /* Forwarding epoch when the snapshot was built */
+    uint32_t epoch;
+
+    mdb_t *local_db;            /* <fwd_state_local_t *> */
+    /* When set, used for any source EID (RTR) */
+    fwd_state_local_t *all_locs;
+    mdb_t *map_cache;           /* <fwd_state_mce_t *> */
+    void *petrs_inf;
+
+    fwd_state_rloc_t *rlocs;
+    int n_rlocs;
+    /* Output sockets of the default interfaces, to forward natively. NULL
+     * if there is none */
+    int *default_sock_v4;
+    int *default_sock_v6;
+} fwd_state_t;
+
+typedef fwd_state_t *(*fwd_state_build_fct)(void *);
+
+fwd_state_t *fwd_state_new(fwd_policy_class *fwd_policy,
+        void *fwd_policy_dev_parm);
+void fwd_state_del(fwd_state_t *fs);
+int fwd_state_add_local_entry(fwd_state_t *fs, map_local_entry_t *mle);
+void fwd_state_set_all_locs(fwd_state_t *fs, map_local_entry_t *mle);
+int fwd_state_add_mcache_entry(fwd_state_t *fs, mcache_entry_t *mce);
+void fwd_state_set_petrs(fwd_state_t *fs, mcache_entry_t *petrs);
+void fwd_state_add_rlocs(fwd_state_t *fs, glist_t *rlocs);
+void fwd_state_set_default_socks(fwd_state_t *fs);
+int fwd_state_get_fwd_info(fwd_state_t *fs, packet_tuple_t *tuple,
+        fwd_info_t *fwd_info);
+int fwd_state_default_socket(fwd_state_t *fs, int afi);
+
+/* Publication. Only the data planes with worker threads enable it */
+void fwd_state_set_builder(fwd_state_build_fct build_fct, void *arg);
+int fwd_state_enable();
+void fwd_state_disable();
+void fwd_state_changed();
+fwd_state_t *fwd_state_current();
+
+#endif /* LISP_FWD_STATE_H_ */
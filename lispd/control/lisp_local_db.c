@@ -20,6 +20,7 @@
 
 #include "lisp_local_db.h"
 #include "../lispd_external.h"
+#include "../lib/fwd_gen.h"
 #include "../lib/lmlog.h"
 
 
@@ -57,6 +58,7 @@ local_map_db_add_entry(local_map_db_t *lmdb, map_local_entry_t *map_loc_e)
                 lisp_addr_to_char(map_local_entry_eid(map_loc_e)));
         return(BAD);
     }
+    fwd_epoch_bump();
     return(GOOD);
 }
 
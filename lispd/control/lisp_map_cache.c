@@ -18,9 +18,14 @@
  */
 
 #include "lisp_map_cache.h"
+#include "../lib/fwd_gen.h"
 #include "../lib/lmlog.h"
+#include "../elibs/ovs/ovs_util.h"
 #include <math.h>
 
+/* Entries given a second chance before evicting the head anyway */
+#define MCACHE_LRU_MAX_SCAN     8
+
 
 map_cache_db_t*
 mcache_new()
@@ -36,6 +41,8 @@ mcache_new()
         LMLOG(LCRIT, "Could create map cache db ");
         return(NULL);
     }
+    list_init(&mcdb->lru);
+    mcdb->miss_gen = fwd_gen_new();
 
     return(mcdb);
 }
@@ -44,6 +51,7 @@ void
 mcache_del(map_cache_db_t *mcdb)
 {
     mdb_del(mcdb->db, (mdb_del_fct)mcache_entry_del);
+    fwd_gen_del(mcdb->miss_gen);
     free(mcdb);
 }
 
@@ -51,13 +59,104 @@ mcache_del(map_cache_db_t *mcdb)
 int
 mcache_add_entry(map_cache_db_t *mcdb, lisp_addr_t *key, mcache_entry_t *mce)
 {
-    return(mdb_add_entry(mcdb->db, key, mce));
+    mcache_entry_t *cover;
+
+    if (mdb_add_entry(mcdb->db, key, mce) != GOOD) {
+        return(BAD);
+    }
+    if (mce->how_learned != MCE_STATIC) {
+        /* New entries are not marked used: a placeholder of a Map-Request
+         * nobody forwards with is evicted before the entries in use */
+        mce->mem = mcache_entry_mem(mce);
+        list_push_back(&mcdb->lru, &mce->lru);
+        mcdb->n_entries++;
+        mcdb->mem += mce->mem;
+    }
+    /* Only the flows forwarded with the entry covering the new one, or
+     * without entry, may have to use it */
+    if (lisp_addr_lafi(key) != LM_AFI_IPPREF) {
+        fwd_epoch_bump();
+    } else if ((cover = mdb_lookup_entry_covering(mcdb->db, key)) != NULL) {
+        fwd_gen_bump(mcache_entry_gen(cover));
+    } else {
+        fwd_gen_bump(mcdb->miss_gen);
+    }
+    return(GOOD);
 }
 
 void *
 mcache_remove_entry(map_cache_db_t *mcdb, lisp_addr_t *key)
 {
-    return(mdb_remove_entry(mcdb->db, key));
+    mcache_entry_t *mce;
+
+    mce = mdb_remove_entry(mcdb->db, key);
+    if (mce && mce->how_learned != MCE_STATIC) {
+        list_remove(&mce->lru);
+        mcdb->n_entries--;
+        mcdb->mem -= mce->mem;
+    }
+    return(mce);
+}
+
+void
+mcache_set_limits(map_cache_db_t *mcdb, int max_entries, size_t max_mem)
+{
+    mcdb->max_entries = max_entries;
+    mcdb->max_mem = max_mem;
+}
+
+/* Account again the memory of 'mce' after its mapping changed */
+void
+mcache_update_entry_mem(map_cache_db_t *mcdb, mcache_entry_t *mce)
+{
+    if (mce->how_learned == MCE_STATIC) {
+        return;
+    }
+    mcdb->mem -= mce->mem;
+    mce->mem = mcache_entry_mem(mce);
+    mcdb->mem += mce->mem;
+}
+
+/* Returns the entry to evict while the map cache is beyond its limits, or
+ * NULL. 'keep', usually the entry just added, is never returned. The caller
+ * has to remove the entry */
+mcache_entry_t *
+mcache_lru_victim(map_cache_db_t *mcdb, mcache_entry_t *keep)
+{
+    mcache_entry_t *mce;
+    int over_entries, over_mem, scan;
+
+    over_entries = mcdb->max_entries && mcdb->n_entries > mcdb->max_entries;
+    over_mem = mcdb->max_mem && mcdb->mem > mcdb->max_mem;
+    if (!over_entries && !over_mem) {
+        return(NULL);
+    }
+    if (list_is_empty(&mcdb->lru) || list_is_singleton(&mcdb->lru)) {
+        return(NULL);
+    }
+
+    for (scan = 0; ; scan++) {
+        mce = CONTAINER_OF(list_front(&mcdb->lru), mcache_entry_t, lru);
+        if (mce == keep) {
+            list_remove(&mce->lru);
+            list_push_back(&mcdb->lru, &mce->lru);
+            continue;
+        }
+        if (scan < MCACHE_LRU_MAX_SCAN && fwd_gen_test_and_clear_used(
+                mcache_entry_gen(mce), FWD_GEN_USED_LRU)) {
+            list_remove(&mce->lru);
+            list_push_back(&mcdb->lru, &mce->lru);
+            continue;
+        }
+        break;
+    }
+
+    if (over_entries) {
+        mcdb->evicted_entries++;
+    } else {
+        mcdb->evicted_mem++;
+    }
+    return(mce);
 }
 
 
@@ -95,6 +194,21 @@ void mcache_dump_db(map_cache_db_t *mcdb, int log_level)
         mce = (mcache_entry_t *)it;
         map_cache_entry_dump(mce, log_level);
     } mdb_foreach_entry_end;
+    mcache_stats_dump(mcdb, log_level);
     LMLOG(log_level,"*******************************************************\n");
 
 }
+
+void
+mcache_stats_dump(map_cache_db_t *mcdb, int log_level)
+{
+    if (is_loggable(log_level) == FALSE) {
+        return;
+    }
+
+    LMLOG(log_level, "Map cache: %d dynamic entries (max %d), %zu KB (max %zu). "
+            "Evicted %"PRIu64" entries over the entries limit and %"PRIu64
+            " over the memory limit", mcdb->n_entries, mcdb->max_entries,
+            mcdb->mem / 1024, mcdb->max_mem / 1024, mcdb->evicted_entries,
+            mcdb->evicted_mem);
+}
@@ -25,8 +25,27 @@
 #include "../lib/mapping_db.h"
 #include "../liblisp/liblisp.h"
 
+/*
+ * Dynamic entries are kept in insertion order to evict them when the map
+ * cache grows beyond its limits. An entry used by the data plane since it
+ * was last at the head gets a second chance and goes back to the tail, so
+ * the order approximates LRU. Entries not used since they were added are
+ * evicted first. Static entries are never evicted.
+ */
 typedef struct map_cache_db {
     mdb_t *db;
+    /* Generation of the lookups without entry, forwarded to the PeTRs */
+    fwd_gen_t *miss_gen;
+
+    struct ovs_list lru;
+    int n_entries;
+    size_t mem;
+    /* Limits of the dynamic entries. 0 means no limit */
+    int max_entries;
+    size_t max_mem;
+    /* Entries evicted because of each limit */
+    uint64_t evicted_entries;
+    uint64_t evicted_mem;
 } map_cache_db_t;
 
 map_cache_db_t *mcache_new();
@@ -38,8 +57,13 @@ void *mcache_remove_entry(map_cache_db_t *, lisp_addr_t *key);
 void map_cache_del_entry(map_cache_db_t *, lisp_addr_t *laddr);
 mcache_entry_t *mcache_lookup_exact(map_cache_db_t *, lisp_addr_t *addr);
 mcache_entry_t *mcache_lookup(map_cache_db_t *, lisp_addr_t *addr);
+static inline fwd_gen_t *mcache_miss_gen(map_cache_db_t *);
+void mcache_set_limits(map_cache_db_t *, int max_entries, size_t max_mem);
+void mcache_update_entry_mem(map_cache_db_t *, mcache_entry_t *entry);
+mcache_entry_t *mcache_lru_victim(map_cache_db_t *, mcache_entry_t *keep);
 
 void mcache_dump_db(map_cache_db_t *, int log_level);
+void mcache_stats_dump(map_cache_db_t *, int log_level);
 
 #define mcache_foreach_entry(MC, EIT)               \
     mdb_foreach_entry((MC)->db, (EIT)) {
@@ -64,4 +88,10 @@ void mcache_dump_db(map_cache_db_t *, int log_level);
     mdb_foreach_entry_in_ip_eid_db_end
 
 
+static inline fwd_gen_t *
+mcache_miss_gen(map_cache_db_t *mcdb)
+{
+    return (mcdb->miss_gen);
+}
+
 #endif /*LISPD_MAP_CACAHE_DB_H_*/
@@ -18,6 +18,7 @@
  */
 
 #include "lisp_ms.h"
+#include "lisp_ms_worker.h"
 #include "../defs.h"
 #include "../lib/cksum.h"
 #include "../lib/lmlog.h"
@@ -25,9 +26,8 @@
 #include "../lib/prefixes.h"
 
 
-static int ms_recv_map_request(lisp_ms_t *, lbuf_t *, uconn_t *);
-static int ms_recv_map_register(lisp_ms_t *, lbuf_t *, uconn_t *);
 static int ms_recv_msg(lisp_ctrl_dev_t *, lbuf_t *, uconn_t *);
+static void rsite_unset_rec(lisp_ms_t *, lisp_reg_site_t *);
 static inline lisp_ms_t *lisp_ms_cast(lisp_ctrl_dev_t *dev);
 
 
@@ -89,12 +89,13 @@ get_etr_from_lcaf(lisp_addr_t *laddr, lisp_addr_t **dst)
 
 /* forward encapsulated Map-Request to ETR */
 static int
-forward_mreq(lisp_ms_t *ms, lbuf_t *b, mapping_t *m)
+forward_mreq(lisp_ms_t *ms, lbuf_t *b, mapping_t *m, glist_t *fwd_rlocs)
 {
 	lisp_ctrl_t *ctrl = NULL;
     lisp_addr_t *drloc = NULL;
     locator_t *loct = NULL;
     uconn_t fwd_uc;
+    int ret;
 
     ctrl = ctrl_dev_ctrl(&(ms->super));
 
@@ -116,14 +117,26 @@ forward_mreq(lisp_ms_t *ms, lbuf_t *b, mapping_t *m)
         get_etr_from_lcaf(drloc, &drloc);
     }
 
+    /* The whole request is forwarded, once per ETR is enough */
+    if (glist_contain(drloc, fwd_rlocs)) {
+        LMLOG(LDBG_3, "Encap Map-Request already forwarded to xTR %s",
+                lisp_addr_to_char(drloc));
+        return(GOOD);
+    }
+    glist_add(lisp_addr_clone(drloc), fwd_rlocs);
+
     LMLOG(LDBG_3, "Found xTR with locator %s to forward Encap Map-Request",
             lisp_addr_to_char(drloc));
 
-    /* Set buffer to forward the encapsulated message*/
+    /* Forward the received buffer, pointing to the ECM header, instead of
+     * copying it. The reference keeps it alive while it is sent */
     lbuf_point_to_lisp_hdr(b);
+    lbuf_ref(b);
 
     uconn_init(&fwd_uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, drloc);
-    return(send_msg(&ms->super, b, &fwd_uc));
+    ret = send_msg(&ms->super, b, &fwd_uc);
+    lbuf_del(b);
+    return(ret);
 }
 
 
@@ -140,8 +153,11 @@ lsite_entry_expiration_timer_cb(lmtimer_t *t)
     LMLOG(LDBG_1,"Registration of site with EID %s timed out",
             lisp_addr_to_char(addr));
 
+    rsite_unset_rec(ms, rsite);
+    pthread_rwlock_wrlock(&ms->reg_sites_lock);
     mdb_remove_entry(ms->reg_sites_db, addr);
     lisp_reg_site_del(rsite);
+    pthread_rwlock_unlock(&ms->reg_sites_lock);
     ms_dump_registered_sites(ms, LDBG_3);
     return(GOOD);
 }
@@ -156,6 +172,7 @@ lsite_entry_start_expiration_timer(lisp_ms_t *ms, lisp_reg_site_t *rsite)
     lmtimer_init(timer, ms, lsite_entry_expiration_timer_cb, rsite,
             NULL, NULL);
     htable_ptrs_timers_add(ptrs_to_timers_ht,rsite, timer);
+    rsite->expiry_timer = timer;
 
     /* Give a 2s margin before purging the registered site */
     lmtimer_start(timer, MS_SITE_EXPIRATION + 2);
@@ -168,46 +185,171 @@ lsite_entry_start_expiration_timer(lisp_ms_t *ms, lisp_reg_site_t *rsite)
 static void
 lsite_entry_update_expiration_timer(lisp_ms_t *ms, lisp_reg_site_t *rsite)
 {
-    lmtimer_t *timer;
-    glist_t *timer_lst;
-
-    timer_lst = htable_ptrs_timers_get_timers_of_type(ptrs_to_timers_ht,rsite,
-            REG_SITE_EXPRY_TIMER);
-
-    if (glist_size(timer_lst) != 1){
-        LMLOG(LDBG_1,"lsite_entry_start_expiration_timer: %d timers for same site."
-                "It should never happen", glist_size(timer_lst));
-        glist_destroy(timer_lst);
+    /* Static sites don't expire */
+    if (!rsite->expiry_timer) {
         return;
     }
-    timer = (lmtimer_t *)glist_first_data(timer_lst);
-    glist_destroy(timer_lst);
 
     /* Give a 2s margin before purging the registered site */
-    lmtimer_start(timer, MS_SITE_EXPIRATION + 2);
+    lmtimer_start(rsite->expiry_timer, MS_SITE_EXPIRATION + 2);
 
     LMLOG(LDBG_2,"The map cache entry of EID %s will expire in %ld seconds.",
             lisp_addr_to_char(mapping_eid(rsite->site_map)),
             MS_SITE_EXPIRATION);
 }
 
-static int
+static lisp_reg_site_t *
+rsite_lookup_rec(lisp_ms_t *ms, uint8_t *rec, int eid_len)
+{
+    lisp_reg_site_t key;
+    khiter_t k;
+
+    key.rec = rec;
+    key.eid_len = eid_len;
+    k = kh_get(rsites, ms->reg_sites_recs, &key);
+    if (k == kh_end(ms->reg_sites_recs)) {
+        return(NULL);
+    }
+    return(kh_key(ms->reg_sites_recs, k));
+}
+
+static void
+rsite_unset_rec(lisp_ms_t *ms, lisp_reg_site_t *rsite)
+{
+    khiter_t k;
+
+    if (!rsite->rec) {
+        return;
+    }
+    k = kh_get(rsites, ms->reg_sites_recs, rsite);
+    if (k != kh_end(ms->reg_sites_recs)
+            && kh_key(ms->reg_sites_recs, k) == rsite) {
+        kh_del(rsites, ms->reg_sites_recs, k);
+    }
+    free(rsite->rec);
+    rsite->rec = NULL;
+}
+
+/* Keeps 'rec', the record just registered for 'rsite', to recognize its
+ * refreshes */
+static void
+rsite_set_rec(lisp_ms_t *ms, lisp_reg_site_t *rsite, uint8_t *rec,
+        int rec_len, int eid_len)
+{
+    khiter_t k;
+    int ret;
+
+    rsite_unset_rec(ms, rsite);
+    rsite->rec = xmalloc(rec_len);
+    memcpy(rsite->rec, rec, rec_len);
+    rsite->rec_len = rec_len;
+    rsite->eid_len = eid_len;
+
+    k = kh_put(rsites, ms->reg_sites_recs, rsite, &ret);
+    kh_key(ms->reg_sites_recs, k) = rsite;
+}
+
+/* Serializes the record that proxy Map-Replies of 'rsite' carry. Called
+ * whenever its mapping changes, holding the write lock if already in the
+ * registered sites db */
+static void
+rsite_set_mrep_rec(lisp_reg_site_t *rsite)
+{
+    mapping_record_hdr_t *rec;
+    lbuf_t *b;
+
+    free(rsite->mrep_rec);
+    rsite->mrep_rec = NULL;
+    rsite->mrep_rec_len = 0;
+
+    b = lisp_msg_create(LISP_MAP_REPLY);
+    rec = lisp_msg_put_mapping(b, rsite->site_map, NULL);
+    if (rec) {
+        /* Set the authoritative bit of the record to false*/
+        MAP_REC_AUTH(rec) = A_NO_AUTHORITATIVE;
+        rsite->mrep_rec_len = (uint8_t *)lbuf_tail(b) - (uint8_t *)rec;
+        rsite->mrep_rec = xmalloc(rsite->mrep_rec_len);
+        memcpy(rsite->mrep_rec, rec, rsite->mrep_rec_len);
+    }
+    lisp_msg_destroy(b);
+}
+
+/* Hash of the source of the Map-Request in 'buf' to limit its rate */
+static uint32_t
+ms_req_source_hash(lbuf_t *buf, uconn_t *uc)
+{
+    struct ip *iph = lbuf_l3(buf);
+    ip_addr_t *src;
+
+    /* Encapsulated requests are counted by their inner source, the ITR,
+     * instead of by the Map-Resolver that forwarded them */
+    if (iph) {
+        if (iph->ip_v == IPVERSION) {
+            return(pkt_data_hash(&iph->ip_src, sizeof(struct in_addr), 0));
+        }
+        return(pkt_data_hash(&((struct ip6_hdr *)iph)->ip6_src,
+                sizeof(struct in6_addr), 0));
+    }
+    src = lisp_addr_ip(&uc->ra);
+    return(pkt_data_hash(ip_addr_get_addr(src), ip_addr_get_size(src), 0));
+}
+
+/* Returns the shortest prefix containing 'eid' that doesn't overlap any
+ * configured or registered site, so the negative Map-Reply for 'eid' can be
+ * cached for the whole unused space around it */
+static lisp_addr_t *
+ms_neg_mrep_prefix(lisp_ms_t *ms, lisp_addr_t *eid)
+{
+    lisp_addr_t *pref, *net_pref;
+    int plen, reg_plen;
+
+    if (!lisp_addr_is_ip_pref(eid)) {
+        return(lisp_addr_clone(eid));
+    }
+
+    plen = mdb_common_plen(ms->lisp_sites_db, eid);
+    reg_plen = mdb_common_plen(ms->reg_sites_db, eid);
+    plen = (plen > reg_plen ? plen : reg_plen) + 1;
+
+    /* A requested prefix that contains sites is not extended */
+    if (plen >= lisp_addr_get_plen(eid)) {
+        return(lisp_addr_clone(eid));
+    }
+
+    pref = lisp_addr_clone(eid);
+    lisp_addr_set_plen(pref, plen);
+    net_pref = pref_get_network_prefix(pref);
+    lisp_addr_del(pref);
+    return(net_pref);
+}
+
+/* Called from the control thread and from the Map-Server threads */
+int
 ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
 {
 
     lisp_addr_t *   seid        = NULL;
     lisp_addr_t *   deid        = NULL;
+    lisp_addr_t *   neg_pref    = NULL;
     mapping_t *     map         = NULL;
     glist_t *       itr_rlocs   = NULL;
+    glist_t *       fwd_rlocs   = NULL;
     void *          mreq_hdr    = NULL;
     void *          mrep_hdr    = NULL;
-    mapping_record_hdr_t *  rec            = NULL;
     int             i           = 0;
     lbuf_t *        mrep        = NULL;
     lbuf_t  b;
     lisp_site_prefix_t *    site            = NULL;
     lisp_reg_site_t *       rsite           = NULL;
 
+    /* Shed excess requests before parsing them */
+    if (ms->req_limit && rate_limit_allow(ms->req_limit,
+            ms_req_source_hash(buf, uc)) != GOOD) {
+        LMLOG(LDBG_3, "Map-Request rate limit of %s exceeded. Discarding!",
+                lisp_addr_to_char(&uc->ra));
+        return(BAD);
+    }
+
     /* local copy of the buf that can be modified */
     b = *buf;
 
@@ -234,13 +376,17 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     /* PROCESS ITR RLOCs */
     itr_rlocs = laddr_list_new();
     lisp_msg_parse_itr_rlocs(&b, itr_rlocs);
+    /* ETRs the request has been forwarded to */
+    fwd_rlocs = laddr_sorted_list_new();
 
+    pthread_rwlock_rdlock(&ms->reg_sites_lock);
     for (i = 0; i < MREQ_REC_COUNT(mreq_hdr); i++) {
 
         deid = lisp_addr_new();
 
         /* PROCESS EID REC */
         if (lisp_msg_parse_eid_rec(&b, deid) != GOOD) {
+            pthread_rwlock_unlock(&ms->reg_sites_lock);
             goto err;
         }
 
@@ -249,15 +395,18 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         rsite = mdb_lookup_entry(ms->reg_sites_db, deid);
         /* Static entries will have null site and not null rsite */
         if (!site && !rsite) {
-            /* send negative map-reply with TTL 15 min */
-            mrep = lisp_msg_neg_mrep_create(deid, 15, ACT_NATIVE_FWD,A_AUTHORITATIVE,
-                    MREQ_NONCE(mreq_hdr));
+            /* send negative map-reply with TTL 15 min, covering the space
+             * without sites around the EID */
+            neg_pref = ms_neg_mrep_prefix(ms, deid);
+            mrep = lisp_msg_neg_mrep_create(neg_pref, MS_NEG_MREP_TTL,
+                    ACT_NATIVE_FWD, A_AUTHORITATIVE, MREQ_NONCE(mreq_hdr));
             LMLOG(LDBG_1,"The requested EID %s doesn't belong to this Map Server",
                     lisp_addr_to_char(deid));
             LMLOG(LDBG_2, "%s, EID: %s, NEGATIVE", lisp_msg_hdr_to_char(mrep),
-                    lisp_addr_to_char(deid));
+                    lisp_addr_to_char(neg_pref));
             send_msg(&ms->super, mrep, uc);
             lisp_msg_destroy(mrep);
+            lisp_addr_del(neg_pref);
             lisp_addr_del(deid);
 
             continue;
@@ -284,7 +433,7 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         /* IF *NOT* PROXY REPLY: forward the message to an xTR */
         if (site != NULL && site->proxy_reply == FALSE) {
             /* FIXME: once locs become one object, send that instead of mapping */
-            forward_mreq(ms, buf, map);
+            forward_mreq(ms, buf, map, fwd_rlocs);
             lisp_msg_destroy(mrep);
             lisp_addr_del(deid);
             continue;
@@ -293,11 +442,16 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         LMLOG(LDBG_1,"The requested EID %s belongs to the registered prefix %s. Send Map Reply",
                 lisp_addr_to_char(deid), lisp_addr_to_char(mapping_eid(map)));
 
-        /* IF PROXY REPLY: build Map-Reply */
+        if (!rsite->mrep_rec) {
+            LMLOG(LDBG_1, "Couldn't build Map-Reply for EID %s",
+                    lisp_addr_to_char(mapping_eid(map)));
+            lisp_addr_del(deid);
+            continue;
+        }
+
+        /* IF PROXY REPLY: build Map-Reply from the prebuilt record */
         mrep = lisp_msg_create(LISP_MAP_REPLY);
-        rec = lisp_msg_put_mapping(mrep, map, NULL);
-        /* Set the authoritative bit of the record to false*/
-        MAP_REC_AUTH(rec) = A_NO_AUTHORITATIVE;
+        lisp_msg_put_raw_mapping(mrep, rsite->mrep_rec, rsite->mrep_rec_len);
 
         mrep_hdr = lisp_msg_hdr(mrep);
         MREP_RLOC_PROBE(mrep_hdr) = 0;
@@ -311,13 +465,16 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         lisp_msg_destroy(mrep);
         lisp_addr_del(deid);
     }
+    pthread_rwlock_unlock(&ms->reg_sites_lock);
 
     glist_destroy(itr_rlocs);
+    glist_destroy(fwd_rlocs);
     lisp_addr_del(seid);
 
     return(GOOD);
 err:
     glist_destroy(itr_rlocs);
+    glist_destroy(fwd_rlocs);
     lisp_msg_destroy(mrep);
     lisp_addr_del(deid);
     lisp_addr_del(seid);
@@ -325,65 +482,85 @@ err:
 
 }
 
-static int
-ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
+/* Called from the control thread. 'auth_pref' is the site whose key already
+ * validated the message, or NULL */
+int
+ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc,
+        lisp_site_prefix_t *auth_pref)
 {
     lisp_reg_site_t *rsite = NULL, *new_rsite = NULL;
     lisp_site_prefix_t *reg_pref = NULL;
-    char *key = NULL;
     lisp_addr_t *eid = NULL;
     lisp_addr_t *eid_pref = NULL;
     lbuf_t b;
     void *hdr = NULL, *mntf_hdr = NULL;
+    uint8_t *rec = NULL;
     int i = 0;
+    int rec_len, eid_len;
     mapping_t *m = NULL;
     locator_t *probed = NULL;
     lbuf_t *mntf = NULL;
-    lisp_key_type_e keyid = HMAC_SHA_1_96; /* TODO configurable */
+    lisp_key_type_e keyid;
     int valid_records = FALSE;
 
 
     b = *buf;
     hdr = lisp_msg_pull_hdr(&b);
 
+    /* The Map-Notify is authenticated with the same type of key */
+    keyid = ntohs(AUTH_REC_KEY_ID(lisp_msg_pull_auth_field(&b)));
+
     if (MREG_WANT_MAP_NOTIFY(hdr)) {
         mntf = lisp_msg_create(LISP_MAP_NOTIFY);
         lisp_msg_put_empty_auth_record(mntf, keyid);
     }
 
-    lisp_msg_pull_auth_field(&b);
-
 
     for (i = 0; i < MREG_REC_COUNT(hdr); i++) {
-        m = mapping_new();
-        if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
-            goto err;
-        }
+        m = NULL;
+        rec = lbuf_data(&b);
+        rec_len = lisp_msg_mapping_record_len(&b, &eid_len);
+
+        /* Periodic refreshes repeat the record last registered for the
+         * site. Recognize them from the raw record, without parsing it */
+        rsite = rec_len ? rsite_lookup_rec(ms, rec, eid_len) : NULL;
+        if (rsite && rsite->rec_len == rec_len
+                && memcmp(rsite->rec, rec, rec_len) == 0) {
+            lbuf_pull(&b, rec_len);
+            reg_pref = rsite->site;
+            eid = mapping_eid(rsite->site_map);
+        } else {
+            rsite = NULL;
+            m = mapping_new();
+            if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
+                goto bad;
+            }
 
-        if (mapping_auth(m) == 0){
-            LMLOG(LWRN,"ms_recv_map_register: Received a none authoritative record in a Map Register: %s",
-                    lisp_addr_to_char(mapping_eid(m)));
-        }
+            if (mapping_auth(m) == 0){
+                LMLOG(LWRN,"ms_recv_map_register: Received a none authoritative record in a Map Register: %s",
+                        lisp_addr_to_char(mapping_eid(m)));
+            }
 
-        eid = mapping_eid(m);
-        eid_pref = pref_get_network_prefix(eid);
-        mapping_set_eid(m,eid_pref);
-        lisp_addr_del(eid_pref);
+            eid = mapping_eid(m);
+            eid_pref = pref_get_network_prefix(eid);
+            mapping_set_eid(m,eid_pref);
+            lisp_addr_del(eid_pref);
 
-        /* find configured prefix */
-        reg_pref = mdb_lookup_entry(ms->lisp_sites_db, eid);
-        if (!reg_pref) {
-            LMLOG(LDBG_1, "EID %s not in configured lisp-sites DB! "
-                    "Discarding mapping!", lisp_addr_to_char(eid));
-            mapping_del(m);
-            continue;
+            /* find configured prefix */
+            reg_pref = mdb_lookup_entry(ms->lisp_sites_db, eid);
+            if (!reg_pref) {
+                LMLOG(LDBG_1, "EID %s not in configured lisp-sites DB! "
+                        "Discarding mapping!", lisp_addr_to_char(eid));
+                mapping_del(m);
+                continue;
+            }
         }
 
         /* CHECK AUTH */
 
         /* if first record, lookup the key */
-        if (!key) {
-            if (lisp_msg_check_auth_field(buf, reg_pref->key) != GOOD) {
+        if (!auth_pref) {
+            if (lisp_msg_check_auth_field_key(buf, reg_pref->hmac_key) != GOOD) {
                 LMLOG(LDBG_1, "Message validation failed for EID %s with key "
                         "%s. Stopping processing!", lisp_addr_to_char(eid),
                         reg_pref->key);
@@ -391,13 +568,24 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
             }
             LMLOG(LDBG_2, "Message validated with key associated to EID %s",
                     lisp_addr_to_char(eid));
-            key = reg_pref->key;
-        } else if (strncmp(key, reg_pref->key, strlen(key)) !=0 ) {
+            auth_pref = reg_pref;
+        } else if (reg_pref != auth_pref && (reg_pref->key_type != auth_pref->key_type
+                || strcmp(reg_pref->key, auth_pref->key) != 0)) {
             LMLOG(LDBG_1, "EID %s part of multi EID Map-Register has different "
                     "key! Discarding!", lisp_addr_to_char(eid));
+            mapping_del(m);
             continue;
         }
 
+        /* Unchanged refresh: only extend the registration */
+        if (rsite) {
+            lsite_entry_update_expiration_timer(ms, rsite);
+            if (MREG_WANT_MAP_NOTIFY(hdr)) {
+                lisp_msg_put_raw_mapping(mntf, rec, rec_len);
+                valid_records = TRUE;
+            }
+            continue;
+        }
 
         /* check more specific */
         if (reg_pref->accept_more_specifics == TRUE){
@@ -412,7 +600,7 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
                     "specifics not configured! Discarding",
                     lisp_addr_to_char(eid),
                     lisp_addr_to_char(reg_pref->eid_prefix));
-            lisp_addr_del(eid);
+            mapping_del(m);
             continue;
         }
 
@@ -420,30 +608,43 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         rsite = mdb_lookup_entry_exact(ms->reg_sites_db, eid);
         if (rsite) {
             if (mapping_cmp(rsite->site_map, m) != 0) {
+                pthread_rwlock_wrlock(&ms->reg_sites_lock);
                 if (!reg_pref->merge) {
                     LMLOG(LDBG_3, "Prefix %s already registered, updating "
                             "locators", lisp_addr_to_char(eid));
                     mapping_update_locators(rsite->site_map,mapping_locators_lists(m));
+                    rsite_set_mrep_rec(rsite);
                 } else {
                     /* TREAT MERGE SEMANTICS */
                     LMLOG(LWRN, "Prefix %s has merge semantics",
                             lisp_addr_to_char(eid));
                 }
                 reg_pref->proxy_reply = MREG_PROXY_REPLY(hdr);
+                pthread_rwlock_unlock(&ms->reg_sites_lock);
                 ms_dump_registered_sites(ms, LDBG_3);
             }
 
             /* update registration timer */
             lsite_entry_update_expiration_timer(ms, rsite);
+            new_rsite = NULL;
         } else {
             /* save prefix to the registered sites db */
             new_rsite = xzalloc(sizeof(lisp_reg_site_t));
             new_rsite->site_map = m;
+            rsite_set_mrep_rec(new_rsite);
+            pthread_rwlock_wrlock(&ms->reg_sites_lock);
             mdb_add_entry(ms->reg_sites_db, mapping_eid(m), new_rsite);
+            reg_pref->proxy_reply = MREG_PROXY_REPLY(hdr);
+            pthread_rwlock_unlock(&ms->reg_sites_lock);
             lsite_entry_start_expiration_timer(ms, new_rsite);
 
-            reg_pref->proxy_reply = MREG_PROXY_REPLY(hdr);
             ms_dump_registered_sites(ms, LDBG_3);
+            rsite = new_rsite;
+        }
+
+        rsite->site = reg_pref;
+        if (rec_len) {
+            rsite_set_rec(ms, rsite, rec, rec_len, eid_len);
         }
 
         if (MREG_WANT_MAP_NOTIFY(hdr)) {
@@ -452,17 +653,17 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         }
 
         /* if site previously registered, just remove the parsed mapping */
-        if (rsite) {
+        if (!new_rsite) {
             mapping_del(m);
         }
 
     }
 
     /* check if key is initialized, otherwise registration failed */
-    if (mntf && key && valid_records) {
+    if (mntf && auth_pref && valid_records) {
         mntf_hdr = lisp_msg_hdr(mntf);
         MNTF_NONCE(mntf_hdr) = MREG_NONCE(hdr);
-        lisp_msg_fill_auth_data(mntf, keyid, key);
+        lisp_msg_fill_auth_data_key(mntf, auth_pref->hmac_key);
         LMLOG(LDBG_1, "%s, IP: %s -> %s, UDP: %d -> %d",
                 lisp_msg_hdr_to_char(mntf), lisp_addr_to_char(&uc->la),
                 lisp_addr_to_char(&uc->ra), uc->lp, uc->rp);
@@ -471,16 +672,61 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     lisp_msg_destroy(mntf);
 
     return(GOOD);
-err:
-    return(BAD);
-    mapping_del(m);
-    lisp_msg_destroy(mntf);
 bad: /* could return different error */
     mapping_del(m);
     lisp_msg_destroy(mntf);
     return(BAD);
 }
 
+/* Called from the Map-Server threads. Checks the authentication data of the
+ * Map-Register in 'buf' with the key of the site of its first record, which
+ * is returned in 'auth_pref'. If that site is not configured, 'auth_pref' is
+ * NULL and the check is left to ms_recv_map_register */
+int
+ms_check_map_register_auth(lisp_ms_t *ms, lbuf_t *buf,
+        lisp_site_prefix_t **auth_pref)
+{
+    lisp_site_prefix_t *reg_pref = NULL;
+    lisp_addr_t *eid = NULL;
+    lisp_addr_t *eid_pref = NULL;
+    lbuf_t b;
+    void *hdr = NULL;
+    uint8_t *rec = NULL;
+    int eid_len, ret = GOOD;
+
+    *auth_pref = NULL;
+    b = *buf;
+    hdr = lisp_msg_pull_hdr(&b);
+    lisp_msg_pull_auth_field(&b);
+    rec = lbuf_data(&b);
+    if (MREG_REC_COUNT(hdr) == 0 || !lisp_msg_mapping_record_len(&b, &eid_len)) {
+        return(GOOD);
+    }
+
+    eid = lisp_addr_new();
+    if (lisp_addr_parse(MAP_REC_EID(rec), eid) <= 0) {
+        lisp_addr_del(eid);
+        return(GOOD);
+    }
+    lisp_addr_set_plen(eid, MAP_REC_EID_PLEN(rec));
+    eid_pref = pref_get_network_prefix(eid);
+
+    reg_pref = mdb_lookup_entry(ms->lisp_sites_db, eid_pref);
+    if (reg_pref) {
+        if (lisp_msg_check_auth_field_key(buf, reg_pref->hmac_key) != GOOD) {
+            LMLOG(LDBG_1, "Message validation failed for EID %s with key "
+                    "%s. Stopping processing!", lisp_addr_to_char(eid_pref),
+                    reg_pref->key);
+            ret = BAD;
+        } else {
+            *auth_pref = reg_pref;
+        }
+    }
+
+    lisp_addr_del(eid_pref);
+    lisp_addr_del(eid);
+    return(ret);
+}
 
 int
 ms_add_lisp_site_prefix(lisp_ms_t *ms, lisp_site_prefix_t *sp)
@@ -502,8 +748,13 @@ ms_add_registered_site_prefix(lisp_ms_t *ms, mapping_t *sp)
 
     lisp_reg_site_t *rs = xzalloc(sizeof(lisp_reg_site_t));
     rs->site_map = sp;
-    if (!mdb_add_entry(ms->reg_sites_db, mapping_eid(sp), rs))
+    rsite_set_mrep_rec(rs);
+    pthread_rwlock_wrlock(&ms->reg_sites_lock);
+    if (!mdb_add_entry(ms->reg_sites_db, mapping_eid(sp), rs)) {
+        pthread_rwlock_unlock(&ms->reg_sites_lock);
         return(BAD);
+    }
+    pthread_rwlock_unlock(&ms->reg_sites_lock);
     return(GOOD);
 }
 
@@ -577,7 +828,7 @@ ms_recv_msg(lisp_ctrl_dev_t *dev, lbuf_t *msg, uconn_t *uc)
          ret = ms_recv_map_request(ms, msg, uc);
          break;
      case LISP_MAP_REGISTER:
-         ret = ms_recv_map_register(ms, msg, uc);
+         ret = ms_recv_map_register(ms, msg, uc, NULL);
          break;
      case LISP_MAP_REPLY:
      case LISP_MAP_NOTIFY:
@@ -613,11 +864,22 @@ static int
 ms_ctrl_construct(lisp_ctrl_dev_t *dev)
 {
     lisp_ms_t *ms = lisp_ms_cast(dev);
+    pthread_rwlockattr_t attr;
+
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    /* Don't let a continuous flow of Map-Requests starve registrations */
+    pthread_rwlockattr_setkind_np(&attr,
+            PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&ms->reg_sites_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
 
     ms->reg_sites_db = mdb_new();
     ms->lisp_sites_db = mdb_new();
+    ms->reg_sites_recs = kh_init(rsites);
 
-    if (!ms->reg_sites_db || !ms->lisp_sites_db) {
+    if (!ms->reg_sites_db || !ms->lisp_sites_db || !ms->reg_sites_recs) {
         return(BAD);
     }
 
@@ -630,8 +892,16 @@ static void
 ms_ctrl_destruct(lisp_ctrl_dev_t *dev)
 {
     lisp_ms_t *ms = lisp_ms_cast(dev);
+    int i;
+
+    for (i = 0; i < ms->num_workers; i++) {
+        ms_worker_del(ms->workers[i]);
+    }
+    rate_limit_del(ms->req_limit);
+    kh_destroy(rsites, ms->reg_sites_recs);
     mdb_del(ms->lisp_sites_db, (mdb_del_fct)lisp_site_prefix_del);
     mdb_del(ms->reg_sites_db, (mdb_del_fct)lisp_reg_site_del);
+    pthread_rwlock_destroy(&ms->reg_sites_lock);
 }
 
 void
@@ -646,12 +916,33 @@ void
 ms_ctrl_run(lisp_ctrl_dev_t *dev)
 {
     lisp_ms_t *ms = lisp_ms_cast(dev);
+    ms_worker_t *w;
+    int i;
 
     LMLOG (LDBG_1, "****** Summary of the configuration ******");
     ms_dump_configured_sites(ms, LDBG_1);
     ms_dump_registered_sites(ms, LDBG_1);
 
     LMLOG(LDBG_1, "Starting Map-Server ...");
+
+    if (map_request_rate_limit > 0) {
+        ms->req_limit = rate_limit_new(MS_RATE_LIMIT_SOURCES,
+                map_request_rate_limit, map_request_rate_limit);
+    }
+
+    for (i = 0; i < map_server_threads; i++) {
+        w = ms_worker_new(i, ms);
+        if (!w) {
+            break;
+        }
+        ms->workers[ms->num_workers++] = w;
+        if (ms_worker_start(w) != GOOD) {
+            break;
+        }
+    }
+    if (ms->num_workers > 0) {
+        LMLOG(LDBG_1, "Map-Server running in %d threads", ms->num_workers);
+    }
 }
 
 
@@ -663,5 +954,6 @@ ctrl_dev_class_t ms_ctrl_class = {
         .run = ms_ctrl_run,
         .recv_msg = ms_recv_msg,
         .if_event = NULL,
-        .get_fwd_entry = NULL
+        .get_fwd_entry = NULL,
+        .queue_packet = NULL
 };
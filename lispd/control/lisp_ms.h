@@ -20,9 +20,34 @@
 #ifndef LISP_MS_H_
 #define LISP_MS_H_
 
+#include <pthread.h>
+
 #include "lisp_ctrl_device.h"
+#include "../elibs/khash/khash.h"
 #include "../lib/lisp_site.h"
+#include "../lib/packets.h"
+#include "../lib/rate_limit.h"
+
+/* Registered sites indexed by the EID-prefix field of their last record */
+static inline khint_t
+rsite_rec_hash(lisp_reg_site_t *rs)
+{
+    return(pkt_data_hash(MAP_REC_EID(rs->rec), rs->eid_len,
+            MAP_REC_EID_PLEN(rs->rec)));
+}
+
+static inline int
+rsite_rec_equal(lisp_reg_site_t *a, lisp_reg_site_t *b)
+{
+    return(a->eid_len == b->eid_len
+            && MAP_REC_EID_PLEN(a->rec) == MAP_REC_EID_PLEN(b->rec)
+            && memcmp(MAP_REC_EID(a->rec), MAP_REC_EID(b->rec),
+                    a->eid_len) == 0);
+}
 
+KHASH_INIT(rsites, lisp_reg_site_t *, char, 0, rsite_rec_hash, rsite_rec_equal)
+
+struct ms_worker_;
 
 typedef struct _lisp_ms {
     lisp_ctrl_dev_t super;    /* base "class" */
@@ -30,9 +55,25 @@ typedef struct _lisp_ms {
     /* ms members */
     mdb_t *lisp_sites_db;
     mdb_t *reg_sites_db;
+    khash_t(rsites) *reg_sites_recs;
+
+    /* Registered sites are only modified by the control thread, which holds
+     * the write lock while doing so. Map-Server threads look them up holding
+     * the read lock. The configured sites don't change once running */
+    pthread_rwlock_t reg_sites_lock;
+    struct ms_worker_ *workers[MAX_MAP_SERVER_THREADS];
+    int num_workers;
+    /* Map-Requests of each source, shared by the control thread and the
+     * Map-Server threads */
+    rate_limit_t *req_limit;
 } lisp_ms_t;
 
 /* ms interface */
+int ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc);
+int ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc,
+        lisp_site_prefix_t *auth_pref);
+int ms_check_map_register_auth(lisp_ms_t *ms, lbuf_t *buf,
+        lisp_site_prefix_t **auth_pref);
 int ms_add_lisp_site_prefix(lisp_ms_t *ms, lisp_site_prefix_t *site);
 int ms_add_registered_site_prefix(lisp_ms_t *dev, mapping_t *sp);
 void ms_dump_configured_sites(lisp_ms_t *dev, int log_level);
@@ -0,0 +1,289 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include "lisp_ms_worker.h"
+#include "../liblisp/liblisp.h"
+#include "../lib/lmlog.h"
+#include "../lib/util.h"
+#include "../lispd_external.h"
+
+
+static int ms_worker_recv_msg(sock_t *sl);
+static int ms_worker_mreg_cb(sock_t *sl);
+
+static void
+ms_worker_mreg_del(ms_worker_mreg_t *mreg)
+{
+    lbuf_del(mreg->b);
+    free(mreg);
+}
+
+static void
+ms_worker_notify(int fd)
+{
+    uint64_t one = 1;
+
+    if (write(fd, &one, sizeof(one)) != sizeof(one)) {
+        LMLOG(LDBG_2, "ms_worker_notify: write error: %s", strerror(errno));
+    }
+}
+
+static void
+ms_worker_clear_notification(int fd)
+{
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN) {
+        LMLOG(LDBG_2, "ms_worker_clear_notification: read error: %s",
+                strerror(errno));
+    }
+}
+
+static int
+ms_worker_open_socket(ms_worker_t *w, int afi)
+{
+    int fd;
+
+    fd = open_control_reuseport_input_socket(afi);
+    if (fd == ERR_SOCKET) {
+        return (BAD);
+    }
+    sockmstr_register_read_listener(w->smaster, ms_worker_recv_msg, w, fd);
+    return (GOOD);
+}
+
+ms_worker_t *
+ms_worker_new(int id, lisp_ms_t *ms)
+{
+    ms_worker_t *w;
+
+    w = xzalloc(sizeof(ms_worker_t));
+    w->id = id;
+    w->ms = ms;
+    w->smaster = sockmstr_create();
+    w->mreg_ring = spsc_ring_new(MS_WORKER_RING_SIZE);
+    w->mreg_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!w->smaster || w->mreg_fd == -1
+            || (default_rloc_afi != AF_INET6
+                    && ms_worker_open_socket(w, AF_INET) != GOOD)
+            || (default_rloc_afi != AF_INET
+                    && ms_worker_open_socket(w, AF_INET6) != GOOD)) {
+        LMLOG(LCRIT, "ms_worker_new: Couldn't create Map-Server worker %d",
+                id);
+        if (w->mreg_fd != -1) {
+            close(w->mreg_fd);
+        }
+        sockmstr_destroy(w->smaster);
+        spsc_ring_del(w->mreg_ring);
+        free(w);
+        return (NULL);
+    }
+
+    w->mreg_sock = sockmstr_register_read_listener(smaster, ms_worker_mreg_cb,
+            w, w->mreg_fd);
+
+    return (w);
+}
+
+void
+ms_worker_del(ms_worker_t *w)
+{
+    ms_worker_mreg_t *mreg;
+
+    if (!w) {
+        return;
+    }
+
+    if (w->running) {
+        pthread_cancel(w->thread);
+        pthread_join(w->thread, NULL);
+    }
+
+    /* Closes the eventfd */
+    sockmstr_unregister_read_listenedr(smaster, w->mreg_sock);
+    while ((mreg = spsc_ring_pop(w->mreg_ring)) != NULL) {
+        ms_worker_mreg_del(mreg);
+    }
+    spsc_ring_del(w->mreg_ring);
+
+    /* Closes the control input sockets */
+    sockmstr_destroy(w->smaster);
+    free(w);
+}
+
+/* Called from the worker thread. Pass the Map-Register in 'b' to the control
+ * thread once authenticated */
+static int
+ms_worker_queue_map_register(ms_worker_t *w, lbuf_t *b, uconn_t *uc)
+{
+    ms_worker_mreg_t *mreg;
+    lisp_site_prefix_t *auth_pref;
+
+    if (ms_check_map_register_auth(w->ms, b, &auth_pref) != GOOD) {
+        return (BAD);
+    }
+
+    /* Pooled buffers are released by the thread that got them */
+    mreg = xzalloc(sizeof(ms_worker_mreg_t));
+    mreg->b = lbuf_clone(b);
+    lbuf_reset_lisp(mreg->b);
+    mreg->uc = *uc;
+    mreg->auth_pref = auth_pref;
+    if (spsc_ring_push(w->mreg_ring, mreg) != GOOD) {
+        LMLOG(LDBG_1, "ms_worker_queue_map_register: Map-Registers queue of "
+                "worker %d full. Discarding!", w->id);
+        ms_worker_mreg_del(mreg);
+        return (BAD);
+    }
+    ms_worker_notify(w->mreg_fd);
+
+    return (GOOD);
+}
+
+/* Formats the IP address 'addr' in 'buf' */
+static char *
+ms_worker_addr_to_char(lisp_addr_t *addr, char *buf, socklen_t len)
+{
+    ip_addr_t *ip = lisp_addr_ip(addr);
+
+    if (!inet_ntop(ip_addr_afi(ip), ip_addr_get_addr(ip), buf, len)) {
+        snprintf(buf, len, "?");
+    }
+    return (buf);
+}
+
+/* Called from the worker thread when a control message is received */
+static int
+ms_worker_recv_msg(sock_t *sl)
+{
+    ms_worker_t *w = (ms_worker_t *)sl->arg;
+    lisp_msg_type_e type;
+    uconn_t uc;
+    lbuf_t *b;
+    char ra[INET6_ADDRSTRLEN], la[INET6_ADDRSTRLEN];
+    int ret = BAD;
+
+    uc.lp = LISP_CONTROL_PORT;
+
+    b = lisp_msg_create_buf();
+    if (sock_ctrl_recv(sl->fd, b, &uc) != GOOD) {
+        LMLOG(LDBG_1, "Couldn't retrieve socket information"
+                "for control message! Discarding packet!");
+        lbuf_del(b);
+        return (BAD);
+    }
+
+    lbuf_reset_lisp(b);
+    if (is_loggable(LDBG_1)) {
+        /* Formatted on the stack rather than in the rotating buffers of
+         * lisp_addr_to_char */
+        ms_worker_addr_to_char(&uc.ra, ra, sizeof(ra));
+        ms_worker_addr_to_char(&uc.la, la, sizeof(la));
+        LMLOG(LDBG_1, "Map-Server worker %d received %s, IP: %s -> %s, UDP: "
+                "%d -> %d", w->id, lisp_msg_hdr_to_char(b), ra, la, uc.rp,
+                uc.lp);
+    }
+
+    type = lisp_msg_type(b);
+    if (type == LISP_ENCAP_CONTROL_TYPE) {
+        if (lisp_msg_ecm_decap(b, &uc.rp) != GOOD) {
+            lbuf_del(b);
+            return (BAD);
+        }
+        type = lisp_msg_type(b);
+    }
+
+    switch (type) {
+    case LISP_MAP_REQUEST:
+        ret = ms_recv_map_request(w->ms, b, &uc);
+        break;
+    case LISP_MAP_REGISTER:
+        ret = ms_worker_queue_map_register(w, b, &uc);
+        break;
+    default:
+        LMLOG(LDBG_3, "Map-Server worker %d: Received control message with "
+                "type %d. Discarding!", w->id, type);
+        break;
+    }
+
+    lbuf_del(b);
+    return (ret);
+}
+
+/* Called from the control thread when a worker has pending Map-Registers */
+static int
+ms_worker_mreg_cb(sock_t *sl)
+{
+    ms_worker_t *w = (ms_worker_t *)sl->arg;
+    ms_worker_mreg_t *mreg;
+
+    ms_worker_clear_notification(sl->fd);
+
+    while ((mreg = spsc_ring_pop(w->mreg_ring)) != NULL) {
+        ms_recv_map_register(w->ms, mreg->b, &mreg->uc, mreg->auth_pref);
+        ms_worker_mreg_del(mreg);
+    }
+
+    return (GOOD);
+}
+
+static void *
+ms_worker_run(void *arg)
+{
+    ms_worker_t *w = (ms_worker_t *)arg;
+    int state;
+
+    LMLOG(LDBG_1, "Map-Server worker %d started", w->id);
+
+    for (;;) {
+        sockmstr_wait_on_all_read(w->smaster);
+        /* Not cancelled while holding the lock of the registered sites */
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+        sockmstr_process_all(w->smaster);
+        pthread_setcancelstate(state, NULL);
+    }
+
+    return (NULL);
+}
+
+int
+ms_worker_start(ms_worker_t *w)
+{
+    sigset_t all, old;
+    int err;
+
+    /* Signals are handled by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    err = pthread_create(&w->thread, NULL, ms_worker_run, w);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (err != 0) {
+        LMLOG(LCRIT, "ms_worker_start: Couldn't start Map-Server worker %d: "
+                "%s", w->id, strerror(err));
+        return (BAD);
+    }
+    w->running = TRUE;
+
+    return (GOOD);
+}
@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LISP_MS_WORKER_H_
+#define LISP_MS_WORKER_H_
+
+#include <pthread.h>
+
+#include "lisp_ms.h"
+#include "../lib/lbuf.h"
+#include "../lib/sockets.h"
+#include "../lib/spsc_ring.h"
+
+/* Map-Registers that can be pending per worker */
+#define MS_WORKER_RING_SIZE     1024
+
+/*
+ * Map-Server thread. Each worker runs its own event loop with its own control
+ * input sockets, opened in the control port together with the ones of the
+ * main thread. Map-Requests are answered by the worker. Map-Registers are
+ * authenticated by the worker and handed to the control thread, the only one
+ * that modifies the registered sites.
+ */
+typedef struct ms_worker_ {
+    int id;
+    pthread_t thread;
+    uint8_t running;
+    lisp_ms_t *ms;
+    sockmstr_t *smaster;
+
+    /* Map-Registers for the control thread */
+    spsc_ring_t *mreg_ring;
+    int mreg_fd;
+    sock_t *mreg_sock;
+} ms_worker_t;
+
+/* Map-Register authenticated by a worker */
+typedef struct ms_worker_mreg_ {
+    lbuf_t *b;
+    uconn_t uc;
+    lisp_site_prefix_t *auth_pref;
+} ms_worker_mreg_t;
+
+ms_worker_t *ms_worker_new(int id, lisp_ms_t *ms);
+void ms_worker_del(ms_worker_t *worker);
+int ms_worker_start(ms_worker_t *worker);
+
+#endif /* LISP_MS_WORKER_H_ */
@@ -23,13 +23,21 @@
 #include "../lib/sockets.h"
 #include "../lib/util.h"
 #include "../lib/lmlog.h"
+#include "../lib/obj_pool.h"
+#include "../lib/prefixes.h"
 #include "../lib/timers_utils.h"
+#include "lisp_fwd_state.h"
 #include "lisp_xtr.h"
 
 static int mc_entry_expiration_timer_cb(lmtimer_t *t);
 static void mc_entry_start_expiration_timer(lisp_xtr_t *, mcache_entry_t *);
+static int mc_entry_refresh_sample_cb(lmtimer_t *t);
+static int mc_entry_refresh_cb(lmtimer_t *t);
+static void mc_entry_start_refresh_timer(lisp_xtr_t *, mcache_entry_t *);
+static int refresh_map_request_cb(lmtimer_t *t);
 static int handle_locator_probe_reply(lisp_xtr_t *, mcache_entry_t *, lisp_addr_t *);
 static int update_mcache_entry(lisp_xtr_t *, mapping_t *);
+static void tr_mcache_evict(lisp_xtr_t *, mcache_entry_t *);
 static int tr_recv_map_reply(lisp_xtr_t *, lbuf_t *, uconn_t *);
 static int tr_reply_to_smr(lisp_xtr_t *xtr, lisp_addr_t *src_eid, lisp_addr_t *req_eid);
 static int tr_recv_map_request(lisp_xtr_t *, lbuf_t *, uconn_t *);
@@ -47,11 +55,19 @@ static int send_smr_invoked_map_request(lisp_xtr_t *xtr, lisp_addr_t *src_eid,
         mcache_entry_t *mce, uint64_t nonce);
 static int program_smr(lisp_xtr_t *, int time);
 static int send_map_request_retry_cb(lmtimer_t *timer);
+static int tr_mreq_batch_add(lisp_xtr_t *xtr, lisp_addr_t *eid,
+        lisp_addr_t *src_eid);
+static void tr_mreq_batch_prune(lisp_xtr_t *xtr, mreq_batch_t *batch);
+static void tr_mreq_batch_resolve(lisp_xtr_t *xtr, mreq_batch_t *batch,
+        mapping_t *m, glist_t *pending);
+static void tr_mreq_batch_stop(lisp_xtr_t *xtr, mreq_batch_t *batch);
 static int build_and_send_map_request(lisp_xtr_t *xtr, lisp_addr_t *src_eid,
-        mcache_entry_t *mce, uint64_t nonce);
+        glist_t *eids, uint64_t nonce);
 //static int send_map_reg(lisp_xtr_t *, lbuf_t *, lisp_addr_t *);
-static int build_and_send_map_reg(lisp_xtr_t *, mapping_t *, map_server_elt *,
-        uint64_t);
+static int build_and_send_map_regs(lisp_xtr_t *, map_server_elt *, uint64_t,
+        htable_ptrs_t *);
+static void map_register_next_round(map_server_elt *);
+static void map_register_upd_stop(map_server_elt *);
 //static int build_and_send_ecm_map_reg(lisp_xtr_t *, mapping_t *, lisp_addr_t *,
 //        uint64_t);
 int program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle);
@@ -63,8 +79,11 @@ int map_reply_fill_uconn(lisp_xtr_t *xtr, glist_t *itr_rlocs, uconn_t *uc);
 
 static void proxy_etrs_dump(lisp_xtr_t *, int log_level);
 
+static fwd_state_t *tr_build_fwd_state(void *arg);
+static void tr_mce_fwd_changed(lisp_xtr_t *xtr, mcache_entry_t *mce);
 static fwd_info_t *tr_get_forwarding_entry(lisp_ctrl_dev_t *,
         packet_tuple_t *);
+static int tr_queue_packet(lisp_ctrl_dev_t *, packet_tuple_t *, lbuf_t *);
 
 glist_t *get_local_locators_with_address(local_map_db_t *local_db, lisp_addr_t *addr);
 map_local_entry_t *get_map_loc_ent_containing_loct_ptr(local_map_db_t *local_db,
@@ -81,10 +100,13 @@ void timer_rloc_probe_argument_free(timer_rloc_probe_argument *timer_arg);
 timer_map_req_argument *timer_map_req_arg_new_init(mcache_entry_t *mce,
         lisp_addr_t *src_eid);
 void timer_map_req_arg_free(timer_map_req_argument * timer_arg);
-/* Funtions related to timer_map_reg_argument */
-timer_map_reg_argument * timer_map_reg_argument_new_init(map_local_entry_t *mle,
-        map_server_elt *ms);
-void timer_map_reg_arg_free(timer_map_reg_argument * timer_arg);
+static mreq_batch_t *mreq_batch_new(lisp_addr_t *src_eid);
+static void mreq_batch_del(mreq_batch_t *batch);
+
+static obj_pool_t rloc_probe_args_pool = OBJ_POOL_INIT(
+        "timer_rloc_probe_argument", timer_rloc_probe_argument);
+static obj_pool_t map_req_args_pool = OBJ_POOL_INIT("timer_map_req_argument",
+        timer_map_req_argument);
 
 
 /* Called when the timer associated with an EID entry expires. */
@@ -107,6 +129,10 @@ mc_entry_start_expiration_timer(lisp_xtr_t *xtr, mcache_entry_t *mce)
     /* Expiration cache timer */
     lmtimer_t *timer;
 
+    /* The entry may be updated before expiring */
+    stop_timers_of_type_from_obj(mce, EXPIRE_MAP_CACHE_TIMER, ptrs_to_timers_ht,
+            nonces_ht);
+
     timer = lmtimer_create(EXPIRE_MAP_CACHE_TIMER);
     lmtimer_init(timer,xtr,mc_entry_expiration_timer_cb,mce,NULL,NULL);
     htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
@@ -116,6 +142,124 @@ mc_entry_start_expiration_timer(lisp_xtr_t *xtr, mcache_entry_t *mce)
     LMLOG(LDBG_1,"The map cache entry of EID %s will expire in %d minutes.",
             lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))),
             mapping_ttl(mcache_entry_mapping(mce)));
+
+    mc_entry_start_refresh_timer(xtr, mce);
+}
+
+/* Seconds before expiring at which 'mce' is refreshed. It is only refreshed
+ * if it was used during the same amount of time before */
+static int
+mc_entry_refresh_window(mcache_entry_t *mce)
+{
+    int ttl = mapping_ttl(mcache_entry_mapping(mce))*60;
+
+    return (ttl - ttl * map_cache_refresh / 100);
+}
+
+/* Start of the period in which the use of the entry is checked */
+static int
+mc_entry_refresh_sample_cb(lmtimer_t *timer)
+{
+    mcache_entry_t *mce = lmtimer_cb_argument(timer);
+    lisp_xtr_t *xtr = lmtimer_owner(timer);
+
+    fwd_gen_test_and_clear_used(mcache_entry_gen(mce), FWD_GEN_USED_REFRESH);
+    lmtimer_init(timer, xtr, mc_entry_refresh_cb, mce, NULL, NULL);
+    lmtimer_start(timer, mc_entry_refresh_window(mce));
+    return(GOOD);
+}
+
+/* Request again the mapping of 'mce' if it was used recently. Otherwise it
+ * is left to expire */
+static int
+mc_entry_refresh_cb(lmtimer_t *timer)
+{
+    mcache_entry_t *mce = lmtimer_cb_argument(timer);
+    lisp_xtr_t *xtr = lmtimer_owner(timer);
+    lisp_addr_t *eid = mapping_eid(mcache_entry_mapping(mce));
+    lisp_addr_t *src_eid;
+    glist_t *timers;
+    lmtimer_t *req_timer;
+    timer_map_req_argument *timer_arg;
+    int afi;
+
+    if (!fwd_gen_test_and_clear_used(mcache_entry_gen(mce),
+            FWD_GEN_USED_REFRESH)) {
+        LMLOG(LDBG_2, "Map cache entry of EID %s not used recently. Not "
+                "refreshing it", lisp_addr_to_char(eid));
+        return(GOOD);
+    }
+
+    timers = htable_ptrs_timers_get_timers_of_type(ptrs_to_timers_ht, mce,
+            REFRESH_MAP_REQUEST_TIMER);
+    if (glist_size(timers) > 0) {
+        glist_destroy(timers);
+        return(GOOD);
+    }
+    glist_destroy(timers);
+
+    /* As with SMRs, the request is sent on behalf of the site */
+    afi = lisp_addr_ip_afi(eid);
+    src_eid = local_map_db_get_main_eid(xtr->local_mdb, afi);
+    if (!src_eid) {
+        src_eid = ctrl_default_rloc(lisp_ctrl_dev_get_ctrl_t(&(xtr->super)), afi);
+    }
+    if (!src_eid) {
+        LMLOG(LDBG_1, "Couldn't refresh map cache entry of EID %s: No source "
+                "address available", lisp_addr_to_char(eid));
+        return(BAD);
+    }
+
+    LMLOG(LDBG_1, "Refreshing map cache entry of EID %s before it expires",
+            lisp_addr_to_char(eid));
+    timer_arg = timer_map_req_arg_new_init(mce, src_eid);
+    req_timer = lmtimer_with_nonce_new(REFRESH_MAP_REQUEST_TIMER, xtr,
+            refresh_map_request_cb, timer_arg,
+            (lmtimer_del_cb_arg_fn)timer_map_req_arg_free);
+    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, req_timer);
+
+    return(refresh_map_request_cb(req_timer));
+}
+
+static void
+mc_entry_start_refresh_timer(lisp_xtr_t *xtr, mcache_entry_t *mce)
+{
+    lmtimer_t *timer;
+    int ttl, window;
+
+    stop_timers_of_type_from_obj(mce, REFRESH_MAP_CACHE_TIMER,
+            ptrs_to_timers_ht, nonces_ht);
+    if (map_cache_refresh == 0) {
+        return;
+    }
+
+    ttl = mapping_ttl(mcache_entry_mapping(mce))*60;
+    window = mc_entry_refresh_window(mce);
+
+    timer = lmtimer_create(REFRESH_MAP_CACHE_TIMER);
+    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
+    if (ttl - window > window) {
+        lmtimer_init(timer, xtr, mc_entry_refresh_sample_cb, mce, NULL, NULL);
+        lmtimer_start(timer, ttl - 2 * window);
+    } else {
+        fwd_gen_test_and_clear_used(mcache_entry_gen(mce),
+                FWD_GEN_USED_REFRESH);
+        lmtimer_init(timer, xtr, mc_entry_refresh_cb, mce, NULL, NULL);
+        lmtimer_start(timer, ttl - window);
+    }
+}
+
+/* The routing info of 'mce' changed. Invalidate the flows forwarded with it */
+static void
+tr_mce_fwd_changed(lisp_xtr_t *xtr, mcache_entry_t *mce)
+{
+    if (mce == xtr->petrs) {
+        /* Flows don't track the generation of the PeTRs entry */
+        fwd_epoch_bump();
+    } else {
+        fwd_gen_bump(mcache_entry_gen(mce));
+    }
+    fwd_state_changed();
 }
 
 /* Process a record from map-reply probe message */
@@ -154,6 +298,7 @@ handle_locator_probe_reply(lisp_xtr_t *xtr, mcache_entry_t *mce,
                 xtr->fwd_policy_dev_parm,
                 mcache_entry_routing_info(mce),
                 map);
+        tr_mce_fwd_changed(xtr, mce);
     }
 
     /* Reprogramming timers of rloc probing */
@@ -187,12 +332,16 @@ update_mcache_entry(lisp_xtr_t *xtr, mapping_t *recv_map)
 
     /* DISCARD all locator state */
     mapping_update_locators(map, mapping_locators_lists(recv_map));
+    mapping_set_ttl(map, mapping_ttl(recv_map));
+    mcache_update_entry_mem(xtr->map_cache, mce);
+    tr_mcache_evict(xtr, mce);
 
     /* Update forwarding info */
     xtr->fwd_policy->updated_map_cache_inf(
             xtr->fwd_policy_dev_parm,
             mcache_entry_routing_info(mce),
             map);
+    tr_mce_fwd_changed(xtr, mce);
 
     /* Reprogramming timers */
     mc_entry_start_expiration_timer(xtr, mce);
@@ -215,6 +364,9 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
     nonces_list_t *nonces_lst;
     lmtimer_t *timer;
     timer_map_req_argument *t_mr_arg;
+    mreq_batch_t *batch;
+    glist_t *pending = NULL;
+    glist_entry_t *it;
     int records,active_entry,i;
 
     /* local copy */
@@ -230,8 +382,41 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
         return(BAD);
     }
     timer = nonces_list_timer(nonces_lst);
-    /* If it is not a Map Reply Probe */
-    if (!MREP_RLOC_PROBE(mrep_hdr)){
+    if (!MREP_RLOC_PROBE(mrep_hdr)
+            && lmtimer_type(timer) == MAP_REQUEST_RETRY_TIMER){
+        /* Reply to the Map-Request of map cache misses. Each record may
+         * resolve any of the EIDs requested with it */
+        batch = (mreq_batch_t *)lmtimer_cb_argument(timer);
+        pending = glist_new_managed((glist_del_fct)glist_destroy);
+        for (i = 0; i < MREP_REC_COUNT(mrep_hdr); i++) {
+            m = mapping_new();
+            if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
+                goto err;
+            }
+            if (mapping_has_elp_with_l_bit(m)){
+                LMLOG(LDBG_1,"Received a Map Reply with an ELP with the L bit set. "
+                        "Not supported -> Discrding map reply");
+                goto err;
+            }
+            tr_mreq_batch_resolve(xtr, batch, m, pending);
+            mcache_dump_db(xtr->map_cache, LDBG_3);
+        }
+
+        /* Packets waiting for the mappings, sent once they are installed */
+        glist_for_each_entry(it, pending) {
+            LMLOG(LDBG_2, "Sending %d packets queued while resolving the "
+                    "mapping", glist_size(glist_entry_data(it)));
+            ctrl_send_pending_packets(glist_entry_data(it));
+        }
+        glist_destroy(pending);
+
+        /* All the EIDs of the Map-Request resolved */
+        if (glist_size(batch->eids) == 0) {
+            tr_mreq_batch_stop(xtr, batch);
+        }
+        return(GOOD);
+    } else if (!MREP_RLOC_PROBE(mrep_hdr)){
+        /* Reply to a SMR invoked or refresh Map-Request */
         t_mr_arg = (timer_map_req_argument *)lmtimer_cb_argument(timer);
         /* We only accept one record except when the nonce is generated by a not active entry */
         mce = t_mr_arg->mce;
@@ -240,6 +425,8 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
         active_entry = mcache_entry_active(mce);
         if (!active_entry){
             records = MREP_REC_COUNT(mrep_hdr);
+            /* Packets waiting for the mapping, sent once it is installed */
+            pending = mcache_entry_take_pending_packets(mce);
             /* delete placeholder/dummy mapping inorder to install the new one */
             tr_mcache_remove_entry(xtr, mce);
             timer = NULL;
@@ -274,6 +461,13 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
 
             mcache_dump_db(xtr->map_cache, LDBG_3);
         }
+
+        if (pending) {
+            LMLOG(LDBG_2, "Sending %d packets queued while resolving the "
+                    "mapping", glist_size(pending));
+            ctrl_send_pending_packets(pending);
+            glist_destroy(pending);
+        }
     }else{
         if (MREP_REC_COUNT(mrep_hdr) >1){
             LMLOG(LDBG_1,"Received Map Reply Probe with multiple records. Only first one will be processed");
@@ -321,6 +515,7 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
 
     return(GOOD);
 err:
+    glist_destroy(pending);
     locator_del(probed);
     mapping_del(m);
     return(BAD);
@@ -536,6 +731,7 @@ handle_merge_semantics(lisp_xtr_t *xtr, mapping_t *rec_map)
                 xtr->fwd_policy_dev_parm,
                 mcache_entry_routing_info(mce),
                 map);
+        tr_mce_fwd_changed(xtr, mce);
 
         program_mce_rloc_probing(xtr, mce);
 
@@ -554,7 +750,6 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
     map_server_elt *ms;
     nonces_list_t *nonces_lst;
     lmtimer_t *timer;
-    timer_map_reg_argument *timer_arg;
     int i, res = BAD;
     lbuf_t b;
 
@@ -571,9 +766,8 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
     }
 
     timer = nonces_list_timer(nonces_lst);
-    timer_arg = (timer_map_reg_argument *)lmtimer_cb_argument(timer);
-    ms = timer_arg->ms;
-    res = lisp_msg_check_auth_field(buf, ms->key);
+    ms = (map_server_elt *)lmtimer_cb_argument(timer);
+    res = lisp_msg_check_auth_field_key(buf, ms->hmac_key);
 
     if (res != GOOD){
         LMLOG(LDBG_1, "Map-Notify message is invalid");
@@ -599,22 +793,32 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
             continue;
         }
 
-        LMLOG(LDBG_1, "Map-Notify message confirms correct registration of %s."
-                "Programing next Map-Register in %d seconds",lisp_addr_to_char(eid),
-                MAP_REGISTER_INTERVAL);
+        LMLOG(LDBG_1, "Map-Notify message confirms correct registration of %s",
+                lisp_addr_to_char(eid));
 
         /* MULTICAST MERGE SEMANTICS */
         if (lisp_addr_is_mc(eid) && mapping_cmp(local_map, m) != 0) {
             handle_merge_semantics(xtr, m);
         }
 
-
         mapping_del(m);
-        htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        lmtimer_start(timer,MAP_REGISTER_INTERVAL);
-
 
+        if (timer == ms->mreg_upd_timer) {
+            htable_ptrs_remove(ms->mreg_dirty, map_loc_e);
+        } else if (!htable_ptrs_lookup(ms->mreg_acked, map_loc_e)) {
+            htable_ptrs_insert(ms->mreg_acked, map_loc_e, map_loc_e);
+            ms->mreg_pending--;
+        }
+    }
 
+    if (timer == ms->mreg_upd_timer) {
+        /* All the changed mappings confirmed */
+        if (htable_ptrs_size(ms->mreg_dirty) == 0) {
+            map_register_upd_stop(ms);
+        }
+    } else if (ms->mreg_pending <= 0) {
+        /* All the records of the round confirmed. Program the next one */
+        map_register_next_round(ms);
     }
 
     return(GOOD);
@@ -627,8 +831,6 @@ handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
     mcache_entry_t *mce = mcache_entry_new();
     mapping_t *m = NULL;
     void *routing_inf = NULL;
-    lmtimer_t *timer;
-    timer_map_req_argument *timer_arg;
 
     /* Install temporary, NOT active, mapping in map_cache */
     m = mapping_new_init(requested_eid);
@@ -647,13 +849,114 @@ handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
         mcache_entry_del(mce);
         return(BAD);
     }
+    tr_mcache_evict(xtr, mce);
+    fwd_state_changed();
 
-    timer_arg = timer_map_req_arg_new_init(mce,src_eid);
-    timer = lmtimer_with_nonce_new(MAP_REQUEST_RETRY_TIMER,xtr,send_map_request_retry_cb,
-            timer_arg,(lmtimer_del_cb_arg_fn)timer_map_req_arg_free);
-    htable_ptrs_timers_add(ptrs_to_timers_ht,mce,timer);
+    return(tr_mreq_batch_add(xtr, mapping_eid(m), src_eid));
+}
+
+/* Add 'eid' to the Map-Request of the misses of 'src_eid' still in the
+ * coalescing window, creating it if needed. It is sent when the window
+ * expires or when it is full */
+static int
+tr_mreq_batch_add(lisp_xtr_t *xtr, lisp_addr_t *eid, lisp_addr_t *src_eid)
+{
+    mreq_batch_t *batch = NULL;
+    mreq_batch_t *b;
+    glist_entry_t *it;
+
+    glist_for_each_entry(it, xtr->mreq_batches) {
+        b = (mreq_batch_t *)glist_entry_data(it);
+        /* A previous placeholder of the EID may still be pending */
+        glist_remove_obj(eid, b->eids);
+        if (!batch && !b->sent && lisp_addr_cmp(&b->src_eid, src_eid) == 0) {
+            batch = b;
+        }
+    }
+
+    if (!batch) {
+        batch = mreq_batch_new(src_eid);
+        batch->timer = lmtimer_with_nonce_new(MAP_REQUEST_RETRY_TIMER, xtr,
+                send_map_request_retry_cb, batch,
+                (lmtimer_del_cb_arg_fn)mreq_batch_del);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, batch, batch->timer);
+        glist_add(batch, xtr->mreq_batches);
+    }
+    glist_add_tail(lisp_addr_clone(eid), batch->eids);
+
+    if (map_request_window == 0
+            || glist_size(batch->eids) >= MAP_REQUEST_MAX_RECORDS) {
+        return(send_map_request_retry_cb(batch->timer));
+    }
+    if (glist_size(batch->eids) == 1) {
+        lmtimer_start_ms(batch->timer, map_request_window);
+    }
+
+    return(GOOD);
+}
+
+/* Forget the EIDs of 'batch' resolved or removed from the map cache */
+static void
+tr_mreq_batch_prune(lisp_xtr_t *xtr, mreq_batch_t *batch)
+{
+    glist_entry_t *it, *aux_it;
+    mcache_entry_t *mce;
+
+    glist_for_each_entry_safe(it, aux_it, batch->eids) {
+        mce = mcache_lookup_exact(xtr->map_cache, glist_entry_data(it));
+        if (!mce || mcache_entry_active(mce)) {
+            glist_remove(it, batch->eids);
+        }
+    }
+}
+
+/* Install the mapping 'm' received for 'batch', replacing the placeholders
+ * of the requested EIDs it covers. Their queued packets are added to
+ * 'pending' to be sent once all the records are processed */
+static void
+tr_mreq_batch_resolve(lisp_xtr_t *xtr, mreq_batch_t *batch, mapping_t *m,
+        glist_t *pending)
+{
+    glist_entry_t *it, *aux_it;
+    lisp_addr_t *eid;
+    mcache_entry_t *mce;
+    glist_t *pkts;
+
+    glist_for_each_entry_safe(it, aux_it, batch->eids) {
+        eid = (lisp_addr_t *)glist_entry_data(it);
+        if (lisp_addr_cmp(mapping_eid(m), eid) != 0
+                && !pref_is_prefix_b_part_of_a(mapping_eid(m), eid)) {
+            continue;
+        }
+        mce = mcache_lookup_exact(xtr->map_cache, eid);
+        if (mce && !mcache_entry_active(mce)) {
+            pkts = mcache_entry_take_pending_packets(mce);
+            if (pkts) {
+                glist_add_tail(pkts, pending);
+            }
+            /* delete placeholder/dummy mapping inorder to install the new one */
+            tr_mcache_remove_entry(xtr, mce);
+        }
+        glist_remove(it, batch->eids);
+    }
 
-    return(send_map_request_retry_cb(timer));
+    mce = mcache_lookup_exact(xtr->map_cache, mapping_eid(m));
+    if (mce && mcache_entry_active(mce)) {
+        /* Reply to a retransmission, the mapping is already installed */
+        update_mcache_entry(xtr, m);
+        mapping_del(m);
+    } else {
+        /* DO NOT free mapping in this case */
+        tr_mcache_add_mapping(xtr, m);
+    }
+}
+
+/* Stop the retransmissions of 'batch' and release it */
+static void
+tr_mreq_batch_stop(lisp_xtr_t *xtr, mreq_batch_t *batch)
+{
+    glist_remove_obj_with_ptr(batch, xtr->mreq_batches);
+    stop_timers_from_obj(batch, ptrs_to_timers_ht, nonces_ht);
 }
 
 static glist_t *
@@ -850,7 +1153,7 @@ smr_invoked_map_request_cb(lmtimer_t *timer)
 
     if (nonces_list_size(nonces_list) - 1 < LISPD_MAX_SMR_RETRANSMIT) {
         nonce = nonce_new();
-        if (send_smr_invoked_map_request(xtr, timer_arg->src_eid, timer_arg->mce, nonce) != GOOD){
+        if (send_smr_invoked_map_request(xtr, &timer_arg->src_eid, timer_arg->mce, nonce) != GOOD){
             return (BAD);
         }
         htable_nonces_insert(nonces_ht, nonce, nonces_list);
@@ -958,48 +1261,97 @@ program_smr(lisp_xtr_t *xtr, int time)
 static int
 send_map_request_retry_cb(lmtimer_t *timer)
 {
-    timer_map_req_argument *timer_arg = (timer_map_req_argument *)lmtimer_cb_argument(timer);
+    mreq_batch_t *batch = (mreq_batch_t *)lmtimer_cb_argument(timer);
     nonces_list_t *nonces_list = lmtimer_nonces(timer);
     lisp_xtr_t *xtr = lmtimer_owner(timer);
+    glist_entry_t *it;
+    mcache_entry_t *mce;
     uint64_t nonce;
-    lisp_addr_t *deid;
     int retries = nonces_list_size(nonces_list);
 
-    deid = mapping_eid (mcache_entry_mapping(timer_arg->mce));
+    batch->sent = TRUE;
+    tr_mreq_batch_prune(xtr, batch);
+    if (glist_size(batch->eids) == 0) {
+        tr_mreq_batch_stop(xtr, batch);
+        return (GOOD);
+    }
+
     if (retries - 1 < xtr->map_request_retries) {
 
         if (retries > 0) {
-            LMLOG(LDBG_1, "Retransmitting Map Request for EID: %s (%d retries)",
-                    lisp_addr_to_char(deid), retries);
+            LMLOG(LDBG_1, "Retransmitting Map Request for EIDs: %s (%d retries)",
+                    laddr_list_to_char(batch->eids), retries);
         }
         nonce = nonce_new();
-        if (build_and_send_map_request(xtr, timer_arg->src_eid, timer_arg->mce, nonce) != GOOD){
+        if (build_and_send_map_request(xtr, &batch->src_eid, batch->eids, nonce) != GOOD){
             return (BAD);
         }
         htable_nonces_insert(nonces_ht, nonce, nonces_list);
         lmtimer_start(timer, LISPD_INITIAL_MRQ_TIMEOUT);
         return (GOOD);
     } else {
-        LMLOG(LDBG_1, "No Map-Reply for EID %s after %d retries. Aborting!",
-                lisp_addr_to_char(deid), retries -1 );
-        /* When removing mce, all timers associated to it are canceled */
-        tr_mcache_remove_entry(xtr,timer_arg->mce);
+        LMLOG(LDBG_1, "No Map-Reply for EIDs %s after %d retries. Aborting!",
+                laddr_list_to_char(batch->eids), retries -1 );
+        glist_for_each_entry(it, batch->eids) {
+            mce = mcache_lookup_exact(xtr->map_cache, glist_entry_data(it));
+            tr_mcache_remove_entry(xtr, mce);
+        }
+        tr_mreq_batch_stop(xtr, batch);
 
         return (BAD);
     }
 }
 
 
-/* Sends a Map-Request for EID in 'mce' and sets-up a retry timer */
+/* Map-Request refreshing an active map cache entry. If there is no reply,
+ * the entry expires with its TTL */
+static int
+refresh_map_request_cb(lmtimer_t *timer)
+{
+    timer_map_req_argument *timer_arg = (timer_map_req_argument *)lmtimer_cb_argument(timer);
+    nonces_list_t *nonces_list = lmtimer_nonces(timer);
+    lisp_xtr_t *xtr = lmtimer_owner(timer);
+    lisp_addr_t *deid = mapping_eid(mcache_entry_mapping(timer_arg->mce));
+    glist_t *eids;
+    uint64_t nonce;
+    int retries = nonces_list_size(nonces_list);
+    int ret;
+
+    if (retries - 1 >= xtr->map_request_retries) {
+        LMLOG(LDBG_1, "No Map-Reply refreshing EID %s after %d retries",
+                lisp_addr_to_char(deid), retries - 1);
+        goto stop;
+    }
+
+    nonce = nonce_new();
+    eids = glist_new();
+    glist_add(deid, eids);
+    ret = build_and_send_map_request(xtr, &timer_arg->src_eid, eids, nonce);
+    glist_destroy(eids);
+    if (ret != GOOD) {
+        goto stop;
+    }
+    htable_nonces_insert(nonces_ht, nonce, nonces_list);
+    lmtimer_start(timer, LISPD_INITIAL_MRQ_TIMEOUT);
+    return (GOOD);
+
+stop:
+    /* Detach the timer and its nonces from the entry, so that the next
+     * refresh sends a new request */
+    stop_timer_from_obj(timer_arg->mce, timer, ptrs_to_timers_ht, nonces_ht);
+    return (BAD);
+}
+
+/* Sends a Map-Request with a record for each EID of 'eids' */
 static int
 build_and_send_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
-        mcache_entry_t *mce, uint64_t nonce)
+        glist_t *eids, uint64_t nonce)
 {
     uconn_t uc;
-    mapping_t *m = NULL;
     lisp_addr_t *deid = NULL;
     lisp_addr_t *drloc, *srloc;
     glist_t *rlocs = NULL;
+    glist_entry_t *it;
     lbuf_t *b = NULL;
     void *mr_hdr = NULL;
 
@@ -1008,8 +1360,8 @@ build_and_send_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
         return (BAD);
     }
 
-    m = mcache_entry_mapping(mce);
-    deid = mapping_eid(m);
+    /* The first EID is also the destination of the encapsulated message */
+    deid = (lisp_addr_t *)glist_first_data(eids);
 
     /* BUILD Map-Request */
 
@@ -1021,12 +1373,18 @@ build_and_send_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
         glist_destroy(rlocs);
         return(BAD);
     }
+    glist_for_each_entry(it, eids) {
+        if (it != glist_first(eids)) {
+            lisp_msg_put_eid_rec(b, glist_entry_data(it));
+        }
+    }
 
     mr_hdr = lisp_msg_hdr(b);
     MREQ_NONCE(mr_hdr) = nonce;
-    LMLOG(LDBG_1, "%s, itr-rlocs:%s, src-eid: %s, req-eid: %s",
+    LMLOG(LDBG_1, "%s, itr-rlocs:%s, src-eid: %s",
             lisp_msg_hdr_to_char(b), laddr_list_to_char(rlocs),
-            lisp_addr_to_char(seid), lisp_addr_to_char(deid));
+            lisp_addr_to_char(seid));
+    LMLOG(LDBG_1, "  req-eids: %s", laddr_list_to_char(eids));
     glist_destroy(rlocs);
 
 
@@ -1049,42 +1407,67 @@ build_and_send_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
     return(GOOD);
 }
 
-/* build and send generic map-register with one record
- * for each map server */
+/* Send the records of the local mappings not confirmed yet by the map server
+ * in the current round or, if 'dirty' is not NULL, the ones in 'dirty'.
+ * They are packed in as few Map-Registers as possible, all with the same
+ * nonce and each signed once. Returns the number of records sent */
 static int
-build_and_send_map_reg(lisp_xtr_t * xtr, mapping_t * m, map_server_elt *ms,
-        uint64_t nonce)
+build_and_send_map_regs(lisp_xtr_t *xtr, map_server_elt *ms, uint64_t nonce,
+        htable_ptrs_t *dirty)
 {
-    lbuf_t * b = NULL;
-    void * hdr = NULL;
-    lisp_addr_t * drloc = NULL;
+    void *map_local_entry_it;
+    map_local_entry_t *mle;
+    lbuf_t *b = NULL;
+    void *hdr;
     uconn_t uc;
+    int n_recs = 0;
 
+    uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, ms->address);
 
-    b = lisp_msg_mreg_create(m, ms->key_type);
-
-    if (!b) {
-        return(BAD);
-    }
-
-    hdr = lisp_msg_hdr(b);
-    MREG_PROXY_REPLY(hdr) = ms->proxy_reply;
-    MREG_NONCE(hdr) = nonce;
+    local_map_db_foreach_entry(xtr->local_mdb, map_local_entry_it) {
+        mle = (map_local_entry_t *)map_local_entry_it;
+        if (dirty ? !htable_ptrs_lookup(dirty, mle)
+                : htable_ptrs_lookup(ms->mreg_acked, mle) != NULL) {
+            continue;
+        }
+        if (b && !lisp_msg_mreg_put_mapping(b, map_local_entry_mapping(mle),
+                MAP_REGISTER_MAX_LEN)) {
+            /* Full, send it and start a new one */
+            if (lisp_msg_fill_auth_data_key(b, ms->hmac_key) == GOOD) {
+                LMLOG(LDBG_1, "%s, MS: %s", lisp_msg_hdr_to_char(b),
+                        lisp_addr_to_char(ms->address));
+                send_msg(&xtr->super, b, &uc);
+            }
+            lisp_msg_destroy(b);
+            b = NULL;
+        }
+        if (!b) {
+            b = lisp_msg_mreg_create(NULL, ms->key_type);
+            if (!b) {
+                return(n_recs);
+            }
+            hdr = lisp_msg_hdr(b);
+            MREG_PROXY_REPLY(hdr) = ms->proxy_reply;
+            MREG_NONCE(hdr) = nonce;
+            lisp_msg_mreg_put_mapping(b, map_local_entry_mapping(mle),
+                    MAP_REGISTER_MAX_LEN);
+        }
+        LMLOG(LDBG_2, "Map-Register of EID %s to %s",
+                lisp_addr_to_char(map_local_entry_eid(mle)),
+                lisp_addr_to_char(ms->address));
+        n_recs++;
+    } local_map_db_foreach_end;
 
-    if (lisp_msg_fill_auth_data(b, ms->key_type,
-            ms->key) != GOOD) {
-        return(BAD);
+    if (b) {
+        if (lisp_msg_fill_auth_data_key(b, ms->hmac_key) == GOOD) {
+            LMLOG(LDBG_1, "%s, MS: %s", lisp_msg_hdr_to_char(b),
+                    lisp_addr_to_char(ms->address));
+            send_msg(&xtr->super, b, &uc);
+        }
+        lisp_msg_destroy(b);
     }
-    drloc =  ms->address;
-    LMLOG(LDBG_1, "%s, EID: %s, MS: %s", lisp_msg_hdr_to_char(b),
-            lisp_addr_to_char(mapping_eid(m)), lisp_addr_to_char(drloc));
-
-    uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, drloc);
-    send_msg(&xtr->super, b, &uc);
-
-    lisp_msg_destroy(b);
 
-    return(GOOD);
+    return(n_recs);
 }
 
 //static int
@@ -1137,55 +1520,72 @@ build_and_send_map_reg(lisp_xtr_t * xtr, mapping_t * m, map_server_elt *ms,
 //    return(GOOD);
 //}
 
+/* Program the next registration round with the map server. The interval
+ * varies randomly by +/- map_register_jitter % so that the rounds of
+ * different map servers and xTRs don't synchronize */
+static void
+map_register_next_round(map_server_elt *ms)
+{
+    int interval = MAP_REGISTER_INTERVAL * 1000;
+    int jitter = interval / 100 * map_register_jitter;
+
+    if (jitter > 0) {
+        interval += random() % (2 * jitter + 1) - jitter;
+    }
+
+    htable_nonces_reset_nonces_lst(nonces_ht, lmtimer_nonces(ms->mreg_timer));
+    ms->mreg_pending = 0;
+    ms->mreg_new_round = TRUE;
+    lmtimer_start_ms(ms->mreg_timer, interval);
+}
+
 static int
 map_register_cb(lmtimer_t *timer)
 {
-    timer_map_reg_argument *timer_arg = lmtimer_cb_argument(timer);
+    map_server_elt *ms = lmtimer_cb_argument(timer);
     nonces_list_t *nonces_lst = lmtimer_nonces(timer);
     lisp_xtr_t *xtr = lmtimer_owner(timer);
-    mapping_t *map = map_local_entry_mapping(timer_arg->mle);
-    map_server_elt *ms = timer_arg->ms;
     uint64_t nonce;
 
+    if (ms->mreg_new_round) {
+        htable_ptrs_clear(ms->mreg_acked);
+        ms->mreg_new_round = FALSE;
+    }
+
     if ((nonces_list_size(nonces_lst) -1) < xtr->probe_retries){
         nonce = nonce_new();
-        if (build_and_send_map_reg(xtr, map, ms, nonce) != GOOD){
-            return (BAD);
+        ms->mreg_pending = build_and_send_map_regs(xtr, ms, nonce, NULL);
+        if (ms->mreg_pending == 0) {
+            map_register_next_round(ms);
+            return (GOOD);
         }
         if (nonces_list_size(nonces_lst) > 0) {
-            LMLOG(LDBG_1,"Sent Retry Map-Register for mapping %s to %s "
-                    "(%d retries)", lisp_addr_to_char(mapping_eid(map)),
+            LMLOG(LDBG_1,"Sent Retry Map-Register of %d mappings to %s "
+                    "(%d retries)", ms->mreg_pending,
                     lisp_addr_to_char(ms->address), nonces_list_size(nonces_lst));
         } else {
-            LMLOG(LDBG_1,"Sent Map-Register for mapping %s to %s "
-                    , lisp_addr_to_char(mapping_eid(map)),
-                    lisp_addr_to_char(ms->address));
+            LMLOG(LDBG_1,"Sent Map-Register of %d mappings to %s",
+                    ms->mreg_pending, lisp_addr_to_char(ms->address));
         }
         htable_nonces_insert(nonces_ht, nonce,nonces_lst);
         lmtimer_start(timer, LISPD_INITIAL_MREG_TIMEOUT);
         return (GOOD);
     }else{
-        /* If we have reached maximum number of retransmissions, change remote
-         *  locator status */
-
         /* Reprogram time for next Map Register interval */
-        htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        lmtimer_start(timer, MAP_REGISTER_INTERVAL);
-        LMLOG(LWRN,"Map Register of %s to %s not received reply. Retry in %d seconds",
-                lisp_addr_to_char(mapping_eid(map)), lisp_addr_to_char(ms->address),
-                MAP_REGISTER_INTERVAL);
+        LMLOG(LWRN,"Map Register of %d mappings to %s not received reply. "
+                "Retry in %d seconds", ms->mreg_pending,
+                lisp_addr_to_char(ms->address), MAP_REGISTER_INTERVAL);
+        map_register_next_round(ms);
 
         return (BAD);
     }
 }
 
+/* Start a registration round of all the local mappings with each map
+ * server */
 int
 program_map_register(lisp_xtr_t *xtr)
 {
-    void *map_local_entry_it;
-    map_local_entry_t *mle;
-    lmtimer_t *timer;
-    timer_map_reg_argument *timer_arg;
     map_server_elt *ms;
     glist_entry_t *ms_it;
 
@@ -1193,29 +1593,69 @@ program_map_register(lisp_xtr_t *xtr)
         return (BAD);
     }
 
-    local_map_db_foreach_entry(xtr->local_mdb, map_local_entry_it) {
-        mle = (map_local_entry_t *)map_local_entry_it;
-        /* Cancel timers associated to the map register of the local map entry */
-        stop_timers_of_type_from_obj(mle,MAP_REGISTER_TIMER,ptrs_to_timers_ht, nonces_ht);
-        /* Configure map register for each map server */
-        glist_for_each_entry(ms_it,xtr->map_servers){
-            ms = (map_server_elt *)glist_entry_data(ms_it);
-            timer_arg = timer_map_reg_argument_new_init(mle,ms);
-            timer = lmtimer_with_nonce_new(MAP_REGISTER_TIMER, xtr, map_register_cb,
-                    timer_arg,(lmtimer_del_cb_arg_fn)timer_map_reg_arg_free);
-            htable_ptrs_timers_add(ptrs_to_timers_ht, mle, timer);
-            map_register_cb(timer);
-        }
-    } local_map_db_foreach_end;
+    glist_for_each_entry(ms_it,xtr->map_servers){
+        ms = (map_server_elt *)glist_entry_data(ms_it);
+        /* Cancel the current round and the pending changes, the new round
+         * registers all the mappings */
+        stop_timers_of_type_from_obj(ms,MAP_REGISTER_TIMER,ptrs_to_timers_ht, nonces_ht);
+        ms->mreg_upd_timer = NULL;
+        htable_ptrs_clear(ms->mreg_dirty);
+        ms->mreg_timer = lmtimer_with_nonce_new(MAP_REGISTER_TIMER, xtr,
+                map_register_cb, ms, NULL);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, ms, ms->mreg_timer);
+        ms->mreg_new_round = TRUE;
+        map_register_cb(ms->mreg_timer);
+    }
 
     return(GOOD);
 }
 
+static void
+map_register_upd_stop(map_server_elt *ms)
+{
+    stop_timer_from_obj(ms, ms->mreg_upd_timer, ptrs_to_timers_ht, nonces_ht);
+    ms->mreg_upd_timer = NULL;
+    htable_ptrs_clear(ms->mreg_dirty);
+}
+
+static int
+map_register_upd_cb(lmtimer_t *timer)
+{
+    map_server_elt *ms = lmtimer_cb_argument(timer);
+    nonces_list_t *nonces_lst = lmtimer_nonces(timer);
+    lisp_xtr_t *xtr = lmtimer_owner(timer);
+    uint64_t nonce;
+    int n_recs;
+
+    if ((nonces_list_size(nonces_lst) -1) < xtr->probe_retries){
+        nonce = nonce_new();
+        n_recs = build_and_send_map_regs(xtr, ms, nonce, ms->mreg_dirty);
+        if (n_recs == 0) {
+            map_register_upd_stop(ms);
+            return (GOOD);
+        }
+        LMLOG(LDBG_1,"Sent Map-Register of %d changed mappings to %s "
+                "(%d retries)", n_recs, lisp_addr_to_char(ms->address),
+                nonces_list_size(nonces_lst));
+        htable_nonces_insert(nonces_ht, nonce,nonces_lst);
+        lmtimer_start(timer, LISPD_INITIAL_MREG_TIMEOUT);
+        return (GOOD);
+    }else{
+        /* They are registered again with the next round */
+        LMLOG(LWRN,"Map Register of %d changed mappings to %s not received "
+                "reply", htable_ptrs_size(ms->mreg_dirty),
+                lisp_addr_to_char(ms->address));
+        map_register_upd_stop(ms);
+        return (BAD);
+    }
+}
+
+/* Register again a local mapping that has changed. The mappings that change
+ * together are sent in the same Map-Registers on the next tick of the timers.
+ * This is independent of the rounds, that keep their schedule */
 int
 program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle)
 {
-    lmtimer_t *timer;
-    timer_map_reg_argument *timer_arg;
     map_server_elt *ms;
     glist_entry_t *ms_it;
 
@@ -1223,16 +1663,22 @@ program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle)
         return (BAD);
     }
 
-    /* Cancel timers associated to the map register of the local map entry */
-    stop_timers_of_type_from_obj(mle,MAP_REGISTER_TIMER,ptrs_to_timers_ht, nonces_ht);
-    /* Configure map register for each map server */
     glist_for_each_entry(ms_it,xtr->map_servers){
         ms = (map_server_elt *)glist_entry_data(ms_it);
-        timer_arg = timer_map_reg_argument_new_init(mle,ms);
-        timer = lmtimer_with_nonce_new(MAP_REGISTER_TIMER, xtr, map_register_cb,
-                timer_arg,(lmtimer_del_cb_arg_fn)timer_map_reg_arg_free);
-        htable_ptrs_timers_add(ptrs_to_timers_ht, mle, timer);
-        map_register_cb(timer);
+        if (!ms->mreg_timer) {
+            continue;
+        }
+        htable_ptrs_insert(ms->mreg_dirty, mle, mle);
+        if (!ms->mreg_upd_timer) {
+            ms->mreg_upd_timer = lmtimer_with_nonce_new(MAP_REGISTER_TIMER,
+                    xtr, map_register_upd_cb, ms, NULL);
+            htable_ptrs_timers_add(ptrs_to_timers_ht, ms, ms->mreg_upd_timer);
+        } else {
+            /* Send all the changes again, with new retries */
+            htable_nonces_reset_nonces_lst(nonces_ht,
+                    lmtimer_nonces(ms->mreg_upd_timer));
+        }
+        lmtimer_start_ms(ms->mreg_upd_timer, 0);
     }
 
     return(GOOD);
@@ -1297,6 +1743,7 @@ rloc_probing_cb(lmtimer_t *timer)
                     xtr->fwd_policy_dev_parm,
                     mcache_entry_routing_info(mce),
                     map);
+            tr_mce_fwd_changed(xtr, mce);
         }
 
         /* Reprogram time for next probe interval */
@@ -1428,6 +1875,8 @@ tr_mcache_add_mapping(lisp_xtr_t *xtr, mapping_t *m)
     }
 
     mcache_entry_set_active(mce, ACTIVE);
+    tr_mcache_evict(xtr, mce);
+    fwd_state_changed();
 
     /* Reprogramming timers */
     mc_entry_start_expiration_timer(xtr, mce);
@@ -1464,6 +1913,7 @@ tr_mcache_add_static_mapping(lisp_xtr_t *xtr, mapping_t *m)
                         lisp_addr_to_char(mapping_eid(m)));
         return(BAD);
     }
+    fwd_state_changed();
 
     program_mce_rloc_probing(xtr, mce);
 
@@ -1478,11 +1928,25 @@ tr_mcache_remove_entry(lisp_xtr_t *xtr, mcache_entry_t *mce)
 
     data = mcache_remove_entry(xtr->map_cache, eid);
     mcache_entry_del(data);
+    fwd_state_changed();
     mcache_dump_db(xtr->map_cache, LDBG_3);
 
     return (GOOD);
 }
 
+/* Evict the least recently used dynamic entries, other than 'keep', while
+ * the map cache is beyond its limits */
+static void
+tr_mcache_evict(lisp_xtr_t *xtr, mcache_entry_t *keep)
+{
+    mcache_entry_t *mce;
+
+    while ((mce = mcache_lru_victim(xtr->map_cache, keep)) != NULL) {
+        LMLOG(LDBG_1, "Map cache full. Evicting entry %s",
+                lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))));
+        tr_mcache_remove_entry(xtr, mce);
+    }
+}
 
 mapping_t *
 tr_mcache_lookup_mapping(lisp_xtr_t *xtr, lisp_addr_t *laddr)
@@ -1656,6 +2120,9 @@ xtr_if_event(lisp_ctrl_dev_t *dev, char *iface_name, lisp_addr_t *old_addr,
                             map_local_entry_fwd_info(xtr->all_locs_map),
                             map_local_entry_mapping(xtr->all_locs_map));
     }
+    /* Output sockets and local RLOCs may have changed */
+    fwd_epoch_bump();
+    fwd_state_changed();
 
     LMLOG(LDBG_2,"xtr_if_event: Status of iface %s : Status changed: %s, IPv4 prev address: %s, "
             "IPv6 prev address: %s", if_loct->iface_name, (if_loct->status_changed == TRUE) ? "y":"n",
@@ -1731,7 +2198,16 @@ map_server_elt_new_init(lisp_addr_t *address,uint8_t key_type, char *key,
     ms->address     = lisp_addr_clone(address);
     ms->key_type    = key_type;
     ms->key         = strdup(key);
+    ms->hmac_key    = hmac_key_new(key_type, key);
     ms->proxy_reply = proxy_reply;
+    ms->mreg_acked  = htable_ptrs_new();
+    ms->mreg_dirty  = htable_ptrs_new();
+    if (ms->hmac_key == NULL){
+        LMLOG(LWRN,"Unsupported key type %d of map server %s",key_type,
+                lisp_addr_to_char(address));
+        map_server_elt_del(ms);
+        return (NULL);
+    }
 
     return (ms);
 }
@@ -1742,6 +2218,10 @@ map_server_elt_del (map_server_elt *map_server)
     if (map_server == NULL){
         return;
     }
+    stop_timers_from_obj(map_server, ptrs_to_timers_ht, nonces_ht);
+    htable_ptrs_destroy(map_server->mreg_acked);
+    htable_ptrs_destroy(map_server->mreg_dirty);
+    hmac_key_del(map_server->hmac_key);
     lisp_addr_del (map_server->address);
     free(map_server->key);
     free(map_server);
@@ -1778,6 +2258,7 @@ xtr_ctrl_construct(lisp_ctrl_dev_t *dev)
     xtr->map_cache = mcache_new();
     xtr->map_servers = glist_new_managed((glist_del_fct)map_server_elt_del);
     xtr->map_resolvers = glist_new_managed((glist_del_fct)lisp_addr_del);
+    xtr->mreq_batches = glist_new();
     xtr->pitrs = glist_new_managed((glist_del_fct)lisp_addr_del);
     xtr->petrs = mcache_entry_new();
     xtr->iface_locators_table = shash_new_managed((free_key_fn_t)iface_locators_del);
@@ -1792,6 +2273,9 @@ xtr_ctrl_construct(lisp_ctrl_dev_t *dev)
     map = mapping_new_init(&addr);
     mcache_entry_init_static(xtr->petrs, map);
 
+    /* Used only by data planes forwarding from other threads */
+    fwd_state_set_builder(tr_build_fwd_state, xtr);
+
     LMLOG(LDBG_1, "Finished Constructing xTR");
 
     return(GOOD);
@@ -1804,6 +2288,8 @@ xtr_ctrl_destruct(lisp_ctrl_dev_t *dev)
     void *it = NULL;
     lisp_xtr_t *xtr = lisp_xtr_cast(dev);
 
+    fwd_state_set_builder(NULL, NULL);
+
     local_map_db_foreach_entry(xtr->local_mdb, it) {
         map_loc_e = (map_local_entry_t *)it;
         ctrl_unregister_eid_prefix(dev,map_local_entry_eid(map_loc_e));
@@ -1814,6 +2300,10 @@ xtr_ctrl_destruct(lisp_ctrl_dev_t *dev)
     }
 
     shash_destroy(xtr->iface_locators_table);
+    while (glist_size(xtr->mreq_batches) > 0) {
+        tr_mreq_batch_stop(xtr, glist_first_data(xtr->mreq_batches));
+    }
+    glist_destroy(xtr->mreq_batches);
     mcache_del(xtr->map_cache);
     mcache_entry_del(xtr->petrs);
     local_map_db_del(xtr->local_mdb);
@@ -1977,6 +2467,9 @@ xtr_ctrl_run(lisp_ctrl_dev_t *dev)
 {
     lisp_xtr_t *xtr = lisp_xtr_cast(dev);
 
+    mcache_set_limits(xtr->map_cache, map_cache_max_entries,
+            (size_t)map_cache_max_memory * 1024);
+
     if (xtr->super.mode == xTR_MODE || xtr->super.mode == MN_MODE) {
         xtr_run(xtr);
     } else if (xtr->super.mode == RTR_MODE) {
@@ -1994,7 +2487,8 @@ ctrl_dev_class_t xtr_ctrl_class = {
         .run = xtr_ctrl_run,
         .recv_msg = xtr_recv_msg,
         .if_event = xtr_if_event,
-        .get_fwd_entry = tr_get_forwarding_entry
+        .get_fwd_entry = tr_get_forwarding_entry,
+        .queue_packet = tr_queue_packet
 };
 
 
@@ -2101,6 +2595,7 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
         LMLOG(LWRN, "tr_get_fwd_entry: Couldn't allocate memory for fwd_info_t");
         return (NULL);
     }
+    fwd_info->epoch = fwd_epoch_get();
 
     if (xtr->super.mode == xTR_MODE || xtr->super.mode == MN_MODE) {
         /* lookup local mapping for source EID */
@@ -2112,8 +2607,19 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
     }else {
         map_loc_e = xtr->all_locs_map;
     }
+    fwd_info_add_gen(fwd_info, map_local_entry_gen(map_loc_e),
+            fwd_gen_get(map_local_entry_gen(map_loc_e)));
 
     mce = mcache_lookup(xtr->map_cache, &tuple->dst_addr);
+    if (mce) {
+        fwd_info_add_gen(fwd_info, mcache_entry_gen(mce),
+                fwd_gen_get(mcache_entry_gen(mce)));
+    } else {
+        /* Taken before handling the miss: the new map-cache entry has to
+         * invalidate this info */
+        fwd_info_add_gen(fwd_info, mcache_miss_gen(xtr->map_cache),
+                fwd_gen_get(mcache_miss_gen(xtr->map_cache)));
+    }
 
     if (!mce) {
         fwd_info->temporal = TRUE;
@@ -2181,6 +2687,38 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
 }
 
 
+/* Snapshot of the map-cache and local mappings to be published to the
+ * data plane threads */
+static fwd_state_t *
+tr_build_fwd_state(void *arg)
+{
+    lisp_xtr_t *xtr = (lisp_xtr_t *)arg;
+    fwd_state_t *fs;
+    map_local_entry_t *map_loc_e;
+    void *it;
+
+    fs = fwd_state_new(xtr->fwd_policy, xtr->fwd_policy_dev_parm);
+
+    if (xtr->super.mode == xTR_MODE || xtr->super.mode == MN_MODE) {
+        local_map_db_foreach_entry(xtr->local_mdb, it) {
+            map_loc_e = (map_local_entry_t *)it;
+            fwd_state_add_local_entry(fs, map_loc_e);
+        } local_map_db_foreach_end;
+    } else {
+        fwd_state_set_all_locs(fs, xtr->all_locs_map);
+    }
+
+    mdb_foreach_entry(xtr->map_cache->db, it) {
+        fwd_state_add_mcache_entry(fs, (mcache_entry_t *)it);
+    } mdb_foreach_entry_end;
+
+    fwd_state_set_petrs(fs, xtr->petrs);
+    fwd_state_add_rlocs(fs, ctrl_rlocs(xtr->super.ctrl));
+    fwd_state_set_default_socks(fs);
+
+    return (fs);
+}
+
 static fwd_info_t *
 tr_get_forwarding_entry(lisp_ctrl_dev_t *dev, packet_tuple_t *tuple)
 {
@@ -2191,6 +2729,30 @@ tr_get_forwarding_entry(lisp_ctrl_dev_t *dev, packet_tuple_t *tuple)
     return(tr_get_fwd_entry(xtr, tuple));
 }
 
+/* Keep a packet in the NOT_ACTIVE map-cache entry of its destination until
+ * the Map-Reply arrives */
+static int
+tr_queue_packet(lisp_ctrl_dev_t *dev, packet_tuple_t *tuple, lbuf_t *b)
+{
+    lisp_xtr_t *xtr;
+    mcache_entry_t *mce;
+
+    xtr = lisp_xtr_cast(dev);
+
+    mce = mcache_lookup(xtr->map_cache, &tuple->dst_addr);
+    if (!mce || mcache_entry_active(mce) != NOT_ACTIVE) {
+        return (BAD);
+    }
+
+    if (mcache_entry_queue_packet(mce, b, pending_packets_per_eid,
+            (uint32_t)pending_packets_memory * 1024) != GOOD) {
+        return (BAD);
+    }
+    LMLOG(LDBG_3, "Packet to %s queued until its mapping is resolved",
+            lisp_addr_to_char(&tuple->dst_addr));
+    return (GOOD);
+}
+
 /*
  * Return the list of locators from the local mappings containing addr
  * @param local_db Database where to search locators
@@ -2367,7 +2929,7 @@ mapping_has_elp_with_l_bit(mapping_t *map)
 timer_rloc_probe_argument *
 timer_rloc_probe_argument_new_init(mcache_entry_t *mce,locator_t *locator)
 {
-    timer_rloc_probe_argument *timer_arg = xmalloc(sizeof(timer_rloc_probe_argument));
+    timer_rloc_probe_argument *timer_arg = obj_pool_alloc(&rloc_probe_args_pool);
     timer_arg->mce = mce;
     timer_arg->locator = locator;
     return (timer_arg);
@@ -2375,15 +2937,15 @@ timer_rloc_probe_argument_new_init(mcache_entry_t *mce,locator_t *locator)
 
 void
 timer_rloc_probe_argument_free(timer_rloc_probe_argument *timer_arg){
-    free (timer_arg);
+    obj_pool_free(&rloc_probe_args_pool, timer_arg);
 }
 
 timer_map_req_argument *
 timer_map_req_arg_new_init(mcache_entry_t *mce,lisp_addr_t *src_eid)
 {
-    timer_map_req_argument *timer_arg = xmalloc(sizeof(timer_map_req_argument));
+    timer_map_req_argument *timer_arg = obj_pool_alloc(&map_req_args_pool);
     timer_arg->mce = mce;
-    timer_arg->src_eid = lisp_addr_clone(src_eid);
+    lisp_addr_copy(&timer_arg->src_eid, src_eid);
 
     return(timer_arg);
 }
@@ -2391,23 +2953,25 @@ timer_map_req_arg_new_init(mcache_entry_t *mce,lisp_addr_t *src_eid)
 void
 timer_map_req_arg_free(timer_map_req_argument * timer_arg)
 {
-    lisp_addr_del(timer_arg->src_eid);
-    free(timer_arg);
+    lisp_addr_dealloc(&timer_arg->src_eid);
+    obj_pool_free(&map_req_args_pool, timer_arg);
 }
 
-timer_map_reg_argument *
-timer_map_reg_argument_new_init(map_local_entry_t *mle,
-        map_server_elt *ms)
+static mreq_batch_t *
+mreq_batch_new(lisp_addr_t *src_eid)
 {
-    timer_map_reg_argument *timer_arg = xmalloc(sizeof(timer_map_reg_argument));
-    timer_arg->mle = mle;
-    timer_arg->ms = ms;
+    mreq_batch_t *batch = xzalloc(sizeof(mreq_batch_t));
+    lisp_addr_copy(&batch->src_eid, src_eid);
+    batch->eids = glist_new_complete((glist_cmp_fct)lisp_addr_cmp,
+            (glist_del_fct)lisp_addr_del);
 
-    return(timer_arg);
+    return(batch);
 }
 
-void
-timer_map_reg_arg_free(timer_map_reg_argument * timer_arg)
+static void
+mreq_batch_del(mreq_batch_t *batch)
 {
-    free(timer_arg);
+    lisp_addr_dealloc(&batch->src_eid);
+    glist_destroy(batch->eids);
+    free(batch);
 }
@@ -76,6 +76,9 @@ typedef struct lisp_xtr {
     /* TIMERS */
     lmtimer_t *smr_timer;
 
+    /* Map-Requests of map cache misses not answered yet */
+    glist_t *mreq_batches; // <mreq_batch_t *>
+
     /* MAPPING IFACE TO LOCATORS */
     shash_t *iface_locators_table; /* Key: Iface name, Value: iface_locators */
 
@@ -88,7 +91,21 @@ typedef struct map_server_elt_t {
     lisp_addr_t *   address;
     uint8_t         key_type;
     char *          key;
+    hmac_key_t *    hmac_key;       /* Precomputed from key */
     uint8_t         proxy_reply;
+
+    /* Registration of the local mappings with this map server. All of them
+     * are sent every round, packed in as few Map-Registers as possible.
+     * Retransmissions only carry the records not confirmed yet */
+    lmtimer_t *     mreg_timer;
+    htable_ptrs_t * mreg_acked;     /* Key: map_local_entry_t confirmed by a Map-Notify */
+    int             mreg_pending;   /* Records sent and not confirmed yet */
+    uint8_t         mreg_new_round; /* Next expiration registers all the mappings */
+
+    /* Registration of the local mappings that changed, out of the rounds.
+     * It has its own nonces and retries and doesn't move the next round */
+    lmtimer_t *     mreg_upd_timer;
+    htable_ptrs_t * mreg_dirty;     /* Key: changed map_local_entry_t not confirmed yet */
 } map_server_elt;
 
 typedef struct _timer_rloc_prob_argument {
@@ -98,13 +115,18 @@ typedef struct _timer_rloc_prob_argument {
 
 typedef struct _timer_map_req_argument {
     mcache_entry_t  *mce;
-    lisp_addr_t     *src_eid;
+    lisp_addr_t     src_eid;
 } timer_map_req_argument;
 
-typedef struct _timer_map_reg_argument {
-    map_local_entry_t  *mle;
-    map_server_elt     *ms;
-} timer_map_reg_argument;
+/* Map cache misses of a source EID requested with the same Map-Request.
+ * Misses arriving within the coalescing window join the batch before it is
+ * sent. Afterwards all of them share its nonces and retransmissions */
+typedef struct _mreq_batch {
+    lisp_addr_t     src_eid;
+    glist_t *       eids;       /* <lisp_addr_t *> EIDs not resolved yet */
+    lmtimer_t *     timer;
+    uint8_t         sent;
+} mreq_batch_t;
 
 map_server_elt * map_server_elt_new_init(lisp_addr_t *address,uint8_t key_type,
         char *key, uint8_t proxy_reply);
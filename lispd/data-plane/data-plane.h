@@ -34,6 +34,9 @@ typedef struct data_plane_struct {
     int (*datap_input_packet)(sock_t *sl);
     int (*datap_rtr_input_packet)(sock_t *sl);
     int (*datap_output_packet)(sock_t *sl);
+    /* forward a packet queued until its destination was resolved. The
+     * packet is not released */
+    int (*datap_output_queued)(lbuf_t *b);
     int (*datap_updated_route)(int command, iface_t *iface, lisp_addr_t *src_pref,
             lisp_addr_t *dst_pref, lisp_addr_t *gw);
     int (*datap_updated_addr)(iface_t *iface,lisp_addr_t *old_addr,lisp_addr_t *new_addr);
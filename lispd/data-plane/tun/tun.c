@@ -25,8 +25,10 @@
 #include "tun.h"
 #include "tun_input.h"
 #include "tun_output.h"
+#include "tun_worker.h"
 #include "../data-plane.h"
 #include "../../lispd_external.h"
+#include "../../control/lisp_fwd_state.h"
 #include "../../lib/lmlog.h"
 #include "../../lib/routing_tables_lib.h"
 
@@ -41,6 +43,7 @@ int configure_routing_to_tun_router(int afi);
 //int configure_routing_to_tun_mn(lisp_addr_t *eid_addr);
 int remove_routing_to_tun_mn(lisp_addr_t *eid_addr);
 int create_tun();
+int tun_open_queue();
 int configure_routing_to_tun_mn(lisp_addr_t *eid_addr);
 int tun_bring_up_iface();
 int tun_add_eid_to_iface(lisp_addr_t *addr);
@@ -67,6 +70,7 @@ data_plane_struct_t dplane_tun = {
         .datap_input_packet = tun_process_input_packet,
         .datap_rtr_input_packet = tun_rtr_process_input_packet,
         .datap_output_packet = tun_output_recv,
+        .datap_output_queued = tun_output_queued,
         .datap_updated_route = tun_updated_route,
         .datap_updated_addr = tun_updated_addr,
         .datap_update_link = tun_updated_link,
@@ -81,8 +85,14 @@ int
 tun_configure_data_plane(lisp_dev_type_e dev_type, ...)
 {
     int (*cb_func)(sock_t *) = NULL;
+    tun_dplane_data_t *data;
+    tun_worker_t *worker;
+    int read_tun = TRUE;
+    int threaded = (data_plane_threads > 0);
+    int num_workers = threaded ? data_plane_threads : 1;
     int ipv4_data_input_fd = -1;
     int ipv6_data_input_fd = -1;
+    int tun_fd, i;
 
     /* Configure data plane */
     if (create_tun() <= BAD){
@@ -91,7 +101,6 @@ tun_configure_data_plane(lisp_dev_type_e dev_type, ...)
 
     switch (dev_type){
     case MN_MODE:
-        sockmstr_register_read_listener(smaster, tun_output_recv, NULL,tun_receive_fd);
         cb_func = tun_process_input_packet;
         break;
     case xTR_MODE:
@@ -99,35 +108,76 @@ tun_configure_data_plane(lisp_dev_type_e dev_type, ...)
         /* Rules created for EID will redirect traffic to this table*/
         configure_routing_to_tun_router(AF_INET);
         configure_routing_to_tun_router(AF_INET6);
-        sockmstr_register_read_listener(smaster, tun_output_recv, NULL,tun_receive_fd);
         cb_func = tun_process_input_packet;
         break;
     case RTR_MODE:
         cb_func = tun_rtr_process_input_packet;
+        read_tun = FALSE;
         break;
     default:
         return (BAD);
     }
 
-    /* Generate receive sockets for data port (4341) */
-    if (default_rloc_afi != AF_INET6) {
-        ipv4_data_input_fd = open_data_raw_input_socket(AF_INET);
-        sockmstr_register_read_listener(smaster, cb_func, NULL,
-                ipv4_data_input_fd);
-    }
+    data = (tun_dplane_data_t *)xzalloc(sizeof(tun_dplane_data_t));
+    dplane_tun.datap_data = (void *)data;
 
-    if (default_rloc_afi != AF_INET) {
-        ipv6_data_input_fd = open_data_raw_input_socket(AF_INET6);
-        sockmstr_register_read_listener(smaster, cb_func, NULL,
-                ipv6_data_input_fd);
+    for (i = 0; i < num_workers; i++) {
+        /* Each worker thread uses its own queue of the tun */
+        tun_fd = tun_receive_fd;
+        if (i > 0 && read_tun) {
+            if ((tun_fd = tun_open_queue()) == ERR_SOCKET) {
+                return (BAD);
+            }
+        }
+
+        worker = tun_worker_new(i, tun_fd, threaded);
+        if (worker == NULL) {
+            return (BAD);
+        }
+        data->workers[data->num_workers++] = worker;
+
+        if (read_tun) {
+            sockmstr_register_read_listener(worker->smaster, tun_output_recv,
+                    worker, tun_fd);
+        }
+
+        /* Generate receive sockets for data port (4341). Raw sockets receive a
+         * copy of every packet, worker threads share the port instead */
+        worker->dgram_input = threaded;
+        if (default_rloc_afi != AF_INET6) {
+            ipv4_data_input_fd = threaded ?
+                    open_data_reuseport_input_socket(AF_INET) :
+                    open_data_raw_input_socket(AF_INET);
+            sockmstr_register_read_listener(worker->smaster, cb_func, worker,
+                    ipv4_data_input_fd);
+        }
+
+        if (default_rloc_afi != AF_INET) {
+            ipv6_data_input_fd = threaded ?
+                    open_data_reuseport_input_socket(AF_INET6) :
+                    open_data_raw_input_socket(AF_INET6);
+            sockmstr_register_read_listener(worker->smaster, cb_func, worker,
+                    ipv6_data_input_fd);
+        }
     }
-    dplane_tun.datap_data = (void *)xmalloc(sizeof(tun_dplane_data_t));
-    tun_output_init();
 
     /* Select the default rlocs for output data packets and output control
      * packets */
     tun_set_default_output_ifaces();
 
+    if (threaded) {
+        /* Workers forward using the state published by the control thread */
+        if (fwd_state_enable() != GOOD) {
+            return (BAD);
+        }
+        for (i = 0; i < data->num_workers; i++) {
+            if (tun_worker_start(data->workers[i]) != GOOD) {
+                return (BAD);
+            }
+        }
+        LMLOG(LDBG_1, "Data plane running in %d threads", data->num_workers);
+    }
+
     return (GOOD);
 
 }
@@ -136,7 +186,15 @@ void
 tun_uninit_data_plane()
 {
     tun_dplane_data_t *data = (tun_dplane_data_t *)dplane_tun.datap_data;
-    tun_output_uninit();
+    int i;
+
+    if (!data) {
+        return;
+    }
+    for (i = 0; i < data->num_workers; i++) {
+        tun_worker_del(data->workers[i]);
+    }
+    fwd_state_disable();
     free(data);
 }
 
@@ -244,6 +302,20 @@ tun_remove_eid_prefix(lisp_dev_type_e dev_type, lisp_addr_t *eid_prefix){
 
 
 
+/* Batched reads drain the tun until no packet is left */
+static int
+tun_set_nonblocking(int fd)
+{
+    if (data_batch_size > 1) {
+        if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
+            LMLOG(LCRIT, "TUN/TAP: unable to set non-blocking mode: %s",
+                    strerror(errno));
+            return(BAD);
+        }
+    }
+    return (GOOD);
+}
+
 int
 create_tun()
 {
@@ -253,6 +325,11 @@ create_tun()
     int flags = IFF_TUN | IFF_NO_PI; // Create a tunnel without persistence
     char *clonedev = CLONEDEV;
 
+    /* Data plane threads read from different queues of the tun */
+    if (data_plane_threads > 0) {
+        flags |= IFF_MULTI_QUEUE;
+    }
+
 
     /* Arguments taken by the function:
      *
@@ -307,6 +384,10 @@ create_tun()
 
     close(tmpsocket);
 
+    if (tun_set_nonblocking(tun_receive_fd) != GOOD) {
+        return(BAD);
+    }
+
     tun_receive_buf = (uint8_t *)malloc(TUN_RECEIVE_SIZE);
 
     if (tun_receive_buf == NULL){
@@ -325,6 +406,40 @@ create_tun()
     return (tun_receive_fd);
 }
 
+/* Attach a new queue to the multi-queue tun created by create_tun. Returns
+ * its file descriptor */
+int
+tun_open_queue()
+{
+    struct ifreq ifr;
+    int fd;
+
+    if ((fd = open(CLONEDEV, O_RDWR)) < 0) {
+        LMLOG(LCRIT, "TUN/TAP: Failed to open clone device");
+        return(ERR_SOCKET);
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TUN | IFF_NO_PI | IFF_MULTI_QUEUE;
+    strncpy(ifr.ifr_name, TUN_IFACE_NAME, IFNAMSIZ - 1);
+
+    if (ioctl(fd, TUNSETIFF, (void *) &ifr) < 0) {
+        LMLOG(LCRIT, "TUN/TAP: Failed to attach queue to tunnel interface: %s",
+                strerror(errno));
+        close(fd);
+        return(ERR_SOCKET);
+    }
+
+    if (tun_set_nonblocking(fd) != GOOD) {
+        close(fd);
+        return(ERR_SOCKET);
+    }
+
+    LMLOG(LDBG_2, "Tunnel queue fd is %d", fd);
+
+    return (fd);
+}
+
 /*
 * For mobile node mode, we create two /1 routes covering the full IP addresses space to route all traffic
 * generated by the node to the lispTun0 interface
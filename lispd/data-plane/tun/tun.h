@@ -38,6 +38,10 @@
 
 #define TUN_IFACE_NAME          "lispTun0"
 
+#ifndef IFF_MULTI_QUEUE
+#define IFF_MULTI_QUEUE         0x0100
+#endif
+
 #define TUN_RECEIVE_SIZE        2048 // Should probably tune to match largest MTU
 
 /*
@@ -77,10 +81,13 @@ lisp_addr_t * tun_get_default_output_address(int afi);
 int tun_get_default_output_socket(int);
 
 typedef struct iface iface_t;
+typedef struct tun_worker_ tun_worker_t;
 
 typedef struct tun_dplane_data_{
     iface_t *default_out_iface_v4;
     iface_t *default_out_iface_v6;
+    tun_worker_t *workers[MAX_DATA_PLANE_THREADS];
+    int num_workers;
 }tun_dplane_data_t;
 
 extern data_plane_struct_t dplane_tun;
@@ -23,25 +23,21 @@
 #include "tun.h"
 #include "tun_input.h"
 #include "tun_output.h"
+#include "tun_worker.h"
 #include "../../lib/packets.h"
 #include "../../lib/util.h"
 #include "../../liblisp/liblisp.h"
 #include "../../lib/lmlog.h"
 
-/* static buffer to receive packets */
-static uint8_t pkt_recv_buf[MAX_IP_PKT_LEN+1];
-static lbuf_t pkt_buf;
-
-int
-tun_read_and_decap_pkt(int sock, lbuf_t *b)
+static int
+tun_decap_pkt(tun_worker_t *w, lbuf_t *b, int afi, uint8_t ttl, uint8_t tos)
 {
-    uint8_t ttl = 0, tos = 0;
-    int afi;
     lisphdr_t *lisp_hdr;
     struct udphdr *udph;
 
-    if (sock_data_recv(sock, b, &afi, &ttl, &tos) != GOOD) {
-        return(BAD);
+    if (w->dgram_input){
+        /* With input UDP datagram sockets, we get the LISP packet */
+        goto lisp;
     }
 
     if (afi == AF_INET){
@@ -64,6 +60,7 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b)
         return (ERR_NOT_LISP);
     }
 
+lisp:
     lisp_hdr = lisp_data_pull_hdr(b);
 
     /* RESET L3: prepare for output */
@@ -85,17 +82,51 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b)
     return(GOOD);
 }
 
+/* Receive up to data_batch_size packets from 'sock' into the input buffers of
+ * the worker, leaving 'headroom' bytes in front of each of them. Returns the
+ * number of packets received */
+static int
+tun_read_pkts(tun_worker_t *w, int sock, uint32_t headroom)
+{
+    int i, npkts;
+
+    for (i = 0; i < data_batch_size; i++) {
+        lbuf_use_stack(&w->in_buf[i], &w->in_recv_buf[i], MAX_IP_PKT_LEN);
+        lbuf_reserve(&w->in_buf[i], headroom);
+        w->in_ttl[i] = 0;
+        w->in_tos[i] = 0;
+    }
+
+    npkts = sock_data_recv_batch(sock, w->in_buf, data_batch_size, w->in_afi,
+            w->in_ttl, w->in_tos);
+    if (npkts < 0) {
+        return (0);
+    }
+    return (npkts);
+}
+
 int
 tun_process_input_packet(sock_t *sl)
 {
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, MAX_IP_PKT_LEN);
+    tun_worker_t *w = (tun_worker_t *)sl->arg;
+    lbuf_t *b;
+    int i, npkts;
 
-    if (tun_read_and_decap_pkt(sl->fd, &pkt_buf) != GOOD) {
+    npkts = tun_read_pkts(w, sl->fd, 0);
+    if (npkts == 0) {
         return (BAD);
     }
 
-    if ((write(tun_receive_fd, lbuf_l3(&pkt_buf), lbuf_size(&pkt_buf))) < 0) {
-        LMLOG(LDBG_2, "lisp_input: write error: %s\n ", strerror(errno));
+    for (i = 0; i < npkts; i++) {
+        b = &w->in_buf[i];
+        if (tun_decap_pkt(w, b, w->in_afi[i], w->in_ttl[i], w->in_tos[i])
+                != GOOD) {
+            continue;
+        }
+
+        if ((write(w->tun_fd, lbuf_l3(b), lbuf_size(b))) < 0) {
+            LMLOG(LDBG_2, "lisp_input: write error: %s\n ", strerror(errno));
+        }
     }
 
     return (GOOD);
@@ -104,21 +135,32 @@ tun_process_input_packet(sock_t *sl)
 int
 tun_rtr_process_input_packet(struct sock *sl)
 {
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, MAX_IP_PKT_LEN);
+    tun_worker_t *w = (tun_worker_t *)sl->arg;
+    lbuf_t *b;
+    int i, npkts;
+
     /* Reserve space in case the received packet was IPv6. In this case the IPv6 header is
      * not provided */
-    lbuf_reserve(&pkt_buf,LBUF_STACK_OFFSET);
-
-    if (tun_read_and_decap_pkt(sl->fd, &pkt_buf) != GOOD) {
+    npkts = tun_read_pkts(w, sl->fd, LBUF_STACK_OFFSET);
+    if (npkts == 0) {
         return (BAD);
     }
 
-    LMLOG(LDBG_3, "INPUT (4341): Forwarding to OUPUT for re-encapsulation");
+    for (i = 0; i < npkts; i++) {
+        b = &w->in_buf[i];
+        if (tun_decap_pkt(w, b, w->in_afi[i], w->in_ttl[i], w->in_tos[i])
+                != GOOD) {
+            continue;
+        }
 
-    lbuf_point_to_l3(&pkt_buf);
-    lbuf_reset_ip(&pkt_buf);
-    tun_output(&pkt_buf);
+        LMLOG(LDBG_3, "INPUT (4341): Forwarding to OUPUT for re-encapsulation");
+
+        lbuf_point_to_l3(b);
+        lbuf_reset_ip(b);
+        tun_output(w, b);
+    }
+    /* Re-encapsulated packets are sent once all the batch is processed */
+    tun_output_flush(w);
 
     return(GOOD);
 }
-
@@ -22,56 +22,54 @@
 
 #include "tun_output.h"
 #include "tun.h"
+#include "tun_worker.h"
+#include "../data-plane.h"
 #include "../../fwd_policies/fwd_policy.h"
 #include "../../liblisp/liblisp.h"
 #include "../../lib/packets.h"
 #include "../../lib/sockets.h"
 #include "../../control/lisp_control.h"
+#include "../../control/lisp_fwd_state.h"
 #include "../../lib/ttable.h"
 #include "../../lib/lmlog.h"
 #include "../../lib/sockets-util.h"
+#include "../../lispd_external.h"
 
 
-/* static buffer to receive packets */
-static uint8_t pkt_recv_buf[TUN_RECEIVE_SIZE];
-static lbuf_t pkt_buf;
-ttable_t ttable;
-
-
-static int tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple);
-static int tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple);
-static int tun_forward_native(lbuf_t *b, lisp_addr_t *dst);
+static int tun_output_multicast(tun_worker_t *w, lbuf_t *b,
+        packet_tuple_t *tuple);
+static int tun_output_unicast(tun_worker_t *w, lbuf_t *b,
+        packet_tuple_t *tuple);
+static int tun_forward_native(tun_worker_t *w, lbuf_t *b, lisp_addr_t *dst);
+static int tun_output_queue(tun_worker_t *w, lbuf_t *b, packet_tuple_t *tuple);
 static inline int is_lisp_packet(packet_tuple_t *tpl);
 
-void
-tun_output_init()
-{
-    ttable_init(&ttable);
-}
-
-void
-tun_output_uninit()
-{
-    ttable_uninit(&ttable);
-}
 
 static int
-tun_forward_native(lbuf_t *b, lisp_addr_t *dst)
+tun_forward_native(tun_worker_t *w, lbuf_t *b, lisp_addr_t *dst)
 {
+    fwd_state_t *fs;
     int ret, sock, afi;
 
     LMLOG(LDBG_3, "Forwarding native to destination %s",
             lisp_addr_to_char(dst));
 
     afi = lisp_addr_ip_afi(dst);
-    sock = tun_get_default_output_socket(afi);
+    if (tun_worker_threaded(w)) {
+        /* The interfaces are owned by the control thread */
+        fs = fwd_state_current();
+        sock = fs ? fwd_state_default_socket(fs, afi) : ERR_SOCKET;
+    } else {
+        sock = tun_get_default_output_socket(afi);
+    }
 
     if (sock == ERR_SOCKET) {
         LMLOG(LDBG_2, "tun_forward_native: No output interface for afi %d", afi);
         return (BAD);
     }
 
-    ret = send_raw_packet(sock, lbuf_data(b), lbuf_size(b), lisp_addr_ip(dst));
+    ret = raw_pkt_batch_add(&w->out_batch, sock, lbuf_data(b), lbuf_size(b),
+            lisp_addr_ip(dst));
     return (ret);
 }
 
@@ -128,7 +126,7 @@ make_mcast_addr(packet_tuple_t *tuple, lisp_addr_t *addr){
 }
 
 static int
-tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple)
+tun_output_multicast(tun_worker_t *w, lbuf_t *b, packet_tuple_t *tuple)
 {
     glist_t *or_list = NULL;
     lisp_addr_t *src_rloc = NULL, *daddr = NULL, *dst_rloc = NULL;
@@ -177,13 +175,39 @@ tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple)
 }
 
 static int
-tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
+tun_output_queue(tun_worker_t *w, lbuf_t *b, packet_tuple_t *tuple)
+{
+    lbuf_t *pkt;
+
+    if (tun_worker_threaded(w)) {
+        return (tun_worker_queue_packet(w, tuple, b));
+    }
+
+    pkt = lbuf_clone_packet(b, LBUF_STACK_OFFSET);
+    if (ctrl_queue_pending_packet(tuple, pkt) != GOOD) {
+        LMLOG(LDBG_3,"OUTPUT: Pending packets limit reached for %s. "
+                "Discarding packet", lisp_addr_to_char(&tuple->dst_addr));
+        lbuf_del(pkt);
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+static int
+tun_output_unicast(tun_worker_t *w, lbuf_t *b, packet_tuple_t *tuple)
 {
     fwd_info_t *fi;
     fwd_entry_t *fe;
 
-    fi = ttable_lookup(&ttable, tuple);
-    if (!fi) {
+    fi = ttable_lookup(&w->ttable, tuple);
+    if (!fi && tun_worker_threaded(w)) {
+        fi = tun_worker_get_fwd_info(w, tuple, b);
+        if (fi == NULL) {
+            return (BAD);
+        }
+        fi = ttable_insert(&w->ttable, tuple, fi);
+        fe = fi->fwd_info;
+    } else if (!fi) {
         fi = (fwd_info_t *)ctrl_get_forwarding_info(tuple);
         if (fi == NULL){
             return (BAD);
@@ -193,7 +217,8 @@ tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
             fe->out_sock = get_out_socket_ptr_from_address(fe->srloc);
         }
         // XXX Should packets to be send natively be added to the table?
-        ttable_insert(&ttable, pkt_tuple_clone(tuple), fi);
+        fi = ttable_insert(&w->ttable, tuple, fi);
+        fe = fi->fwd_info;
     }else{
         fe = fi->fwd_info;
     }
@@ -202,22 +227,32 @@ tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
      * OR packets with missing src or dst RLOCs
      * forward them natively */
     if (!fe || !fe->srloc || !fe->drloc) {
-        return(tun_forward_native(b, &tuple->dst_addr));
+        /* Destination still being resolved: keep a copy until the
+         * Map-Reply arrives */
+        if (fi->temporal && pending_packets_per_eid > 0) {
+            return (tun_output_queue(w, b, tuple));
+        }
+        return(tun_forward_native(w, b, &tuple->dst_addr));
     }
 
     LMLOG(LDBG_3,"OUTPUT: Sending encapsulated packet: RLOC %s -> %s\n",
             lisp_addr_to_char(fe->srloc),
             lisp_addr_to_char(fe->drloc));
 
-    lisp_data_encap(b, LISP_DATA_PORT, LISP_DATA_PORT, fe->srloc, fe->drloc);
+    if (fe->encap_tpl) {
+        lisp_data_encap_tpl(b, fe->encap_tpl);
+    } else {
+        lisp_data_encap(b, lisp_data_src_port(pkt_tuple_hash(tuple)),
+                LISP_DATA_PORT, fe->srloc, fe->drloc);
+    }
 
-    return(send_raw_packet(*(fe->out_sock), lbuf_data(b), lbuf_size(b),
-               lisp_addr_ip(fe->drloc)));
+    return(raw_pkt_batch_add(&w->out_batch, *(fe->out_sock), lbuf_data(b),
+            lbuf_size(b), lisp_addr_ip(fe->drloc)));
 
 }
 
 int
-tun_output(lbuf_t *b)
+tun_output(tun_worker_t *w, lbuf_t *b)
 {
     packet_tuple_t tpl;
 
@@ -233,28 +268,76 @@ tun_output(lbuf_t *b)
     /* If already LISP packet, do not encapsulate again */
     if (is_lisp_packet(&tpl)) {
         LMLOG(LDBG_3,"OUTPUT: Is a lisp packet, do not encapsulate again");
-        return (tun_forward_native(b, &tpl.dst_addr));
+        return (tun_forward_native(w, b, &tpl.dst_addr));
     }
     if (ip_addr_is_multicast(lisp_addr_ip(&tpl.dst_addr))) {
-        tun_output_multicast(b, &tpl);
+        tun_output_multicast(w, b, &tpl);
     } else {
-        tun_output_unicast(b, &tpl);
+        tun_output_unicast(w, b, &tpl);
     }
 
     return(GOOD);
 }
 
+/* Send the packets queued by tun_output. The buffers of the packets
+ * processed by tun_output must not be reused before calling this function */
 int
-tun_output_recv(sock_t *sl)
+tun_output_flush(tun_worker_t *w)
+{
+    return (send_raw_packet_batch(&w->out_batch));
+}
+
+/* Called from the control thread with a packet that was waiting for its
+ * destination to be resolved. The packet is not released */
+int
+tun_output_queued(lbuf_t *b)
 {
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, TUN_RECEIVE_SIZE);
-    lbuf_reserve(&pkt_buf, LBUF_STACK_OFFSET);
+    tun_dplane_data_t *data = (tun_dplane_data_t *)dplane_tun.datap_data;
+    packet_tuple_t tpl;
+    tun_worker_t *w;
 
-    if (sock_recv(sl->fd, &pkt_buf) != GOOD) {
-        LMLOG(LWRN, "OUTPUT: Error while reading from tun!");
+    if (!data || data->num_workers == 0) {
         return (BAD);
     }
-    lbuf_reset_ip(&pkt_buf);
-    tun_output(&pkt_buf);
+
+    w = data->workers[0];
+    if (!tun_worker_threaded(w)) {
+        tun_output(w, b);
+        return (tun_output_flush(w));
+    }
+
+    if (pkt_parse_5_tuple(b, &tpl) != GOOD) {
+        return (BAD);
+    }
+    w = data->workers[pkt_tuple_hash(&tpl) % data->num_workers];
+    return (tun_worker_output_packet(w, &tpl, b));
+}
+
+int
+tun_output_recv(sock_t *sl)
+{
+    tun_worker_t *w = (tun_worker_t *)sl->arg;
+    lbuf_t *b;
+    int i;
+
+    /* Drain up to data_batch_size packets from the tun and send them
+     * together */
+    for (i = 0; i < data_batch_size; i++) {
+        b = &w->out_buf[i];
+        lbuf_use_stack(b, &w->out_recv_buf[i], TUN_RECEIVE_SIZE);
+        lbuf_reserve(b, LBUF_STACK_OFFSET);
+
+        if (sock_recv(sl->fd, b) != GOOD) {
+            if (i == 0) {
+                LMLOG(LWRN, "OUTPUT: Error while reading from tun!");
+                return (BAD);
+            }
+            break;
+        }
+        lbuf_reset_ip(b);
+        tun_output(w, b);
+    }
+    tun_output_flush(w);
+
     return (GOOD);
 }
@@ -35,9 +35,11 @@
 #include "../../lib/cksum.h"
 
 
+typedef struct tun_worker_ tun_worker_t;
+
 int tun_output_recv(sock_t *sl);
-int tun_output(lbuf_t *);
-void tun_output_init();
-void tun_output_uninit();
+int tun_output(tun_worker_t *, lbuf_t *);
+int tun_output_flush(tun_worker_t *);
+int tun_output_queued(lbuf_t *b);
 
 #endif /*TUN_OUTPUT_H_*/
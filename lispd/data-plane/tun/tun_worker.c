@@ -0,0 +1,444 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include "tun_worker.h"
+#include "tun_output.h"
+#include "../../control/lisp_control.h"
+#include "../../control/lisp_fwd_state.h"
+#include "../../fwd_policies/fwd_policy.h"
+#include "../../iface_list.h"
+#include "../../lib/lmlog.h"
+#include "../../lib/util.h"
+#include "../../lispd_external.h"
+
+
+static int tun_worker_fwd_req_cb(sock_t *sl);
+static int tun_worker_fwd_rep_cb(sock_t *sl);
+
+static void
+tun_fwd_req_del(tun_fwd_req_t *req)
+{
+    if (req->tpl) {
+        pkt_tuple_del(req->tpl);
+    }
+    if (req->fi){
+        fwd_info_del(req->fi, (fwd_info_data_del)fwd_entry_del);
+    }
+    lbuf_del(req->pkt);
+    free(req);
+}
+
+static void
+tun_worker_notify(int fd)
+{
+    uint64_t one = 1;
+
+    if (write(fd, &one, sizeof(one)) != sizeof(one)) {
+        LMLOG(LDBG_2, "tun_worker_notify: write error: %s", strerror(errno));
+    }
+}
+
+static void
+tun_worker_clear_notification(int fd)
+{
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN) {
+        LMLOG(LDBG_2, "tun_worker_clear_notification: read error: %s",
+                strerror(errno));
+    }
+}
+
+/* Create a worker reading from 'tun_fd'. If 'threaded' is FALSE, the worker
+ * is served by the main event loop and resolves cache misses inline */
+tun_worker_t *
+tun_worker_new(int id, int tun_fd, int threaded)
+{
+    tun_worker_t *w;
+
+    w = xzalloc(sizeof(tun_worker_t));
+    w->id = id;
+    w->tun_fd = tun_fd;
+    w->fwd_req_fd = -1;
+    w->fwd_rep_fd = -1;
+    if (ttable_init(&w->ttable, flow_table_size) != GOOD) {
+        free(w);
+        return (NULL);
+    }
+    raw_pkt_batch_init(&w->out_batch);
+
+    if (!threaded) {
+        w->smaster = smaster;
+        return (w);
+    }
+
+    w->smaster = sockmstr_create();
+    w->fwd_req_ring = spsc_ring_new(TUN_WORKER_RING_SIZE);
+    w->fwd_rep_ring = spsc_ring_new(TUN_WORKER_RING_SIZE);
+    w->fwd_req_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    w->fwd_rep_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!w->smaster || w->fwd_req_fd == -1 || w->fwd_rep_fd == -1) {
+        LMLOG(LCRIT, "tun_worker_new: Couldn't create data plane worker %d",
+                id);
+        if (w->fwd_req_fd != -1) {
+            close(w->fwd_req_fd);
+        }
+        if (w->fwd_rep_fd != -1) {
+            close(w->fwd_rep_fd);
+        }
+        sockmstr_destroy(w->smaster);
+        spsc_ring_del(w->fwd_req_ring);
+        spsc_ring_del(w->fwd_rep_ring);
+        ttable_uninit(&w->ttable);
+        free(w);
+        return (NULL);
+    }
+
+    /* Requests are served by the control thread, replies by the worker */
+    w->fwd_req_sock = sockmstr_register_read_listener(smaster,
+            tun_worker_fwd_req_cb, w, w->fwd_req_fd);
+    sockmstr_register_read_listener(w->smaster, tun_worker_fwd_rep_cb, w,
+            w->fwd_rep_fd);
+    rcu_register_reader(&w->rcu);
+
+    return (w);
+}
+
+void
+tun_worker_del(tun_worker_t *w)
+{
+    tun_fwd_req_t *req;
+
+    if (!w) {
+        return;
+    }
+
+    if (!tun_worker_threaded(w)) {
+        ttable_uninit(&w->ttable);
+        free(w);
+        return;
+    }
+
+    if (w->running) {
+        pthread_cancel(w->thread);
+        pthread_join(w->thread, NULL);
+    }
+    rcu_unregister_reader(&w->rcu);
+
+    sockmstr_unregister_read_listenedr(smaster, w->fwd_req_sock);
+
+    while ((req = spsc_ring_pop(w->fwd_req_ring)) != NULL) {
+        tun_fwd_req_del(req);
+    }
+    spsc_ring_del(w->fwd_req_ring);
+    while ((req = spsc_ring_pop(w->fwd_rep_ring)) != NULL) {
+        tun_fwd_req_del(req);
+    }
+    spsc_ring_del(w->fwd_rep_ring);
+
+    /* Closes the tun queue, the data sockets and the replies eventfd */
+    sockmstr_destroy(w->smaster);
+    ttable_uninit(&w->ttable);
+    free(w);
+}
+
+inline int
+tun_worker_threaded(tun_worker_t *w)
+{
+    return (w->fwd_req_ring != NULL);
+}
+
+static inline tun_pending_req_t *
+tun_worker_pending(tun_worker_t *w, uint32_t hash)
+{
+    return (&w->pending[hash & (TUN_WORKER_PENDING_SIZE - 1)]);
+}
+
+/* Called from the worker thread. Send a copy of 'b' to the control thread,
+ * which keeps it until the destination is resolved */
+static int
+tun_worker_send_packet(tun_worker_t *w, lbuf_t *b)
+{
+    tun_fwd_req_t *req;
+
+    if (!b || pending_packets_per_eid == 0) {
+        return (BAD);
+    }
+    req = xzalloc(sizeof(tun_fwd_req_t));
+    req->pkt = lbuf_clone_packet(b, LBUF_STACK_OFFSET);
+    if (spsc_ring_push(w->fwd_req_ring, req) != GOOD) {
+        tun_fwd_req_del(req);
+        return (BAD);
+    }
+    tun_worker_notify(w->fwd_req_fd);
+
+    return (GOOD);
+}
+
+/* Called from the worker thread. Ask the control thread for the forwarding
+ * information of the flow of 'tpl'. A copy of 'b', if any, travels with the
+ * request so it can be kept while the destination is resolved. Only one
+ * request per flow is sent until it is answered */
+static int
+tun_worker_request_fwd_info(tun_worker_t *w, packet_tuple_t *tpl, lbuf_t *b)
+{
+    tun_fwd_req_t *req;
+    tun_pending_req_t *pending;
+    uint32_t hash;
+    time_t now;
+
+    hash = pkt_tuple_hash(tpl);
+    pending = tun_worker_pending(w, hash);
+    now = time(NULL);
+    if (pending->since != 0 && pending->hash == hash
+            && now - pending->since <= TUN_WORKER_PENDING_TIMEOUT) {
+        return (tun_worker_send_packet(w, b));
+    }
+
+    req = xzalloc(sizeof(tun_fwd_req_t));
+    req->tpl = pkt_tuple_clone(tpl);
+    req->hash = hash;
+    if (b && pending_packets_per_eid > 0) {
+        req->pkt = lbuf_clone_packet(b, LBUF_STACK_OFFSET);
+    }
+    if (spsc_ring_push(w->fwd_req_ring, req) != GOOD) {
+        LMLOG(LDBG_2, "tun_worker_request_fwd_info: Requests queue of worker "
+                "%d full", w->id);
+        tun_fwd_req_del(req);
+        return (BAD);
+    }
+    tun_worker_notify(w->fwd_req_fd);
+
+    /* A colliding flow is replaced, it may request again */
+    pending->hash = hash;
+    pending->since = now;
+
+    return (GOOD);
+}
+
+/* Called from the worker thread on a ttable miss. Returns NULL when the
+ * published forwarding state can't resolve the flow. The control thread is
+ * then asked and takes care of 'b' */
+fwd_info_t *
+tun_worker_get_fwd_info(tun_worker_t *w, packet_tuple_t *tpl, lbuf_t *b)
+{
+    fwd_state_t *fs;
+    fwd_info_t *fi;
+
+    fs = fwd_state_current();
+    if (fs) {
+        fi = fwd_info_new();
+        if (fwd_state_get_fwd_info(fs, tpl, fi) == GOOD) {
+            return (fi);
+        }
+        free(fi);
+    }
+
+    tun_worker_request_fwd_info(w, tpl, b);
+    return (NULL);
+}
+
+/* Called from the worker thread for a packet whose destination is still
+ * being resolved. The control thread keeps it until the Map-Reply arrives */
+int
+tun_worker_queue_packet(tun_worker_t *w, packet_tuple_t *tpl, lbuf_t *b)
+{
+    return (tun_worker_send_packet(w, b));
+}
+
+/* Called from the control thread. Fill the forwarding information of the
+ * flow of the request */
+static int
+tun_fwd_req_resolve(tun_fwd_req_t *req)
+{
+    fwd_entry_t *fe;
+
+    req->fi = (fwd_info_t *)ctrl_get_forwarding_info(req->tpl);
+    if (req->fi == NULL) {
+        return (BAD);
+    }
+    fe = req->fi->fwd_info;
+    if (fe && fe->srloc && fe->drloc)  {
+        fe->out_sock = get_out_socket_ptr_from_address(fe->srloc);
+    }
+    return (GOOD);
+}
+
+static inline int
+tun_fwd_req_unresolved(tun_fwd_req_t *req)
+{
+    fwd_entry_t *fe = req->fi->fwd_info;
+
+    return (req->fi->temporal && (!fe || !fe->srloc || !fe->drloc));
+}
+
+/* Called from the control thread with a packet that was waiting for the
+ * Map-Reply of its destination. It is handed to the worker of its flow
+ * together with the forwarding information */
+int
+tun_worker_output_packet(tun_worker_t *w, packet_tuple_t *tpl, lbuf_t *b)
+{
+    tun_fwd_req_t *req;
+
+    req = xzalloc(sizeof(tun_fwd_req_t));
+    req->tpl = pkt_tuple_clone(tpl);
+    req->hash = pkt_tuple_hash(tpl);
+    if (tun_fwd_req_resolve(req) != GOOD || tun_fwd_req_unresolved(req)) {
+        tun_fwd_req_del(req);
+        return (BAD);
+    }
+    req->pkt = lbuf_clone_packet(b, LBUF_STACK_OFFSET);
+    if (spsc_ring_push(w->fwd_rep_ring, req) != GOOD) {
+        tun_fwd_req_del(req);
+        return (BAD);
+    }
+    tun_worker_notify(w->fwd_rep_fd);
+
+    return (GOOD);
+}
+
+/* Called from the control thread when a worker has pending requests */
+static int
+tun_worker_fwd_req_cb(sock_t *sl)
+{
+    tun_worker_t *w = (tun_worker_t *)sl->arg;
+    tun_fwd_req_t *req;
+    packet_tuple_t tpl;
+    int replies = 0;
+
+    tun_worker_clear_notification(sl->fd);
+
+    while ((req = spsc_ring_pop(w->fwd_req_ring)) != NULL) {
+        if (!req->tpl) {
+            /* Packet of a flow already requested. The request, always
+             * handled first, created its map-cache entry */
+            if (pkt_parse_5_tuple(req->pkt, &tpl) != GOOD) {
+                lbuf_del(req->pkt);
+            } else if (ctrl_queue_pending_packet(&tpl, req->pkt) != GOOD) {
+                /* Sent back if the destination was resolved meanwhile */
+                tun_worker_output_packet(w, &tpl, req->pkt);
+                lbuf_del(req->pkt);
+            }
+            free(req);
+            continue;
+        }
+        /* Replied even if it fails, to let the worker request again */
+        if (tun_fwd_req_resolve(req) != GOOD) {
+            lbuf_del(req->pkt);
+            req->pkt = NULL;
+        } else if (req->pkt && tun_fwd_req_unresolved(req)) {
+            /* Packets of flows still being resolved stay in the control
+             * thread. If the pending queue is full they are dropped */
+            if (ctrl_queue_pending_packet(req->tpl, req->pkt) != GOOD) {
+                lbuf_del(req->pkt);
+            }
+            req->pkt = NULL;
+        }
+        if (spsc_ring_push(w->fwd_rep_ring, req) != GOOD) {
+            tun_fwd_req_del(req);
+            continue;
+        }
+        replies++;
+    }
+
+    if (replies > 0) {
+        tun_worker_notify(w->fwd_rep_fd);
+    }
+
+    return (GOOD);
+}
+
+/* Called from the worker thread when the control thread has replied */
+static int
+tun_worker_fwd_rep_cb(sock_t *sl)
+{
+    tun_worker_t *w = (tun_worker_t *)sl->arg;
+    tun_fwd_req_t *req;
+    tun_pending_req_t *pending;
+
+    tun_worker_clear_notification(sl->fd);
+
+    while ((req = spsc_ring_pop(w->fwd_rep_ring)) != NULL) {
+        pending = tun_worker_pending(w, req->hash);
+        if (pending->hash == req->hash) {
+            pending->since = 0;
+        }
+        if (!req->fi) {
+            pkt_tuple_del(req->tpl);
+            free(req);
+            continue;
+        }
+        /* The flow may have been requested again after a timeout. The last
+         * reply replaces the previous ones */
+        ttable_insert(&w->ttable, req->tpl, req->fi);
+        if (req->pkt) {
+            tun_output(w, req->pkt);
+            tun_output_flush(w);
+            lbuf_del(req->pkt);
+        }
+        pkt_tuple_del(req->tpl);
+        free(req);
+    }
+
+    return (GOOD);
+}
+
+static void *
+tun_worker_run(void *arg)
+{
+    tun_worker_t *w = (tun_worker_t *)arg;
+
+    LMLOG(LDBG_1, "Data plane worker %d started", w->id);
+
+    for (;;) {
+        /* No references to the forwarding state are held while waiting */
+        rcu_thread_offline(&w->rcu);
+        sockmstr_wait_on_all_read(w->smaster);
+        rcu_thread_online(&w->rcu);
+        sockmstr_process_all(w->smaster);
+    }
+
+    return (NULL);
+}
+
+int
+tun_worker_start(tun_worker_t *w)
+{
+    sigset_t all, old;
+    int err;
+
+    /* Signals are handled by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    err = pthread_create(&w->thread, NULL, tun_worker_run, w);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (err != 0) {
+        LMLOG(LCRIT, "tun_worker_start: Couldn't start data plane worker %d: "
+                "%s", w->id, strerror(err));
+        return (BAD);
+    }
+    w->running = TRUE;
+
+    return (GOOD);
+}
@@ -0,0 +1,114 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef TUN_WORKER_H_
+#define TUN_WORKER_H_
+
+#include <pthread.h>
+#include <time.h>
+
+#include "tun.h"
+#include "../../defs.h"
+#include "../../lib/lbuf.h"
+#include "../../lib/packets.h"
+#include "../../lib/rcu.h"
+#include "../../lib/sockets.h"
+#include "../../lib/sockets-util.h"
+#include "../../lib/spsc_ring.h"
+#include "../../lib/ttable.h"
+
+/* Forwarding requests that can be pending per worker */
+#define TUN_WORKER_RING_SIZE    1024
+/* Flows with a forwarding request in flight tracked per worker */
+#define TUN_WORKER_PENDING_SIZE 256
+/* Seconds after which a request without reply no longer holds back new
+ * requests of its flow */
+#define TUN_WORKER_PENDING_TIMEOUT  1
+
+/* Flow with a forwarding request in flight */
+typedef struct tun_pending_req_ {
+    uint32_t hash;
+    /* 0 when not in use */
+    time_t since;
+} tun_pending_req_t;
+
+/*
+ * Packet processing context of the tun data plane. When no data plane threads
+ * are configured, a single worker is served by the main event loop. Otherwise
+ * each worker runs its own event loop in a thread, with its own tun queue and
+ * data input sockets. Flows not present in its ttable are resolved with the
+ * forwarding state published by the control thread, which is only asked
+ * directly on map-cache misses.
+ */
+typedef struct tun_worker_ {
+    int id;
+    pthread_t thread;
+    uint8_t running;
+    sockmstr_t *smaster;
+    int tun_fd;
+    /* Data input sockets are UDP datagram sockets instead of raw ones */
+    uint8_t dgram_input;
+    ttable_t ttable;
+
+    /* Packets read from the tun */
+    uint8_t out_recv_buf[MAX_DATA_BATCH_SIZE][TUN_RECEIVE_SIZE];
+    lbuf_t out_buf[MAX_DATA_BATCH_SIZE];
+    raw_pkt_batch_t out_batch;
+
+    /* Packets read from the data input sockets */
+    uint8_t in_recv_buf[MAX_DATA_BATCH_SIZE][MAX_IP_PKT_LEN+1];
+    lbuf_t in_buf[MAX_DATA_BATCH_SIZE];
+    int in_afi[MAX_DATA_BATCH_SIZE];
+    uint8_t in_ttl[MAX_DATA_BATCH_SIZE];
+    uint8_t in_tos[MAX_DATA_BATCH_SIZE];
+
+    /* Forwarding requests to the control thread and their replies. NULL
+     * when the worker runs in the control thread */
+    spsc_ring_t *fwd_req_ring;
+    spsc_ring_t *fwd_rep_ring;
+    int fwd_req_fd;
+    int fwd_rep_fd;
+    sock_t *fwd_req_sock;
+    rcu_reader_t rcu;
+    /* Requests in flight, indexed by the hash of their tuple */
+    tun_pending_req_t pending[TUN_WORKER_PENDING_SIZE];
+} tun_worker_t;
+
+/* Forwarding information request of a worker. Without tuple, it only
+ * carries a packet to be kept until its destination is resolved */
+typedef struct tun_fwd_req_ {
+    packet_tuple_t *tpl;
+    uint32_t hash;
+    fwd_info_t *fi;
+    /* Copy of a packet of the flow, or NULL */
+    lbuf_t *pkt;
+} tun_fwd_req_t;
+
+tun_worker_t *tun_worker_new(int id, int tun_fd, int threaded);
+void tun_worker_del(tun_worker_t *worker);
+inline int tun_worker_threaded(tun_worker_t *worker);
+fwd_info_t *tun_worker_get_fwd_info(tun_worker_t *worker,
+        packet_tuple_t *tpl, lbuf_t *b);
+int tun_worker_queue_packet(tun_worker_t *worker, packet_tuple_t *tpl,
+        lbuf_t *b);
+int tun_worker_output_packet(tun_worker_t *worker, packet_tuple_t *tpl,
+        lbuf_t *b);
+int tun_worker_start(tun_worker_t *worker);
+
+#endif /* TUN_WORKER_H_ */
@@ -50,6 +50,7 @@ data_plane_struct_t dplane_vpnapi = {
         .datap_input_packet = vpnapi_process_input_packet,
         .datap_rtr_input_packet = vpnapi_rtr_process_input_packet,
         .datap_output_packet = vpnapi_output_recv,
+        .datap_output_queued = vpnapi_output_queued,
         .datap_updated_route = vpnapi_updated_route,
         .datap_updated_addr = vpnapi_updated_addr,
         .datap_update_link = vpnapi_update_link,
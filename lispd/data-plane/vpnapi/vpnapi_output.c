@@ -29,6 +29,7 @@
 #include "../../lib/ttable.h"
 #include "../../lib/lmlog.h"
 #include "../../lib/sockets-util.h"
+#include "../../lispd_external.h"
 
 
 /* static buffer to receive packets */
@@ -38,11 +39,12 @@ ttable_t ttable;
 
 static int vpnapi_output_unicast(lbuf_t *b, packet_tuple_t *tuple);
 static int vpnapi_forward_native(lbuf_t *b, lisp_addr_t *dst);
+static int vpnapi_output_queue(lbuf_t *b, packet_tuple_t *tuple);
 
 void
 vpnapi_output_init()
 {
-    ttable_init(&ttable);
+    ttable_init(&ttable, flow_table_size);
 }
 
 void
@@ -80,6 +82,21 @@ is_lisp_packet(packet_tuple_t *tpl)
     return (TRUE);
 }
 
+static int
+vpnapi_output_queue(lbuf_t *b, packet_tuple_t *tuple)
+{
+    lbuf_t *pkt;
+
+    pkt = lbuf_clone_packet(b, LBUF_STACK_OFFSET);
+    if (ctrl_queue_pending_packet(tuple, pkt) != GOOD) {
+        LMLOG(LDBG_3,"OUTPUT: Pending packets limit reached for %s. Discarding packet",
+                lisp_addr_to_char(&tuple->dst_addr));
+        lbuf_del(pkt);
+        return (BAD);
+    }
+    return (GOOD);
+}
+
 static int
 vpnapi_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
 {
@@ -107,7 +124,8 @@ vpnapi_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
             }
         }
 
-        ttable_insert(&ttable, pkt_tuple_clone(tuple), fi);
+        fi = ttable_insert(&ttable, tuple, fi);
+        fe = fi->fwd_info;
     }else{
         fe = fi->fwd_info;
     }
@@ -116,6 +134,11 @@ vpnapi_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
      * OR packets with missing src or dst RLOCs
      * forward them natively */
     if (!fe || !fe->srloc || !fe->drloc) {
+        /* Destination still being resolved: keep a copy until the
+         * Map-Reply arrives */
+        if (fi->temporal && pending_packets_per_eid > 0) {
+            return (vpnapi_output_queue(b, tuple));
+        }
         LMLOG(LDBG_3,"OUTPUT: Packet with non lisp destination. No PeTRs compatibles to be used. Discarding packet");
         return(BAD);
     }
@@ -156,6 +179,13 @@ vpnapi_output(lbuf_t *b)
     return(GOOD);
 }
 
+/* Send a packet that was waiting for its destination to be resolved */
+int
+vpnapi_output_queued(lbuf_t *b)
+{
+    return (vpnapi_output(b));
+}
+
 int
 vpnapi_output_recv(struct sock *sl)
 {
@@ -63,14 +63,57 @@ typedef struct htable_nonces_ htable_nonces_t;
 #define DEFAULT_MAP_REQUEST_RETRIES             3
 
 #define MAP_REGISTER_INTERVAL                   60
+#define DEFAULT_MAP_REGISTER_JITTER             10  /* +/- % of the interval between Map-Register rounds */
+#define MAX_MAP_REGISTER_JITTER                 50
+#define MAP_REGISTER_MAX_LEN                    1400    /* Records of a Map-Register packed up to this size */
 #define MS_SITE_EXPIRATION                      180
+#define MAX_MAP_SERVER_THREADS                  16
+#define MAX_MAP_REQUEST_RATE_LIMIT              100000
+#define MS_RATE_LIMIT_SOURCES                   4096    /* Sources tracked by each Map-Server thread */
+#define MS_NEG_MREP_TTL                         15  /* Minutes, EIDs outside the configured sites */
 
 #define RLOC_PROBING_INTERVAL                   30
 #define DEFAULT_RLOC_PROBING_RETRIES            2
 #define DEFAULT_RLOC_PROBING_RETRIES_INTERVAL   5   /* Interval in seconds between RLOC probing retries  */
 
 #define DEFAULT_DATA_CACHE_TTL                  10
-#define DEFAULT_SELECT_TIMEOUT                  1000/* ms */
+#define DEFAULT_DATA_BATCH_SIZE                 1   /* Data packets processed per readiness event */
+#define MAX_DATA_BATCH_SIZE                     64
+#define MAX_DATA_PLANE_THREADS                  16
+#define DEFAULT_FLOW_TABLE_SIZE                 32768   /* Flows cached per data plane thread */
+#define MAX_FLOW_TABLE_SIZE                     4194304
+
+/* UDP checksum of encapsulated data packets */
+#define UDP_CKSUM_ZERO                          0
+#define UDP_CKSUM_FULL                          1
+#define DEFAULT_UDP_CKSUM_IPV4                  UDP_CKSUM_ZERO
+#define DEFAULT_UDP_CKSUM_IPV6                  UDP_CKSUM_FULL
+
+/* Outer UDP source ports of encapsulated data packets, chosen per flow */
+#define DEFAULT_DATA_SRC_PORT_MIN               49152
+#define DEFAULT_DATA_SRC_PORT_MAX               65535
+
+/* Packets queued while their destination EID is resolved */
+#define DEFAULT_PENDING_PACKETS_PER_EID         8
+#define MAX_PENDING_PACKETS_PER_EID             1024
+#define DEFAULT_PENDING_PACKETS_MEMORY          1024    /* KB, all the EIDs */
+#define MAX_PENDING_PACKETS_MEMORY              65536
+
+/* Map cache misses sent in the same Map-Request */
+#define DEFAULT_MAP_REQUEST_WINDOW              0       /* ms */
+#define MAX_MAP_REQUEST_WINDOW                  1000
+#define MAP_REQUEST_MAX_RECORDS                 32
+
+/* Percentage of the TTL of a map cache entry at which it is requested again
+ * if it was used during the rest of its TTL */
+#define DEFAULT_MAP_CACHE_REFRESH               90
+#define MAX_MAP_CACHE_REFRESH                   99
+
+/* Limits of the dynamic entries of the map cache. 0 means no limit */
+#define DEFAULT_MAP_CACHE_MAX_ENTRIES           65536
+#define MAX_MAP_CACHE_MAX_ENTRIES               16777216
+#define DEFAULT_MAP_CACHE_MAX_MEMORY            0       /* KB */
+#define MAX_MAP_CACHE_MAX_MEMORY                4194304
 
 #define FIELD_AFI_LEN                    2
 #define FIELD_PORT_LEN                   2
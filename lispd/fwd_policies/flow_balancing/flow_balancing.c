@@ -45,6 +45,10 @@ static void balancing_locators_vec_dump(balancing_locators_vecs,
 int balancing_vectors_calculate(void *dev_parm, void *map_parm, mapping_t *map);
 void fb_locators_classify_in_4_6(mapping_t *mapping,glist_t *loc_loct_addr,
         glist_t *ipv4_loct_list,glist_t *ipv6_loct_list);
+void *fb_fwd_vecs_new_init(void *dev_parm, void *map_parm);
+void fb_fwd_vecs_del(void *fwd_vecs);
+void fb_get_exported_fw_entry(void *src_exp_parm, void *dst_exp_parm,
+        packet_tuple_t *tuple, fwd_info_t *fwd_info);
 
 fwd_policy_class  fwd_policy_flow_balancing = {
         .new_dev_policy_inf = fb_dev_parm_new_init,
@@ -56,7 +60,10 @@ fwd_policy_class  fwd_policy_flow_balancing = {
         .updated_map_loc_inf = balancing_vectors_calculate,
         .updated_map_cache_inf = balancing_vectors_calculate,
         .policy_get_fwd_info = fb_get_fw_entry,
-        .get_fwd_ip_addr = fb_lisp_addr_get_fwd_ip_addr
+        .get_fwd_ip_addr = fb_lisp_addr_get_fwd_ip_addr,
+        .export_map_inf = fb_fwd_vecs_new_init,
+        .del_exported_map_inf = fb_fwd_vecs_del,
+        .exported_get_fwd_info = fb_get_exported_fw_entry
 };
 
 
@@ -497,6 +504,86 @@ fb_locators_classify_in_4_6(mapping_t *mapping, glist_t *loc_loct_addr,
     }
 }
 
+/**************************** Exported vectors *******************************/
+
+static lisp_addr_t **
+fb_fwd_vec_export(locator_t **locators, int len, glist_t *loc_loct)
+{
+    lisp_addr_t **vec;
+    lisp_addr_t *ip_addr;
+    int ctr;
+
+    if (locators == NULL) {
+        return (NULL);
+    }
+
+    vec = xzalloc(len * sizeof(lisp_addr_t *));
+    for (ctr = 0; ctr < len; ctr++) {
+        ip_addr = fb_lisp_addr_get_fwd_ip_addr(locator_addr(locators[ctr]),
+                loc_loct);
+        if (ip_addr != NULL) {
+            vec[ctr] = lisp_addr_clone(ip_addr);
+        }
+    }
+
+    return (vec);
+}
+
+static void
+fb_fwd_vec_del(lisp_addr_t **vec, int len)
+{
+    int ctr;
+
+    if (vec == NULL) {
+        return;
+    }
+    for (ctr = 0; ctr < len; ctr++) {
+        lisp_addr_del(vec[ctr]);
+    }
+    free(vec);
+}
+
+void *
+fb_fwd_vecs_new_init(void *dev_parm, void *map_parm)
+{
+    fb_dev_parm *fw_dev_parm = (fb_dev_parm *)dev_parm;
+    balancing_locators_vecs *blv = (balancing_locators_vecs *)map_parm;
+    fb_fwd_vecs *fv;
+
+    fv = xzalloc(sizeof(fb_fwd_vecs));
+    fv->v4_vec = fb_fwd_vec_export(blv->v4_balancing_locators_vec,
+            blv->v4_locators_vec_length, fw_dev_parm->loc_loct);
+    fv->v4_vec_length = blv->v4_locators_vec_length;
+    fv->v6_vec = fb_fwd_vec_export(blv->v6_balancing_locators_vec,
+            blv->v6_locators_vec_length, fw_dev_parm->loc_loct);
+    fv->v6_vec_length = blv->v6_locators_vec_length;
+
+    if (blv->balancing_locators_vec == blv->v4_balancing_locators_vec) {
+        fv->v4_v6_vec = fv->v4_vec;
+    } else if (blv->balancing_locators_vec == blv->v6_balancing_locators_vec) {
+        fv->v4_v6_vec = fv->v6_vec;
+    } else {
+        fv->v4_v6_vec = fb_fwd_vec_export(blv->balancing_locators_vec,
+                blv->locators_vec_length, fw_dev_parm->loc_loct);
+    }
+    fv->v4_v6_vec_length = blv->locators_vec_length;
+
+    return (fv);
+}
+
+void
+fb_fwd_vecs_del(void *fwd_vecs)
+{
+    fb_fwd_vecs *fv = (fb_fwd_vecs *)fwd_vecs;
+
+    if (fv->v4_v6_vec != fv->v4_vec && fv->v4_v6_vec != fv->v6_vec) {
+        fb_fwd_vec_del(fv->v4_v6_vec, fv->v4_v6_vec_length);
+    }
+    fb_fwd_vec_del(fv->v4_vec, fv->v4_vec_length);
+    fb_fwd_vec_del(fv->v6_vec, fv->v6_vec_length);
+    free(fv);
+}
+
 /*************************** Forward Select Function *************************/
 
 /* Select the source and destination RLOC according to the priority and weight.
@@ -604,3 +691,61 @@ fb_get_fw_entry(void *fwd_dev_parm, void *src_map_parm, void *dst_map_parm,
 
     return;
 }
+
+/* Same selection as fb_get_fw_entry but using exported vectors. Called from
+ * data plane threads: it only reads 'src_exp_parm' and 'dst_exp_parm' */
+void
+fb_get_exported_fw_entry(void *src_exp_parm, void *dst_exp_parm,
+        packet_tuple_t *tuple, fwd_info_t *fwd_info)
+{
+    fb_fwd_vecs *src_fv = (fb_fwd_vecs *)src_exp_parm;
+    fb_fwd_vecs *dst_fv = (fb_fwd_vecs *)dst_exp_parm;
+    lisp_addr_t **src_vec;
+    lisp_addr_t **dst_vec;
+    lisp_addr_t *src_ip_addr;
+    lisp_addr_t *dst_ip_addr;
+    int src_vec_len, dst_vec_len;
+    uint32_t hash;
+
+    if (src_fv->v4_v6_vec != NULL && dst_fv->v4_v6_vec != NULL) {
+        src_vec = src_fv->v4_v6_vec;
+        src_vec_len = src_fv->v4_v6_vec_length;
+    } else if (src_fv->v6_vec != NULL && dst_fv->v6_vec != NULL) {
+        src_vec = src_fv->v6_vec;
+        src_vec_len = src_fv->v6_vec_length;
+    } else if (src_fv->v4_vec != NULL && dst_fv->v4_vec != NULL) {
+        src_vec = src_fv->v4_vec;
+        src_vec_len = src_fv->v4_vec_length;
+    } else {
+        return;
+    }
+
+    hash = pkt_tuple_hash(tuple);
+    src_ip_addr = src_vec[hash % src_vec_len];
+    if (src_ip_addr == NULL) {
+        return;
+    }
+
+    switch (lisp_addr_ip_afi(src_ip_addr)) {
+    case (AF_INET):
+        dst_vec = dst_fv->v4_vec;
+        dst_vec_len = dst_fv->v4_vec_length;
+        break;
+    case (AF_INET6):
+        dst_vec = dst_fv->v6_vec;
+        dst_vec_len = dst_fv->v6_vec_length;
+        break;
+    default:
+        return;
+    }
+    if (dst_vec == NULL) {
+        return;
+    }
+
+    dst_ip_addr = dst_vec[hash % dst_vec_len];
+    if (dst_ip_addr == NULL) {
+        return;
+    }
+
+    fwd_info->fwd_info = fwd_entry_new_init(src_ip_addr, dst_ip_addr, NULL);
+}
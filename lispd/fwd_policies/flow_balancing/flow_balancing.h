@@ -45,4 +45,17 @@ typedef struct balancing_locators_vecs_ {
     int locators_vec_length;
 } balancing_locators_vecs;
 
+/*
+ * Exported balancing_locators_vecs. Locators are replaced by a copy of the
+ * IP address used to forward to them. v4_v6_vec may point to v4_vec or v6_vec
+ */
+typedef struct fb_fwd_vecs_ {
+    lisp_addr_t **v4_vec;
+    lisp_addr_t **v6_vec;
+    lisp_addr_t **v4_v6_vec;
+    int v4_vec_length;
+    int v6_vec_length;
+    int v4_v6_vec_length;
+} fb_fwd_vecs;
+
 #endif /* FLOW_BALANCING_H_ */
@@ -20,6 +20,7 @@
 #ifndef ROUTING_POLICY_H_
 #define ROUTING_POLICY_H_
 
+#include "../lib/fwd_gen.h"
 #include "../lib/generic_list.h"
 #include "../lib/shash.h"
 #include "../liblisp/liblisp.h"
@@ -57,9 +58,17 @@ typedef struct fwd_policy_loct_parm_t{
 	shash_t 		*paramiters;
 } fwd_policy_loct_parm;
 
+/* Source and destination mappings */
+#define FWD_INFO_MAX_GENS   2
+
 typedef struct fwd_info_{
     void *fwd_info;
     uint8_t temporal;
+    /* Epoch and generations of the mappings the info was obtained from. The
+     * info can be cached while none of them changes */
+    uint32_t epoch;
+    fwd_gen_t *gen[FWD_INFO_MAX_GENS];
+    uint32_t gen_val[FWD_INFO_MAX_GENS];
 }fwd_info_t;
 
 
@@ -76,6 +85,12 @@ typedef struct fwd_policy_class {
     void (*policy_get_fwd_info)(void *dev_parm, void *src_map_parm, void *dst_map_parm,
             packet_tuple_t *tuple, fwd_info_t *fdw_info);
     lisp_addr_t *(*get_fwd_ip_addr)(lisp_addr_t *addr, glist_t *locl_rlocs_addr);
+    /* Self-contained copy of the routing info of a mapping. It is never
+     * modified, so data plane threads can use it without locking */
+    void *(*export_map_inf)(void *dev_parm, void *map_parm);
+    void (*del_exported_map_inf)(void *);
+    void (*exported_get_fwd_info)(void *src_exp_parm, void *dst_exp_parm,
+            packet_tuple_t *tuple, fwd_info_t *fdw_info);
 } fwd_policy_class;
 
 
@@ -92,4 +107,47 @@ fwd_policy_class *fwd_policy_class_find(char *lib);
 fwd_info_t *fwd_info_new();
 void fwd_info_del(fwd_info_t * fwd_info,fwd_info_data_del del_fn);
 
+static inline void
+fwd_info_add_gen(fwd_info_t *fi, fwd_gen_t *gen, uint32_t val)
+{
+    int i;
+
+    for (i = 0; i < FWD_INFO_MAX_GENS; i++) {
+        if (!fi->gen[i]) {
+            fi->gen[i] = gen;
+            fi->gen_val[i] = val;
+            return;
+        }
+    }
+}
+
+/* Check that the mappings used to obtain 'fi' didn't change. Generations are
+ * type stable, they can be read even if their mappings were removed */
+static inline int
+fwd_info_is_valid(fwd_info_t *fi)
+{
+    int i;
+
+    if (fi->epoch != fwd_epoch_get()) {
+        return (FALSE);
+    }
+    for (i = 0; i < FWD_INFO_MAX_GENS && fi->gen[i]; i++) {
+        if (fwd_gen_get(fi->gen[i]) != fi->gen_val[i]) {
+            return (FALSE);
+        }
+    }
+    return (TRUE);
+}
+
+/* Record that 'fi' is being used to forward. It has to be valid */
+static inline void
+fwd_info_mark_used(fwd_info_t *fi)
+{
+    int i;
+
+    for (i = 0; i < FWD_INFO_MAX_GENS && fi->gen[i]; i++) {
+        fwd_gen_mark_used(fi->gen[i]);
+    }
+}
+
 #endif /* ROUTING_POLICY_H_ */
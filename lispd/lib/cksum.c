@@ -25,26 +25,234 @@
 #include <netinet/in.h>
 #include <netinet/ip6.h>
 #include <netinet/ip.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CKSUM_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CKSUM_NEON
+#include <arm_neon.h>
+#endif
 
+/*
+ * The one's complement sum is accumulated in 64 bits, which can take 2^32
+ * words of 32 bits before overflowing, and folded once at the end. The sum
+ * of 32 or 64 bit words gives, once folded to 16 bits, the same result as
+ * the sum of 16 bit words (RFC 1071). The variant used to sum the buffers
+ * is chosen the first time a checksum is computed, from what the CPU
+ * supports.
+ */
 
-uint16_t
-ip_checksum(uint16_t *buffer, int size)
+typedef uint64_t (*cksum_sum_fn)(const uint8_t *buf, int len, uint64_t acc);
+
+typedef struct cksum_impl {
+    const char *name;
+    cksum_sum_fn sum;
+    /* NULL if the variant is always available */
+    int (*supported)(void);
+} cksum_impl_t;
+
+/* Fold a 64 bit one's complement sum into 16 bits */
+static inline uint32_t
+cksum_fold64(uint64_t acc)
 {
-    uint32_t cksum = 0;
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    acc = (acc & 0xffff) + (acc >> 16);
+    acc = (acc & 0xffff) + (acc >> 16);
+    return ((uint32_t)acc);
+}
 
-    while (size > 1) {
-        cksum += *buffer++;
-        size -= sizeof(uint16_t);
+/* Portable variant, 64 bits at a time */
+static uint64_t
+cksum_sum_scalar(const uint8_t *buf, int len, uint64_t acc)
+{
+    uint64_t w64, sum = 0;
+    uint32_t w32;
+    uint16_t w16;
+
+    acc = cksum_fold64(acc);
+    while (len >= 8) {
+        memcpy(&w64, buf, 8);
+        sum += w64;
+        /* End around carry */
+        sum += (sum < w64);
+        buf += 8;
+        len -= 8;
+    }
+    acc += cksum_fold64(sum);
+    if (len >= 4) {
+        memcpy(&w32, buf, 4);
+        acc += w32;
+        buf += 4;
+        len -= 4;
     }
+    if (len >= 2) {
+        memcpy(&w16, buf, 2);
+        acc += w16;
+        buf += 2;
+        len -= 2;
+    }
+    if (len) {
+        acc += htons(*buf << 8);
+    }
+    return (acc);
+}
+
+#if defined(CKSUM_X86)
 
-    if (size) {
-        cksum += *(uint8_t *) buffer;
+/* Each 32 bit word is widened to 64 bits, so the lanes never overflow */
+__attribute__ ((target ("sse2"))) static uint64_t
+cksum_sum_sse2(const uint8_t *buf, int len, uint64_t acc)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i vacc0 = _mm_setzero_si128();
+    __m128i vacc1 = _mm_setzero_si128();
+    __m128i v0, v1;
+    uint64_t lanes[2];
+
+    while (len >= 32) {
+        v0 = _mm_loadu_si128((const __m128i *)buf);
+        v1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+        vacc0 = _mm_add_epi64(vacc0, _mm_unpacklo_epi32(v0, zero));
+        vacc1 = _mm_add_epi64(vacc1, _mm_unpackhi_epi32(v0, zero));
+        vacc0 = _mm_add_epi64(vacc0, _mm_unpacklo_epi32(v1, zero));
+        vacc1 = _mm_add_epi64(vacc1, _mm_unpackhi_epi32(v1, zero));
+        buf += 32;
+        len -= 32;
     }
+    _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(vacc0, vacc1));
+    acc = cksum_fold64(acc) + (uint64_t)cksum_fold64(lanes[0])
+            + cksum_fold64(lanes[1]);
 
-    cksum = (cksum >> 16) + (cksum & 0xffff);
-    cksum += (cksum >> 16);
+    return (cksum_sum_scalar(buf, len, acc));
+}
 
-    return ((uint16_t) (~cksum));
+__attribute__ ((target ("avx2"))) static uint64_t
+cksum_sum_avx2(const uint8_t *buf, int len, uint64_t acc)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i vacc0 = _mm256_setzero_si256();
+    __m256i vacc1 = _mm256_setzero_si256();
+    __m256i v0, v1;
+    uint64_t lanes[4];
+
+    /* Headers and short payloads */
+    if (len < 128) {
+        return (cksum_sum_sse2(buf, len, acc));
+    }
+
+    while (len >= 64) {
+        v0 = _mm256_loadu_si256((const __m256i *)buf);
+        v1 = _mm256_loadu_si256((const __m256i *)(buf + 32));
+        vacc0 = _mm256_add_epi64(vacc0, _mm256_unpacklo_epi32(v0, zero));
+        vacc1 = _mm256_add_epi64(vacc1, _mm256_unpackhi_epi32(v0, zero));
+        vacc0 = _mm256_add_epi64(vacc0, _mm256_unpacklo_epi32(v1, zero));
+        vacc1 = _mm256_add_epi64(vacc1, _mm256_unpackhi_epi32(v1, zero));
+        buf += 64;
+        len -= 64;
+    }
+    _mm256_storeu_si256((__m256i *)lanes, _mm256_add_epi64(vacc0, vacc1));
+    /* Avoid the AVX to SSE transition penalty in the code that follows */
+    _mm256_zeroupper();
+    acc = cksum_fold64(acc) + (uint64_t)cksum_fold64(lanes[0])
+            + cksum_fold64(lanes[1]) + cksum_fold64(lanes[2])
+            + cksum_fold64(lanes[3]);
+
+    return (cksum_sum_sse2(buf, len, acc));
+}
+
+static int
+cksum_has_sse2()
+{
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("sse2"));
+}
+
+static int
+cksum_has_avx2()
+{
+    __builtin_cpu_init();
+    return (__builtin_cpu_supports("avx2"));
+}
+
+#elif defined(CKSUM_NEON)
+
+static uint64_t
+cksum_sum_neon(const uint8_t *buf, int len, uint64_t acc)
+{
+    uint64x2_t vacc0 = vdupq_n_u64(0);
+    uint64x2_t vacc1 = vdupq_n_u64(0);
+
+    while (len >= 32) {
+        vacc0 = vpadalq_u32(vacc0, vreinterpretq_u32_u8(vld1q_u8(buf)));
+        vacc1 = vpadalq_u32(vacc1, vreinterpretq_u32_u8(vld1q_u8(buf + 16)));
+        buf += 32;
+        len -= 32;
+    }
+    vacc0 = vaddq_u64(vacc0, vacc1);
+    acc = cksum_fold64(acc) + (uint64_t)cksum_fold64(vgetq_lane_u64(vacc0, 0))
+            + cksum_fold64(vgetq_lane_u64(vacc0, 1));
+
+    return (cksum_sum_scalar(buf, len, acc));
+}
+
+#endif
+
+/* From the fastest to the slowest */
+static const cksum_impl_t cksum_impls[] = {
+#if defined(CKSUM_X86)
+    {"avx2", cksum_sum_avx2, cksum_has_avx2},
+    {"sse2", cksum_sum_sse2, cksum_has_sse2},
+#elif defined(CKSUM_NEON)
+    {"neon", cksum_sum_neon, NULL},
+#endif
+    {"scalar", cksum_sum_scalar, NULL}
+};
+
+static uint64_t cksum_sum_resolve(const uint8_t *buf, int len, uint64_t acc);
+
+static cksum_sum_fn cksum_sum = cksum_sum_resolve;
+
+/* Select the first variant supported by the CPU. Concurrent callers
+ * store the same value */
+static uint64_t
+cksum_sum_resolve(const uint8_t *buf, int len, uint64_t acc)
+{
+    const cksum_impl_t *impl = cksum_impls;
+
+    while (impl->supported && !impl->supported()) {
+        impl++;
+    }
+    __atomic_store_n(&cksum_sum, impl->sum, __ATOMIC_RELAXED);
+    return (impl->sum(buf, len, acc));
+}
+
+/* Add to 'sum' the 16 bit words of 'len' bytes of 'data'. 'data' must start
+ * at an even offset of the checksummed area. The result is folded to 16
+ * bits, so a few more words can be added to it, but not complemented, see
+ * cksum_fold */
+uint32_t
+cksum_partial(const void *data, int len, uint32_t sum)
+{
+    cksum_sum_fn fn = __atomic_load_n(&cksum_sum, __ATOMIC_RELAXED);
+
+    return (cksum_fold64(fn(data, len, sum)));
+}
+
+/* One's complement of the folded 'sum' */
+uint16_t
+cksum_fold(uint32_t sum)
+{
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return ((uint16_t)~sum);
+}
+
+uint16_t
+ip_checksum(uint16_t *buffer, int size)
+{
+    return (cksum_fold(cksum_partial(buffer, size, 0)));
 }
 
 /*
@@ -66,88 +274,27 @@ uint16_t
 udp_ipv4_checksum(const void *b, unsigned int len,
         in_addr_t src, in_addr_t dst)
 {
+    uint32_t sum;
 
-    const uint16_t *buf = b;
-    uint16_t *ip_src = (void *) &src;
-    uint16_t *ip_dst = (void *) &dst;
-    uint32_t length = len;
-    uint32_t sum = 0;
-
-    while (len > 1) {
-        sum += *buf++;
-        if (sum & 0x80000000)
-            sum = (sum & 0xFFFF) + (sum >> 16);
-        len -= 2;
-    }
-
-    /* Add the padding if the packet length is odd */
-
-    if (len & 1)
-        sum += *((uint8_t *) buf);
-
-    /* Add the pseudo-header */
-
-    sum += *(ip_src++);
-    sum += *ip_src;
-
-    sum += *(ip_dst++);
-    sum += *ip_dst;
-
-    sum += htons(IPPROTO_UDP);
-    sum += htons(length);
-
-    /* Add the carries */
-
-    while (sum >> 16)
-        sum = (sum & 0xFFFF) + (sum >> 16);
-
-    /* Return the one's complement of sum */
+    /* Pseudo-header */
+    sum = cksum_partial(&src, sizeof(in_addr_t), 0);
+    sum = cksum_partial(&dst, sizeof(in_addr_t), sum);
+    sum += htons(IPPROTO_UDP) + htons(len);
 
-    return ((uint16_t) (~sum));
+    return (cksum_fold(cksum_partial(b, len, sum)));
 }
 
 uint16_t
 udp_ipv6_checksum(const struct ip6_hdr *ip6, const struct udphdr *up,
         unsigned int len)
 {
-    size_t i;
-    register const u_int16_t *sp;
     uint32_t sum;
-    union {
-        struct {
-            struct in6_addr ph_src;
-            struct in6_addr ph_dst;
-            u_int32_t ph_len;
-            u_int8_t ph_zero[3];
-            u_int8_t ph_nxt;
-        } ph;
-        u_int16_t pa[20];
-    } phu;
-
-    /* pseudo-header */
-    memset(&phu, 0, sizeof(phu));
-    phu.ph.ph_src = ip6->ip6_src;
-    phu.ph.ph_dst = ip6->ip6_dst;
-    phu.ph.ph_len = htonl(len);
-    phu.ph.ph_nxt = IPPROTO_UDP;
-
-    sum = 0;
-    for (i = 0; i < sizeof(phu.pa) / sizeof(phu.pa[0]); i++)
-        sum += phu.pa[i];
-
-    sp = (const u_int16_t *) up;
-
-    for (i = 0; i < (len & ~1); i += 2)
-        sum += *sp++;
-
-    if (len & 1)
-        sum += htons((*(const u_int8_t *) sp) << 8);
-
-    while (sum > 0xffff)
-        sum = (sum & 0xffff) + (sum >> 16);
-    sum = ~sum & 0xffff;
-
-    return (sum);
+
+    /* Pseudo-header, with a 32 bit length */
+    sum = cksum_partial(&ip6->ip6_src, 2 * sizeof(struct in6_addr), 0);
+    sum += htons(len >> 16) + htons(len & 0xffff) + htons(IPPROTO_UDP);
+
+    return (cksum_fold(cksum_partial(up, len, sum)));
 }
 
 /*
@@ -25,6 +25,21 @@
 #include "../defs.h"
 
 uint16_t ip_checksum(uint16_t *buffer, int size);
+uint32_t cksum_partial(const void *data, int len, uint32_t sum);
+uint16_t cksum_fold(uint32_t sum);
+
+/* Update 'cksum' after a 16 bit word of the checksummed data changes from
+ * 'old_w' to 'new_w', without summing the data again (RFC 1624, eqn. 3) */
+static inline uint16_t
+cksum_update16(uint16_t cksum, uint16_t old_w, uint16_t new_w)
+{
+    uint32_t sum;
+
+    sum = (uint16_t)~cksum + (uint32_t)(uint16_t)~old_w + new_w;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return ((uint16_t)~sum);
+}
 
 /* Calculate the IPv4 or IPv6 UDP checksum */
 uint16_t udp_checksum(struct udphdr *udph, int udp_len, void *iphdr, int afi);
@@ -0,0 +1,75 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "fwd_gen.h"
+#include "util.h"
+
+/* Generations allocated at once when there are no released ones */
+#define FWD_GEN_SLAB_GENS   128
+
+/* 0 is never a valid epoch, so zeroed forwarding info is never used */
+uint32_t fwd_epoch = 1;
+
+/* Released generations. Only used by the control thread */
+static fwd_gen_t *free_gens = NULL;
+
+
+fwd_gen_t *
+fwd_gen_new()
+{
+    fwd_gen_t *gen;
+    int i;
+
+    if (!free_gens) {
+        gen = xzalloc(FWD_GEN_SLAB_GENS * sizeof(fwd_gen_t));
+        for (i = 0; i < FWD_GEN_SLAB_GENS; i++) {
+            gen[i].next = free_gens;
+            free_gens = &gen[i];
+        }
+    }
+    gen = free_gens;
+    free_gens = gen->next;
+    gen->next = NULL;
+    /* The value is kept from the previous owner */
+    __atomic_store_n(&gen->used, 0, __ATOMIC_RELAXED);
+    return (gen);
+}
+
+/* The owner of 'gen' must have been unlinked from its database. The info
+ * cached with it is invalidated, and it is kept for reuse */
+void
+fwd_gen_del(fwd_gen_t *gen)
+{
+    if (!gen) {
+        return;
+    }
+    fwd_gen_bump(gen);
+    gen->next = free_gens;
+    free_gens = gen;
+}
+
+void
+fwd_epoch_bump()
+{
+    if (__atomic_add_fetch(&fwd_epoch, 1, __ATOMIC_SEQ_CST) == 0) {
+        __atomic_add_fetch(&fwd_epoch, 1, __ATOMIC_SEQ_CST);
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef FWD_GEN_H_
+#define FWD_GEN_H_
+
+#include <stdint.h>
+
+/*
+ * Generation numbers used to validate the forwarding info cached by the data
+ * plane. Each map-cache entry and local mapping owns a generation that is
+ * increased whenever its forwarding info changes or it is removed. Adding a
+ * map-cache entry increases the generation of the entry that covered it, or
+ * the generation of the misses of the map-cache if none did. Changing the
+ * local interfaces or the PeTRs increases the global epoch instead, which
+ * invalidates all the cached info at once.
+ *
+ * Generations are read by the data plane threads at any time, also after
+ * their owner is removed. They are type stable: released generations are
+ * kept for reuse and never freed, and their value keeps increasing across
+ * owners, so stale info never validates again.
+ *
+ * The data plane also marks the generations of the info it forwards with as
+ * used. Each user of the marks in the control plane clears its own bit to
+ * find out whether the owner was used since then.
+ */
+
+/* Bits of the used mark */
+#define FWD_GEN_USED_REFRESH    0x01    /* Map cache refresh */
+#define FWD_GEN_USED_LRU        0x02    /* Map cache eviction */
+#define FWD_GEN_USED_ALL        0x03
+
+typedef struct fwd_gen_ {
+    uint32_t val;
+    uint8_t used;
+    /* Next released generation, while not in use */
+    struct fwd_gen_ *next;
+} fwd_gen_t;
+
+extern uint32_t fwd_epoch;
+
+fwd_gen_t *fwd_gen_new();
+void fwd_gen_del(fwd_gen_t *gen);
+void fwd_epoch_bump();
+
+static inline uint32_t
+fwd_epoch_get()
+{
+    return (__atomic_load_n(&fwd_epoch, __ATOMIC_ACQUIRE));
+}
+
+static inline uint32_t
+fwd_gen_get(fwd_gen_t *gen)
+{
+    return (__atomic_load_n(&gen->val, __ATOMIC_ACQUIRE));
+}
+
+static inline void
+fwd_gen_bump(fwd_gen_t *gen)
+{
+    __atomic_add_fetch(&gen->val, 1, __ATOMIC_RELEASE);
+}
+
+/* Only written when not set yet, to keep the cache line shared between the
+ * threads forwarding with it */
+static inline void
+fwd_gen_mark_used(fwd_gen_t *gen)
+{
+    if (__atomic_load_n(&gen->used, __ATOMIC_RELAXED) != FWD_GEN_USED_ALL) {
+        __atomic_store_n(&gen->used, FWD_GEN_USED_ALL, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void
+fwd_gen_set_used(fwd_gen_t *gen, uint8_t bit)
+{
+    __atomic_fetch_or(&gen->used, bit, __ATOMIC_RELAXED);
+}
+
+/* Returns whether 'gen' was used since 'bit' was cleared last time */
+static inline int
+fwd_gen_test_and_clear_used(fwd_gen_t *gen, uint8_t bit)
+{
+    return ((__atomic_fetch_and(&gen->used, (uint8_t)~bit,
+            __ATOMIC_RELAXED) & bit) != 0);
+}
+
+#endif /* FWD_GEN_H_ */
@@ -18,103 +18,222 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "hmac.h"
 #include "lmlog.h"
-#include "../elibs/mbedtls/md.h"
+#include "util.h"
 #include "../liblisp/lisp_message_fields.h"
 
+/* Block size of SHA-1 and SHA-256 */
+#define HMAC_BLOCK_LEN      64
 
 
-/*
- * Compute and fill auth data field
- *
- * TODO Support more than SHA1
- */
+size_t
+hmac_auth_data_len(uint8_t key_id)
+{
+    switch (key_id) {
+    case HMAC_SHA_1_96:
+        return (SHA1_AUTH_DATA_LEN);
+    case HMAC_SHA_256_128:
+        return (SHA256_AUTH_DATA_LEN);
+    default:
+        return (0);
+    }
+}
 
+/* RFC 2104: keys longer than the block are hashed, then padded with zeros and
+ * XORed with the inner and outer pads. Both padded keys are hashed here once */
 int
-complete_auth_fields(uint8_t key_id, const char *key, void *packet, size_t pckt_len,
-        void *auth_data_pos)
+hmac_key_init(hmac_key_t *hk, uint8_t key_id, const char *key)
 {
-    const mbedtls_md_info_t *md_info;
-    mbedtls_md_type_t md_type;
-    size_t auth_data_len;
+    uint8_t ipad[HMAC_BLOCK_LEN], opad[HMAC_BLOCK_LEN];
+    uint8_t sum[SHA256_AUTH_DATA_LEN];
+    const uint8_t *k = (const uint8_t *)key;
+    size_t i, keylen;
+
+    if (key == NULL) {
+        return (BAD);
+    }
+    keylen = strlen(key);
 
     switch (key_id) {
     case HMAC_SHA_1_96:
-        md_type = MBEDTLS_MD_SHA1;
-        auth_data_len = SHA1_AUTH_DATA_LEN;
+        if (keylen > HMAC_BLOCK_LEN) {
+            mbedtls_sha1(k, keylen, sum);
+            k = sum;
+            keylen = SHA1_AUTH_DATA_LEN;
+        }
+        break;
+    case HMAC_SHA_256_128:
+        if (keylen > HMAC_BLOCK_LEN) {
+            mbedtls_sha256(k, keylen, sum, 0);
+            k = sum;
+            keylen = SHA256_AUTH_DATA_LEN;
+        }
         break;
     default:
-        LMLOG(LDBG_2, "complete_auth_fields: HMAC unknown key type: %d", (int)key_id);
-        return(BAD);
+        LMLOG(LDBG_2, "hmac_key_init: HMAC unknown key type: %d", (int)key_id);
+        return (BAD);
     }
 
-    md_info = mbedtls_md_info_from_type(md_type);
+    memset(ipad, 0x36, HMAC_BLOCK_LEN);
+    memset(opad, 0x5c, HMAC_BLOCK_LEN);
+    for (i = 0; i < keylen; i++) {
+        ipad[i] ^= k[i];
+        opad[i] ^= k[i];
+    }
 
-    memset(auth_data_pos,0,auth_data_len);
-    if (mbedtls_md_hmac(md_info,
-            (const unsigned char *)key,
-            strlen(key),
-            (const unsigned char *)packet,
-            pckt_len,
-            (unsigned char *)auth_data_pos) != 0){
-        LMLOG(LDBG_2, "complete_auth_fields: Error using mbedtls");
-        return (BAD);
+    hk->key_id = key_id;
+    if (key_id == HMAC_SHA_1_96) {
+        mbedtls_sha1_init(&hk->inner.sha1);
+        mbedtls_sha1_starts(&hk->inner.sha1);
+        mbedtls_sha1_update(&hk->inner.sha1, ipad, HMAC_BLOCK_LEN);
+        mbedtls_sha1_init(&hk->outer.sha1);
+        mbedtls_sha1_starts(&hk->outer.sha1);
+        mbedtls_sha1_update(&hk->outer.sha1, opad, HMAC_BLOCK_LEN);
+    } else {
+        mbedtls_sha256_init(&hk->inner.sha256);
+        mbedtls_sha256_starts(&hk->inner.sha256, 0);
+        mbedtls_sha256_update(&hk->inner.sha256, ipad, HMAC_BLOCK_LEN);
+        mbedtls_sha256_init(&hk->outer.sha256);
+        mbedtls_sha256_starts(&hk->outer.sha256, 0);
+        mbedtls_sha256_update(&hk->outer.sha256, opad, HMAC_BLOCK_LEN);
     }
 
+    memset(ipad, 0, HMAC_BLOCK_LEN);
+    memset(opad, 0, HMAC_BLOCK_LEN);
+    memset(sum, 0, sizeof(sum));
+
     return (GOOD);
 }
 
+hmac_key_t *
+hmac_key_new(uint8_t key_id, const char *key)
+{
+    hmac_key_t *hk = xzalloc(sizeof(hmac_key_t));
+
+    if (hmac_key_init(hk, key_id, key) != GOOD) {
+        free(hk);
+        return (NULL);
+    }
+    return (hk);
+}
+
+void
+hmac_key_del(hmac_key_t *hk)
+{
+    if (hk == NULL) {
+        return;
+    }
+    memset(hk, 0, sizeof(hmac_key_t));
+    free(hk);
+}
+
+/* The contexts are copied, so the key may be shared between threads */
+static void
+hmac_key_compute(hmac_key_t *hk, const void *packet, size_t pckt_len,
+        uint8_t *out)
+{
+    mbedtls_sha1_context sha1;
+    mbedtls_sha256_context sha256;
+    uint8_t inner[SHA256_AUTH_DATA_LEN];
+
+    if (hk->key_id == HMAC_SHA_1_96) {
+        sha1 = hk->inner.sha1;
+        mbedtls_sha1_update(&sha1, packet, pckt_len);
+        mbedtls_sha1_finish(&sha1, inner);
+        sha1 = hk->outer.sha1;
+        mbedtls_sha1_update(&sha1, inner, SHA1_AUTH_DATA_LEN);
+        mbedtls_sha1_finish(&sha1, out);
+    } else {
+        sha256 = hk->inner.sha256;
+        mbedtls_sha256_update(&sha256, packet, pckt_len);
+        mbedtls_sha256_finish(&sha256, inner);
+        sha256 = hk->outer.sha256;
+        mbedtls_sha256_update(&sha256, inner, SHA256_AUTH_DATA_LEN);
+        mbedtls_sha256_finish(&sha256, out);
+    }
+}
+
+/*
+ * Compute and fill auth data field
+ */
 
 int
-check_auth_field(uint8_t key_id, const char *key, void *packet, size_t pckt_len,
+hmac_key_complete_auth_fields(hmac_key_t *hk, void *packet, size_t pckt_len,
         void *auth_data_pos)
 {
-    size_t auth_data_len;
-    uint8_t* auth_data_copy;
+    if (hk == NULL) {
+        LMLOG(LDBG_2, "complete_auth_fields: No valid key");
+        return (BAD);
+    }
 
-    const mbedtls_md_info_t *md_info;
-    mbedtls_md_type_t md_type;
+    memset(auth_data_pos, 0, hmac_auth_data_len(hk->key_id));
+    hmac_key_compute(hk, packet, pckt_len, auth_data_pos);
 
-    switch (key_id) {
-    case HMAC_SHA_1_96:
-        md_type = MBEDTLS_MD_SHA1;
-        auth_data_len = SHA1_AUTH_DATA_LEN;
-        break;
-    default:
-        LMLOG(LDBG_2, "complete_auth_fields: HMAC unknown key type: %d", (int)key_id);
-        return(BAD);
+    return (GOOD);
+}
+
+/* The auth data of the packet is left unchanged. The comparison takes the
+ * same time wherever the first difference is */
+int
+hmac_key_check_auth_field(hmac_key_t *hk, void *packet, size_t pckt_len,
+        void *auth_data_pos)
+{
+    uint8_t received[SHA256_AUTH_DATA_LEN];
+    uint8_t computed[SHA256_AUTH_DATA_LEN];
+    uint8_t diff = 0;
+    size_t i, auth_data_len;
+
+    if (hk == NULL) {
+        LMLOG(LDBG_2, "check_auth_field: No valid key");
+        return (BAD);
     }
+    auth_data_len = hmac_auth_data_len(hk->key_id);
+
+    /* The auth data is computed with the field set to 0 */
+    memcpy(received, auth_data_pos, auth_data_len);
+    memset(auth_data_pos, 0, auth_data_len);
+    hmac_key_compute(hk, packet, pckt_len, computed);
+    memcpy(auth_data_pos, received, auth_data_len);
 
-    auth_data_copy = (uint8_t *) xmalloc(auth_data_len*sizeof(uint8_t));
-    if (auth_data_copy == NULL) {
-        LMLOG(LERR, "check_sha1_hmac: malloc() failed");
-        return(ERR_MALLOC);
+    for (i = 0; i < auth_data_len; i++) {
+        diff |= received[i] ^ computed[i];
     }
 
-    /* Copy the data to another location and put 0's on the auth data field of the packet */
-    memcpy(auth_data_copy,auth_data_pos,auth_data_len);
-    memset(auth_data_pos,0,auth_data_len);
+    return (diff == 0 ? GOOD : BAD);
+}
 
+int
+complete_auth_fields(uint8_t key_id, const char *key, void *packet, size_t pckt_len,
+        void *auth_data_pos)
+{
+    hmac_key_t hk;
+    int ret;
 
-    md_info = mbedtls_md_info_from_type(md_type);
-    if (mbedtls_md_hmac(md_info,
-            (const unsigned char *)key,
-            strlen(key),
-            (const unsigned char *)packet,
-            pckt_len,
-            (unsigned char *)auth_data_pos) != 0){
-        LMLOG(LDBG_2, "check_auth_field: Error using mbedtls");
+    if (hmac_key_init(&hk, key_id, key) != GOOD) {
         return (BAD);
     }
+    ret = hmac_key_complete_auth_fields(&hk, packet, pckt_len, auth_data_pos);
+    memset(&hk, 0, sizeof(hk));
 
-    if ((strncmp((char *)auth_data_pos, (char *)auth_data_copy, auth_data_len)) == 0) {
-        free(auth_data_copy);
-        return(GOOD);
-    } else {
-        free(auth_data_copy);
-        return(BAD);
-    }
+    return (ret);
 }
 
+
+int
+check_auth_field(uint8_t key_id, const char *key, void *packet, size_t pckt_len,
+        void *auth_data_pos)
+{
+    hmac_key_t hk;
+    int ret;
+
+    if (hmac_key_init(&hk, key_id, key) != GOOD) {
+        return (BAD);
+    }
+    ret = hmac_key_check_auth_field(&hk, packet, pckt_len, auth_data_pos);
+    memset(&hk, 0, sizeof(hk));
+
+    return (ret);
+}
@@ -21,10 +21,37 @@
 #define HMAC_H_
 
 #include <stdint.h>
+#include <stddef.h>
+
+#include "../elibs/mbedtls/sha1.h"
+#include "../elibs/mbedtls/sha256.h"
 
 #define SHA1_AUTH_DATA_LEN         20
 #define SHA256_AUTH_DATA_LEN       32
 
+/* Precomputed HMAC of a key: digest state after hashing the key XORed with
+ * the inner and outer pads. Authenticating a message only hashes the message
+ * and the inner digest from copies of these states. Read-only once
+ * initialized */
+typedef struct hmac_key {
+    uint8_t key_id;
+    union {
+        mbedtls_sha1_context sha1;
+        mbedtls_sha256_context sha256;
+    } inner, outer;
+} hmac_key_t;
+
+int hmac_key_init(hmac_key_t *hk, uint8_t key_id, const char *key);
+hmac_key_t *hmac_key_new(uint8_t key_id, const char *key);
+void hmac_key_del(hmac_key_t *hk);
+size_t hmac_auth_data_len(uint8_t key_id);
+
+int hmac_key_complete_auth_fields(hmac_key_t *hk, void *packet, size_t pckt_len,
+        void *auth_data_pos);
+int hmac_key_check_auth_field(hmac_key_t *hk, void *packet, size_t pckt_len,
+        void *auth_data_pos);
+
+/* Same with the key in clear, for keys that are not cached */
 int complete_auth_fields(uint8_t key_id, const char *key, void *packet, size_t pckt_len,
         void *auth_data_pos);
 
@@ -17,6 +17,7 @@
  *
  */
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -24,6 +25,49 @@
 #include "lmlog.h"
 #include "util.h"
 
+/* Pooled lbufs are allocated with their data, which starts after the
+ * aligned header */
+#define LBUF_POOL_HDR_LEN   ((sizeof(lbuf_t) + 15) & ~15)
+
+typedef struct lbuf_pool_class {
+    uint32_t size;          /* headroom plus data of the buffers */
+    lbuf_t *free;           /* free buffers, linked through list.next */
+    uint32_t nfree;
+    uint32_t in_use;
+    uint32_t peak;          /* high-water mark of in_use */
+    uint64_t allocs;
+    uint64_t misses;        /* allocations not served from the free list */
+} lbuf_pool_class_t;
+
+typedef struct lbuf_pool {
+    lbuf_pool_class_t classes[LBUF_POOL_CLASSES];
+    uint64_t oversize;      /* allocations bigger than the biggest class */
+    struct lbuf_pool *next;
+} lbuf_pool_t;
+
+/* Each thread has its own pools, without locking. Pooled buffers have to be
+ * released by the thread that obtained them. The pools of all the threads
+ * are linked for lbuf_pool_dump, and kept if the thread exits */
+static __thread lbuf_pool_t *lbuf_pool = NULL;
+static uint32_t lbuf_pool_sizes[LBUF_POOL_CLASSES] = LBUF_POOL_SIZES;
+static lbuf_pool_t *lbuf_pools = NULL;
+static pthread_mutex_t lbuf_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static lbuf_pool_t *
+lbuf_thread_pool()
+{
+    lbuf_pool_t *pool = lbuf_pool;
+
+    if (unlikely(!pool)) {
+        pool = xzalloc(sizeof(lbuf_pool_t));
+        pthread_mutex_lock(&lbuf_pools_lock);
+        pool->next = lbuf_pools;
+        lbuf_pools = pool;
+        pthread_mutex_unlock(&lbuf_pools_lock);
+        lbuf_pool = pool;
+    }
+    return (pool);
+}
 
 static void
 lbuf_init__(lbuf_t *b, uint32_t allocated, lbuf_source_e source)
@@ -86,13 +130,126 @@ lbuf_new(uint32_t size)
     return b;
 }
 
-inline void
-lbuf_del(lbuf_t *b)
+static void
+lbuf_pool_release(lbuf_t *b)
 {
-    if (b) {
-        lbuf_uninit(b);
+    lbuf_pool_class_t *pc = &lbuf_thread_pool()->classes[b->pool_class - 1];
+
+    /* Data moved out of the pooled memory by a resize */
+    lbuf_uninit(b);
+    pc->in_use--;
+    if (pc->nfree >= LBUF_POOL_MAX_FREE) {
         free(b);
+        return;
+    }
+    b->list.next = (struct ovs_list *)pc->free;
+    pc->free = b;
+    pc->nfree++;
+}
+
+/* Releases a reference to 'b'. The last one frees it or returns it to its
+ * pool */
+void
+lbuf_del(lbuf_t *b)
+{
+    if (!b) {
+        return;
+    }
+    if (b->refcnt > 1) {
+        b->refcnt--;
+        return;
+    }
+    if (b->pool_class) {
+        lbuf_pool_release(b);
+        return;
     }
+    lbuf_uninit(b);
+    free(b);
+}
+
+/* Returns an lbuf with at least 'size' bytes of data and 'headroom' bytes
+ * of headroom from the pool of the smallest class that fits. Unlike
+ * lbuf_new, the memory of the buffer is not zeroed. Requests larger than
+ * the biggest class are served by lbuf_new_with_headroom */
+lbuf_t *
+lbuf_pool_new(uint32_t size, uint32_t headroom)
+{
+    lbuf_pool_t *pool = lbuf_thread_pool();
+    lbuf_pool_class_t *pc;
+    lbuf_t *b;
+    int c;
+
+    for (c = 0; c < LBUF_POOL_CLASSES; c++) {
+        if (lbuf_pool_sizes[c] >= size + headroom) {
+            break;
+        }
+    }
+    if (c == LBUF_POOL_CLASSES) {
+        pool->oversize++;
+        return (lbuf_new_with_headroom(size, headroom));
+    }
+
+    pc = &pool->classes[c];
+    if (pc->free) {
+        b = pc->free;
+        pc->free = (lbuf_t *)b->list.next;
+        pc->nfree--;
+    } else {
+        b = xmalloc(LBUF_POOL_HDR_LEN + lbuf_pool_sizes[c]);
+        pc->misses++;
+    }
+    pc->allocs++;
+    if (++pc->in_use > pc->peak) {
+        pc->peak = pc->in_use;
+    }
+
+    lbuf_use__(b, (uint8_t *)b + LBUF_POOL_HDR_LEN, lbuf_pool_sizes[c],
+            LBUF_POOL);
+    b->refcnt = 1;
+    b->pool_class = c + 1;
+    b->data = (uint8_t *)b->base + headroom;
+    return (b);
+}
+
+/* Totals of the pools of all the threads. The counters of other threads
+ * are read while they run, so they are approximate. Buffers released by
+ * another thread than the one that obtained them are counted in use by the
+ * first and free by the second, so only the totals are meaningful */
+void
+lbuf_pool_dump(int log_level)
+{
+    lbuf_pool_t *pool;
+    lbuf_pool_class_t *pc, total;
+    uint64_t oversize = 0;
+    int c, threads = 0;
+
+    if (!is_loggable(log_level)) {
+        return;
+    }
+
+    pthread_mutex_lock(&lbuf_pools_lock);
+    for (pool = lbuf_pools; pool; pool = pool->next) {
+        oversize += pool->oversize;
+        threads++;
+    }
+    LMLOG(log_level, "*** lbuf pool, %d threads (oversize allocations: %lu) "
+            "***", threads, (unsigned long)oversize);
+    for (c = 0; c < LBUF_POOL_CLASSES; c++) {
+        memset(&total, 0, sizeof(total));
+        for (pool = lbuf_pools; pool; pool = pool->next) {
+            pc = &pool->classes[c];
+            total.in_use += pc->in_use;
+            total.peak += pc->peak;
+            total.nfree += pc->nfree;
+            total.allocs += pc->allocs;
+            total.misses += pc->misses;
+        }
+        LMLOG(log_level, "%5u bytes: in use %u, peak %u, free %u, allocs %lu, "
+                "misses %lu", lbuf_pool_sizes[c], total.in_use, total.peak,
+                total.nfree, (unsigned long)total.allocs,
+                (unsigned long)total.misses);
+    }
+    pthread_mutex_unlock(&lbuf_pools_lock);
 }
 
 lbuf_t *
@@ -112,13 +269,17 @@ lbuf_resize_(lbuf_t *b, uint32_t new_headroom, size_t new_tailroom)
     uint32_t new_allocated = new_headroom + b->size + new_tailroom;
     uint32_t diff_offset = new_headroom - lbuf_headroom(b);
 
-    if (new_headroom == lbuf_headroom(b)) {
+    if (new_headroom == lbuf_headroom(b) && b->source == LBUF_MALLOC) {
         b->base = xrealloc(b->base, new_allocated);
     } else {
+        /* Memory not from malloc (stack, pool) is left to its owner */
         new_base = xmalloc(new_allocated);
         memcpy((uint8_t *)new_base + new_headroom, b->data, b->size);
-        free(b->base);
+        if (b->source == LBUF_MALLOC) {
+            free(b->base);
+        }
         b->base = new_base;
+        b->source = LBUF_MALLOC;
         if (b->ip != UINT16_MAX){
             b->ip = b->ip + diff_offset;
         }
@@ -207,11 +368,22 @@ lbuf_t *
 lbuf_clone(lbuf_t *b)
 {
     lbuf_t *new_buf = lbuf_new(b->size);
-    lbuf_put(new_buf->data, b->data, b->size);
+    lbuf_put(new_buf, b->data, b->size);
     new_buf->lisp = b->lisp;
     return new_buf;
 }
 
+/* Copy of the IP packet in 'b' with 'headroom' bytes to push headers. It is
+ * never pooled, so any thread may release it */
+lbuf_t *
+lbuf_clone_packet(lbuf_t *b, uint32_t headroom)
+{
+    lbuf_t *new_buf = lbuf_new_with_headroom(b->size, headroom);
+    lbuf_put(new_buf, b->data, b->size);
+    lbuf_reset_ip(new_buf);
+    return new_buf;
+}
+
 inline int lbuf_point_to_ip(lbuf_t *b)
 {
     if (b->ip == UINT16_MAX){
@@ -28,9 +28,16 @@
 
 #define LBUF_STACK_OFFSET 100
 
+/* Size classes (headroom plus data) of the pool of control buffers and
+ * number of free buffers kept per class */
+#define LBUF_POOL_CLASSES   3
+#define LBUF_POOL_SIZES     {512, 2048, 4608}
+#define LBUF_POOL_MAX_FREE  64
+
 typedef enum lbuf_source {
     LBUF_MALLOC,
-    LBUF_STACK
+    LBUF_STACK,
+    LBUF_POOL       /* 'base' is in the same allocation as the lbuf */
 } lbuf_source_e;
 
 struct lbuf {
@@ -48,6 +55,9 @@ struct lbuf {
 
     uint16_t lisp;              /* lisp payload offset */
 
+    uint16_t refcnt;            /* references to the lbuf, 0 same as 1 */
+    uint8_t pool_class;         /* class + 1 if the lbuf is pooled, else 0 */
+
     lbuf_source_e source;       /* source of memory allocated as 'base' */
     void *base;                 /* start of allocated space */
     void *data;                 /* start of in-use space */
@@ -62,7 +72,11 @@ void lbuf_uninit(lbuf_t *);
 lbuf_t *lbuf_new(uint32_t);
 lbuf_t *lbuf_new_with_headroom(uint32_t, uint32_t);
 lbuf_t *lbuf_clone(lbuf_t *);
-inline void lbuf_del(lbuf_t *);
+lbuf_t *lbuf_clone_packet(lbuf_t *, uint32_t);
+void lbuf_del(lbuf_t *);
+lbuf_t *lbuf_pool_new(uint32_t, uint32_t);
+void lbuf_pool_dump(int log_level);
+static inline lbuf_t *lbuf_ref(lbuf_t *);
 
 
 static inline void *lbuf_at(const lbuf_t *, uint32_t, uint32_t);
@@ -107,6 +121,14 @@ static inline void lbuf_reset_lisp_hdr(lbuf_t *b);
 static inline void *lbuf_lisp_hdr(lbuf_t*);
 inline int lbuf_point_to_lisp_hdr(lbuf_t *b);
 
+/* Takes a reference to 'b'. Each reference is released with lbuf_del */
+static inline lbuf_t *
+lbuf_ref(lbuf_t *b)
+{
+    b->refcnt = b->refcnt ? b->refcnt + 1 : 2;
+    return (b);
+}
+
 static inline void
 lbuf_set_base(lbuf_t *b, void *bs)
 {
@@ -18,6 +18,7 @@
  */
 
 #include "lisp_site.h"
+#include "lmlog.h"
 #include "timers_utils.h"
 #include "../defs.h"
 #include "../lispd_external.h"
@@ -34,6 +35,11 @@ lisp_site_prefix_init(lisp_addr_t *eid, uint32_t iid, int key_type, char *key,
     sp->iid = iid;
     sp->key_type = key_type;
     sp->key = strdup(key);
+    sp->hmac_key = hmac_key_new(key_type, key);
+    if (!sp->hmac_key) {
+        LMLOG(LWRN, "Unsupported key type %d of site %s. Its registrations "
+                "will be rejected", key_type, lisp_addr_to_char(eid));
+    }
     sp->accept_more_specifics = more_specifics;
     sp->proxy_reply = proxy_reply;
     sp->merge = merge;
@@ -50,6 +56,7 @@ lisp_site_prefix_del(lisp_site_prefix_t *sp)
         lisp_addr_del(sp->eid_prefix);
     if (sp->key)
         free(sp->key);
+    hmac_key_del(sp->hmac_key);
     free(sp);
 }
 
@@ -58,5 +65,7 @@ lisp_reg_site_del(lisp_reg_site_t *rs)
 {
     stop_timers_from_obj(rs,ptrs_to_timers_ht,nonces_ht);
     mapping_del(rs->site_map);
+    free(rs->rec);
+    free(rs->mrep_rec);
     free(rs);
 }
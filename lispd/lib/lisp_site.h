@@ -30,11 +30,23 @@ typedef struct lisp_site_prefix {
     uint8_t accept_more_specifics;
     lisp_key_type_e key_type;
     char *key;
+    hmac_key_t *hmac_key;   /* Precomputed from key */
     uint8_t merge;
 } lisp_site_prefix_t;
 
 typedef struct lisp_reg_site {
     mapping_t *site_map;
+    lisp_site_prefix_t *site;   /* Configured prefix that accepted it */
+    lmtimer_t *expiry_timer;
+    /* Last registered record, as received, to recognize refreshes that
+     * don't change it without parsing them */
+    uint8_t *rec;
+    uint16_t rec_len;
+    uint16_t eid_len;           /* Length of the EID-prefix field of rec */
+    /* Record of the Map-Replies sent on behalf of the site, serialized
+     * again each time site_map changes */
+    uint8_t *mrep_rec;
+    uint16_t mrep_rec_len;
 } lisp_reg_site_t;
 
 lisp_site_prefix_t *lisp_site_prefix_init(lisp_addr_t *eid_prefix, uint32_t iid,
@@ -0,0 +1,253 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lpm.h"
+#include "util.h"
+#include "../defs.h"
+
+#define LPM_STRIDE  8
+
+/* Index in the prefix bitmap of the prefix of 'len' (1 to 8) bits of 'b' */
+#define lpm_pref_idx(_len, _b) ((1 << (_len)) - 2 + ((_b) >> (LPM_STRIDE - (_len))))
+
+static inline int
+bm_test(const uint64_t *bm, int i)
+{
+    return ((bm[i >> 6] >> (i & 63)) & 1);
+}
+
+/* Number of bits set in 'bm' before bit 'i' */
+static inline int
+bm_rank(const uint64_t *bm, const uint16_t *rank, int i)
+{
+    return (rank[i >> 6]
+            + __builtin_popcountll(bm[i >> 6] & ((1ULL << (i & 63)) - 1)));
+}
+
+static void
+bm_set(uint64_t *bm, uint16_t *rank, int nwords, int i, int val)
+{
+    int w;
+
+    if (val) {
+        bm[i >> 6] |= 1ULL << (i & 63);
+    } else {
+        bm[i >> 6] &= ~(1ULL << (i & 63));
+    }
+    for (w = 1; w < nwords; w++) {
+        rank[w] = rank[w - 1] + __builtin_popcountll(bm[w - 1]);
+    }
+}
+
+/* Insert 'elt' at position 'pos' of the array '*arr' of 'n' pointers */
+static void
+ptr_array_insert(void ***arr, int n, int pos, void *elt)
+{
+    *arr = xrealloc(*arr, (n + 1) * sizeof(void *));
+    memmove(*arr + pos + 1, *arr + pos, (n - pos) * sizeof(void *));
+    (*arr)[pos] = elt;
+}
+
+static void
+ptr_array_remove(void ***arr, int n, int pos)
+{
+    memmove(*arr + pos, *arr + pos + 1, (n - pos - 1) * sizeof(void *));
+    if (n == 1) {
+        free(*arr);
+        *arr = NULL;
+    } else {
+        *arr = xrealloc(*arr, (n - 1) * sizeof(void *));
+    }
+}
+
+static void
+lpm_node_del(lpm_node_t *node)
+{
+    int i;
+
+    for (i = 0; i < node->n_child; i++) {
+        lpm_node_del(node->child[i]);
+    }
+    free(node->child);
+    free(node->data);
+    free(node);
+}
+
+/* 'maxbits' is 32 for IPv4 and 128 for IPv6 */
+lpm_t *
+lpm_new(int maxbits)
+{
+    lpm_t *lpm;
+
+    if (maxbits <= 0 || maxbits > LPM_MAX_DEPTH * LPM_STRIDE
+            || maxbits % LPM_STRIDE != 0) {
+        return (NULL);
+    }
+
+    lpm = xzalloc(sizeof(lpm_t));
+    lpm->root = xzalloc(sizeof(lpm_node_t));
+    lpm->depth = maxbits / LPM_STRIDE;
+    lpm->n_nodes = 1;
+    return (lpm);
+}
+
+/* The data of the prefixes is not freed */
+void
+lpm_del(lpm_t *lpm)
+{
+    if (!lpm) {
+        return;
+    }
+    lpm_node_del(lpm->root);
+    free(lpm);
+}
+
+/* Add the prefix 'addr'/'plen' with 'data', replacing its previous data if
+ * it was already present. The bits of 'addr' beyond 'plen' are ignored */
+int
+lpm_add(lpm_t *lpm, const uint8_t *addr, uint8_t plen, void *data)
+{
+    lpm_node_t *node, *child;
+    int d, len, i, pos;
+
+    if (plen > lpm->depth * LPM_STRIDE) {
+        return (BAD);
+    }
+    if (plen == 0) {
+        lpm->dflt = data;
+        return (GOOD);
+    }
+
+    node = lpm->root;
+    for (d = 0; d < (plen - 1) / LPM_STRIDE; d++) {
+        pos = bm_rank(node->child_bm, node->child_rank, addr[d]);
+        if (!bm_test(node->child_bm, addr[d])) {
+            child = xzalloc(sizeof(lpm_node_t));
+            ptr_array_insert((void ***)&node->child, node->n_child, pos, child);
+            bm_set(node->child_bm, node->child_rank, 4, addr[d], 1);
+            node->n_child++;
+            lpm->n_nodes++;
+        }
+        node = node->child[pos];
+    }
+
+    len = plen - d * LPM_STRIDE;
+    i = lpm_pref_idx(len, addr[d]);
+    pos = bm_rank(node->pref_bm, node->pref_rank, i);
+    if (bm_test(node->pref_bm, i)) {
+        node->data[pos] = data;
+        return (GOOD);
+    }
+    ptr_array_insert(&node->data, node->n_pref, pos, data);
+    bm_set(node->pref_bm, node->pref_rank, 8, i, 1);
+    node->n_pref++;
+    return (GOOD);
+}
+
+/* Remove the prefix 'addr'/'plen'. Returns its data or NULL if it was not
+ * present */
+void *
+lpm_remove(lpm_t *lpm, const uint8_t *addr, uint8_t plen)
+{
+    lpm_node_t *path[LPM_MAX_DEPTH];
+    lpm_node_t *node;
+    void *data;
+    int d, len, i, pos;
+
+    if (plen > lpm->depth * LPM_STRIDE) {
+        return (NULL);
+    }
+    if (plen == 0) {
+        data = lpm->dflt;
+        lpm->dflt = NULL;
+        return (data);
+    }
+
+    node = lpm->root;
+    for (d = 0; d < (plen - 1) / LPM_STRIDE; d++) {
+        if (!bm_test(node->child_bm, addr[d])) {
+            return (NULL);
+        }
+        path[d] = node;
+        node = node->child[bm_rank(node->child_bm, node->child_rank, addr[d])];
+    }
+
+    len = plen - d * LPM_STRIDE;
+    i = lpm_pref_idx(len, addr[d]);
+    if (!bm_test(node->pref_bm, i)) {
+        return (NULL);
+    }
+    pos = bm_rank(node->pref_bm, node->pref_rank, i);
+    data = node->data[pos];
+    ptr_array_remove(&node->data, node->n_pref, pos);
+    bm_set(node->pref_bm, node->pref_rank, 8, i, 0);
+    node->n_pref--;
+
+    /* Free the nodes left empty, but the root */
+    while (d > 0 && node->n_pref == 0 && node->n_child == 0) {
+        d--;
+        free(node);
+        lpm->n_nodes--;
+        node = path[d];
+        pos = bm_rank(node->child_bm, node->child_rank, addr[d]);
+        ptr_array_remove((void ***)&node->child, node->n_child, pos);
+        bm_set(node->child_bm, node->child_rank, 4, addr[d], 0);
+        node->n_child--;
+    }
+
+    return (data);
+}
+
+/* Returns the data of the longest prefix that contains the address 'addr',
+ * or NULL if there is none. Descends to the deepest node on the path of
+ * 'addr' and then checks the prefixes of the nodes back up */
+void *
+lpm_lookup(lpm_t *lpm, const uint8_t *addr)
+{
+    lpm_node_t *path[LPM_MAX_DEPTH];
+    lpm_node_t *node = lpm->root;
+    int d = 0, len, i;
+
+    while (1) {
+        path[d] = node;
+        if (d + 1 == lpm->depth || !bm_test(node->child_bm, addr[d])) {
+            break;
+        }
+        node = node->child[bm_rank(node->child_bm, node->child_rank, addr[d])];
+        d++;
+    }
+
+    for (; d >= 0; d--) {
+        node = path[d];
+        if (node->n_pref == 0) {
+            continue;
+        }
+        for (len = LPM_STRIDE; len > 0; len--) {
+            i = lpm_pref_idx(len, addr[d]);
+            if (bm_test(node->pref_bm, i)) {
+                return (node->data[bm_rank(node->pref_bm, node->pref_rank, i)]);
+            }
+        }
+    }
+
+    return (lpm->dflt);
+}
@@ -0,0 +1,62 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LPM_H_
+#define LPM_H_
+
+#include <stdint.h>
+
+/*
+ * Longest prefix match of IPv4 and IPv6 addresses with a compressed multibit
+ * trie (tree bitmap) of 8 bit strides. A node of depth d holds the prefixes
+ * of 8*d+1 to 8*d+8 bits starting with the d first bytes of its key, in a
+ * bitmap of 510 bits, and its children, in a bitmap of 256 bits. Only the
+ * prefixes and children present are stored, in arrays indexed by the number
+ * of bits set before theirs. An IPv4 lookup visits at most 4 nodes and an
+ * IPv6 one at most 16, without any allocation.
+ * Not thread safe: updates must exclude lookups.
+ */
+
+#define LPM_MAX_DEPTH   16
+
+typedef struct lpm_node_ {
+    uint64_t child_bm[4];
+    uint64_t pref_bm[8];
+    uint16_t child_rank[4];     /* bits set in the previous words */
+    uint16_t pref_rank[8];
+    uint16_t n_child;
+    uint16_t n_pref;
+    struct lpm_node_ **child;
+    void **data;
+} lpm_node_t;
+
+typedef struct lpm_ {
+    lpm_node_t *root;
+    void *dflt;                 /* data of the 0 bits prefix */
+    int depth;                  /* bytes of the addresses */
+    int n_nodes;
+} lpm_t;
+
+lpm_t *lpm_new(int maxbits);
+void lpm_del(lpm_t *lpm);
+int lpm_add(lpm_t *lpm, const uint8_t *addr, uint8_t plen, void *data);
+void *lpm_remove(lpm_t *lpm, const uint8_t *addr, uint8_t plen);
+void *lpm_lookup(lpm_t *lpm, const uint8_t *addr);
+
+#endif /* LPM_H_ */
@@ -24,6 +24,12 @@
 #include "timers_utils.h"
 #include "../defs.h"
 
+/* Bytes of the packets queued in all the entries */
+static uint32_t mce_pending_bytes = 0;
+
+/* Memory of a locator of an entry, including its address and list entry */
+#define MCE_LOCATOR_MEM (sizeof(locator_t) + sizeof(lisp_addr_t) \
+        + sizeof(glist_entry_t))
 
 
 inline mcache_entry_t *
@@ -34,6 +40,7 @@ mcache_entry_new()
 
     mce->active = NOT_ACTIVE;
     mce->timestamp = time(NULL);
+    mce->gen = fwd_gen_new();
 
     return(mce);
 }
@@ -65,15 +72,65 @@ mcache_entry_del(mcache_entry_t *entry)
 
     stop_timers_from_obj(entry,ptrs_to_timers_ht, nonces_ht);
 
+    mce_pending_bytes -= entry->pending_bytes;
+    glist_destroy(entry->pending_pkts);
+
     mapping_del(mcache_entry_mapping(entry));
 
     if (entry->routing_info != NULL){
         entry->routing_inf_del(entry->routing_info);
     }
+    fwd_gen_del(entry->gen);
 
     free(entry);
 }
 
+/* Queue the packet 'b' until the entry is resolved. Takes ownership of 'b',
+ * which has to be allocated with lbuf_clone_packet, if it returns GOOD.
+ * Returns BAD if the entry already holds 'max_pkts' packets or all the
+ * entries 'max_bytes' bytes */
+int
+mcache_entry_queue_packet(mcache_entry_t *mce, lbuf_t *b, int max_pkts,
+        uint32_t max_bytes)
+{
+    if (!mce->pending_pkts) {
+        mce->pending_pkts = glist_new_managed((glist_del_fct)lbuf_del);
+    }
+    if (glist_size(mce->pending_pkts) >= max_pkts
+            || mce_pending_bytes + lbuf_size(b) > max_bytes) {
+        LMLOG(LDBG_3, "mcache_entry_queue_packet: No room for more packets "
+                "to %s", lisp_addr_to_char(mapping_eid(mce->mapping)));
+        return (BAD);
+    }
+
+    glist_add_tail(b, mce->pending_pkts);
+    mce->pending_bytes += lbuf_size(b);
+    mce_pending_bytes += lbuf_size(b);
+    return (GOOD);
+}
+
+/* Returns the packets queued in the entry, in arrival order, and empties the
+ * queue. The caller has to destroy the list */
+glist_t *
+mcache_entry_take_pending_packets(mcache_entry_t *mce)
+{
+    glist_t *pkts = mce->pending_pkts;
+
+    mce_pending_bytes -= mce->pending_bytes;
+    mce->pending_pkts = NULL;
+    mce->pending_bytes = 0;
+    return (pkts);
+}
+
+/* Approximate memory used by the entry, without its queued packets, which
+ * have their own limit */
+uint32_t
+mcache_entry_mem(mcache_entry_t *mce)
+{
+    return (sizeof(mcache_entry_t) + sizeof(mapping_t) + sizeof(fwd_gen_t)
+            + mapping_locator_count(mce->mapping) * MCE_LOCATOR_MEM);
+}
+
 inline uint8_t
 mcache_has_locators(mcache_entry_t *m)
 {
@@ -20,6 +20,9 @@
 #ifndef MAP_CACHE_ENTRY_H_
 #define MAP_CACHE_ENTRY_H_
 
+#include "fwd_gen.h"
+#include "../elibs/ovs/list.h"
+#include "lbuf.h"
 #include "timers.h"
 #include "../liblisp/lisp_mapping.h"
 
@@ -56,11 +59,23 @@ typedef struct map_cache_entry_ {
     /* Routing info */
     void *                  routing_info;
     routing_info_del_fct    routing_inf_del;
+    /* Increased when the routing info changes */
+    fwd_gen_t *             gen;
 
     glist_t *timers_lst;
 
     /* EID that requested the mapping. Helps with timers */
     lisp_addr_t *requester;
+
+    /* Packets to the EID waiting for the Map-Reply of a NOT_ACTIVE entry
+     * <lbuf_t *> */
+    glist_t *pending_pkts;
+    uint32_t pending_bytes;
+
+    /* Position in the eviction order of the map cache and memory accounted
+     * for the entry. Not used by static entries */
+    struct ovs_list lru;
+    uint32_t mem;
 } mcache_entry_t;
 
 mcache_entry_t *mcache_entry_new();
@@ -69,6 +84,10 @@ void mcache_entry_init_static(mcache_entry_t *, mapping_t *);
 
 
 void mcache_entry_del(mcache_entry_t *entry);
+int mcache_entry_queue_packet(mcache_entry_t *mce, lbuf_t *b, int max_pkts,
+        uint32_t max_bytes);
+glist_t *mcache_entry_take_pending_packets(mcache_entry_t *mce);
+uint32_t mcache_entry_mem(mcache_entry_t *mce);
 void map_cache_entry_dump(mcache_entry_t *entry, int log_level);
 
 static inline mapping_t *mcache_entry_mapping(mcache_entry_t*);
@@ -79,6 +98,7 @@ inline uint8_t mcache_has_locators(mcache_entry_t *m);
 static inline void *mcache_entry_routing_info(mcache_entry_t *);
 static inline void mcache_entry_set_routing_info(mcache_entry_t *, void *,
         routing_info_del_fct);
+static inline fwd_gen_t *mcache_entry_gen(mcache_entry_t *);
 
 
 static inline mapping_t *
@@ -119,5 +139,11 @@ mcache_entry_set_routing_info(mcache_entry_t *m, void *routing_inf, routing_info
     m->routing_inf_del = del_fct;
 }
 
+static inline fwd_gen_t *
+mcache_entry_gen(mcache_entry_t *m)
+{
+    return (m->gen);
+}
+
 
 #endif /* MAP_CACHE_ENTRY_H_ */
@@ -60,11 +60,18 @@ map_local_entry_eid(map_local_entry_t *mle){
     return (mapping_eid(map_local_entry_mapping(mle)));
 }
 
+inline fwd_gen_t *
+map_local_entry_gen(map_local_entry_t *mle)
+{
+    return (mle->gen);
+}
+
 map_local_entry_t *
 map_local_entry_new()
 {
 	map_local_entry_t *mle;
 	mle = xzalloc(sizeof(map_local_entry_t));
+	mle->gen = fwd_gen_new();
 
 	return (mle);
 }
@@ -80,6 +87,7 @@ map_local_entry_new_init(mapping_t *map)
         return (NULL);
     }
     mle->mapping = map;
+    mle->gen = fwd_gen_new();
 
     return (mle);
 }
@@ -101,6 +109,7 @@ map_local_entry_del(map_local_entry_t *mle)
 	if (mle->fwd_info != NULL){
 	    mle->fwd_inf_del(mle->fwd_info);
 	}
+	fwd_gen_del(mle->gen);
 	free(mle);
 }
 
@@ -20,6 +20,7 @@
 #ifndef MAP_LOCAL_ENTRY_H_
 #define MAP_LOCAL_ENTRY_H_
 
+#include "fwd_gen.h"
 #include "../liblisp/lisp_mapping.h"
 
 typedef void (*fwd_info_del_fct)(void *);
@@ -28,6 +29,8 @@ typedef struct map_local_entry_ {
     mapping_t *         mapping;
     void *              fwd_info;
     fwd_info_del_fct    fwd_inf_del;
+    /* Increased when the forwarding info changes */
+    fwd_gen_t *         gen;
 } map_local_entry_t;
 
 map_local_entry_t *map_local_entry_new();
@@ -44,6 +47,7 @@ inline void *map_local_entry_fwd_info(map_local_entry_t *mle);
 inline void map_local_entry_set_fwd_info(map_local_entry_t *mle, void *fwd_info,
 		fwd_info_del_fct fwd_del_fct);
 inline lisp_addr_t *map_local_entry_eid(map_local_entry_t *mle);
+inline fwd_gen_t *map_local_entry_gen(map_local_entry_t *mle);
 
 
 #endif /* MAP_LOCAL_ENTRY_H_ */
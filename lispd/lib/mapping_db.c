@@ -37,6 +37,7 @@ void *pt_remove_mc_addr(patricia_tree_t *pt, lcaf_addr_t *mcaddr);
 void *pt_remove_ippref(patricia_tree_t *pt, ip_prefix_t *ippref);
 
 patricia_node_t *pt_find_ip_node(patricia_tree_t *pt, ip_addr_t *ipaddr);
+int pt_common_plen(patricia_tree_t *pt, ip_addr_t *ipaddr);
 patricia_node_t *pt_find_ip_node_exact(patricia_tree_t *pt, ip_addr_t *ipaddr,
         uint8_t prefixlen);
 patricia_node_t *pt_find_mc_node(patricia_tree_t *pt, lcaf_addr_t *mcaddr,
@@ -71,6 +72,22 @@ get_ip_pt_from_afi(mdb_t *db, uint16_t afi)
     return (NULL);
 }
 
+static lpm_t *
+get_ip_lpm_from_afi(mdb_t *db, uint16_t afi)
+{
+    switch (afi) {
+    case AF_INET:
+        return (db->AF4_ip_lpm);
+    case AF_INET6:
+        return (db->AF6_ip_lpm);
+    default:
+        LMLOG(LDBG_1, "get_ip_lpm_from_afi: AFI %u not recognized!", afi);
+        break;
+    }
+
+    return (NULL);
+}
+
 static patricia_tree_t *
 get_mc_pt_from_afi(mdb_t *db, uint16_t afi)
 {
@@ -180,19 +197,42 @@ _get_grp_pt_for_mc_addr(patricia_tree_t *strie, lcaf_addr_t *mcaddr,
 static int
 _add_ippref_entry(mdb_t *db, void *entry, ip_prefix_t *ippref)
 {
-    if (pt_add_ippref(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref,
-            entry) != GOOD) {
+    patricia_node_t *node;
+
+    node = pt_add_node(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)),
+            ip_prefix_addr(ippref), ip_prefix_get_plen(ippref), entry);
+    if (!node) {
         LMLOG(LDBG_3, "_add_ippref_entry: Attempting to insert (%s) in the "
                 "map-cache but couldn't add the entry to the pt!",
                 ip_prefix_to_char(ippref));
         return (BAD);
     }
 
+    /* An existing node keeps its data */
+    lpm_add(get_ip_lpm_from_afi(db, ip_prefix_afi(ippref)),
+            ip_addr_get_addr(ip_prefix_addr(ippref)),
+            ip_prefix_get_plen(ippref), node->data);
+
     LMLOG(LDBG_3, "_add_ippref_entry: Added map cache data for %s",
             ip_prefix_to_char(ippref));
     return (GOOD);
 }
 
+static void *
+_del_ippref_entry(mdb_t *db, ip_prefix_t *ippref)
+{
+    void *data;
+
+    data = pt_remove_ippref(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)),
+            ippref);
+    if (data) {
+        lpm_remove(get_ip_lpm_from_afi(db, ip_prefix_afi(ippref)),
+                ip_addr_get_addr(ip_prefix_addr(ippref)),
+                ip_prefix_get_plen(ippref));
+    }
+    return (data);
+}
+
 static int
 _add_mc_entry(mdb_t *db, void *entry, lcaf_addr_t *mcaddr)
 {
@@ -308,6 +348,9 @@ mdb_new()
     db->AF4_mc_db = New_Patricia(sizeof(struct in_addr) * 8);
     db->AF6_mc_db = New_Patricia(sizeof(struct in6_addr) * 8);
 
+    db->AF4_ip_lpm = lpm_new(sizeof(struct in_addr) * 8);
+    db->AF6_ip_lpm = lpm_new(sizeof(struct in6_addr) * 8);
+
     if (!db->AF4_ip_db->head->data || !db->AF6_ip_db->head->data
         || !db->AF4_mc_db || !db->AF6_mc_db) {
         LMLOG(LCRIT, "mdb_init: Unable to allocate memory for mdb");
@@ -329,6 +372,9 @@ mdb_del(mdb_t *db, mdb_del_fct del_fct)
     Destroy_Patricia(db->AF6_ip_db->head->data, del_fct);
     Destroy_Patricia(db->AF6_ip_db, NULL);
 
+    lpm_del(db->AF4_ip_lpm);
+    lpm_del(db->AF6_ip_lpm);
+
     if (db->AF4_mc_db->head) {
         PATRICIA_WALK(db->AF4_mc_db->head, node) {
             Destroy_Patricia(node->data, del_fct);
@@ -390,13 +436,11 @@ mdb_remove_entry(mdb_t *db, lisp_addr_t *laddr)
         taddr = lisp_addr_clone(laddr);
         lisp_addr_ip_to_ippref(taddr);
         ippref = lisp_addr_get_ippref(taddr);
-        ret = pt_remove_ippref(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref);
+        ret = _del_ippref_entry(db, ippref);
         lisp_addr_del(taddr);
         break;
     case LM_AFI_IPPREF:
-        ippref = lisp_addr_get_ippref(laddr);
-        ret = pt_remove_ippref(
-                get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref);
+        ret = _del_ippref_entry(db, lisp_addr_get_ippref(laddr));
         break;
     case LM_AFI_LCAF:
         ret = _del_lcaf_entry(db, lisp_addr_get_lcaf(laddr));
@@ -417,6 +461,19 @@ void *
 mdb_lookup_entry(mdb_t *db, lisp_addr_t *laddr)
 {
     patricia_node_t *node;
+    lpm_t *lpm;
+
+    switch (lisp_addr_lafi(laddr)) {
+    case LM_AFI_IP:
+    case LM_AFI_IPPREF:
+        lpm = get_ip_lpm_from_afi(db, lisp_addr_ip_afi(laddr));
+        if (!lpm) {
+            return(NULL);
+        }
+        return(lpm_lookup(lpm, ip_addr_get_addr(lisp_addr_ip_get_addr(laddr))));
+    default:
+        break;
+    }
 
     node = _find_node(db, laddr, NOT_EXACT);
     if (node)
@@ -436,6 +493,59 @@ mdb_lookup_entry_exact(mdb_t *db, lisp_addr_t *laddr)
         return(NULL);
 }
 
+/* Returns the number of leading bits that the IP address or prefix 'laddr'
+ * has in common with the closest entry of 'db' of its family, at most the
+ * length of that entry. The prefix of 'laddr' one bit longer doesn't overlap
+ * any entry. Returns -1 if there are no entries of the family */
+int
+mdb_common_plen(mdb_t *db, lisp_addr_t *laddr)
+{
+    patricia_tree_t *pt;
+
+    if (lisp_addr_lafi(laddr) != LM_AFI_IP
+            && lisp_addr_lafi(laddr) != LM_AFI_IPPREF) {
+        LMLOG(LDBG_3, "mdb_common_plen: called with AFI not IP or IPPREF");
+        return(-1);
+    }
+
+    pt = get_ip_pt_from_afi(db, lisp_addr_ip_afi(laddr));
+    if (!pt) {
+        return(-1);
+    }
+    return(pt_common_plen(pt, lisp_addr_ip_get_addr(laddr)));
+}
+
+/* Returns the data of the most specific entry strictly less specific than
+ * the IP prefix 'laddr' that covers it, or NULL if there is none */
+void *
+mdb_lookup_entry_covering(mdb_t *db, lisp_addr_t *laddr)
+{
+    patricia_tree_t *pt;
+    patricia_node_t *node;
+    prefix_t *prefix;
+    int plen;
+
+    if (lisp_addr_lafi(laddr) != LM_AFI_IP
+            && lisp_addr_lafi(laddr) != LM_AFI_IPPREF) {
+        LMLOG(LDBG_3, "mdb_lookup_entry_covering: called with AFI not IP or "
+                "IPPREF");
+        return(NULL);
+    }
+
+    plen = lisp_addr_ip_get_plen(laddr);
+    pt = get_ip_pt_from_afi(db, lisp_addr_ip_afi(laddr));
+    if (!pt || plen == 0) {
+        return(NULL);
+    }
+    prefix = pt_make_ip_prefix(lisp_addr_ip_get_addr(laddr), plen - 1);
+    node = patricia_search_best2(pt, prefix, 1);
+    Deref_Prefix(prefix);
+    if (node) {
+        return(node->data);
+    }
+    return(NULL);
+}
+
 inline int
 mdb_n_entries(mdb_t *mdb) {
     return(mdb->n_entries);
@@ -652,6 +762,56 @@ pt_find_ip_node(patricia_tree_t *pt, ip_addr_t *ipaddr)
     return(node);
 }
 
+/* Descends the trie as an insertion of 'ipaddr' would. The prefix where it
+ * stops shares with 'ipaddr' the longest common prefix of all the entries */
+int
+pt_common_plen(patricia_tree_t *pt, ip_addr_t *ipaddr)
+{
+    patricia_node_t *node;
+    uint8_t *addr, *test_addr;
+    uint32_t bitlen, check_bit, differ_bit;
+    uint8_t r;
+    int i;
+
+    node = pt->head;
+    if (!node) {
+        return(-1);
+    }
+
+    addr = ip_addr_get_addr(ipaddr);
+    bitlen = pt->maxbits;
+    while (node->bit < bitlen || node->prefix == NULL) {
+        if (node->bit < bitlen
+                && (addr[node->bit >> 3] & (0x80 >> (node->bit & 0x07)))) {
+            if (!node->r) {
+                break;
+            }
+            node = node->r;
+        } else {
+            if (!node->l) {
+                break;
+            }
+            node = node->l;
+        }
+    }
+
+    test_addr = prefix_touchar(node->prefix);
+    check_bit = (node->bit < bitlen) ? node->bit : bitlen;
+    differ_bit = 0;
+    for (i = 0; i * 8 < check_bit; i++) {
+        if ((r = (addr[i] ^ test_addr[i])) == 0) {
+            differ_bit = (i + 1) * 8;
+            continue;
+        }
+        for (differ_bit = i * 8; !(r & 0x80); r <<= 1) {
+            differ_bit++;
+        }
+        break;
+    }
+
+    return(differ_bit < check_bit ? differ_bit : check_bit);
+}
+
 patricia_node_t *pt_find_ip_node_exact(patricia_tree_t *pt, ip_addr_t *ipaddr, uint8_t prefixlen) {
     patricia_node_t *node;
     prefix_t        *prefix;
@@ -21,11 +21,14 @@
  * This defines a mappings database (mdb) that relies on patricia tries and hash tables
  * to store IP and LCAF based EIDs. Among the supported LCAFs are multicast of type (S,G) and IID.
  * It is used to implement both the mappings cache and the local mapping db.
+ * The IP entries are also indexed by a compressed multibit trie (lpm) that
+ * answers the longest prefix match lookups.
  */
 
 #ifndef LISPD_MDB_H_
 #define LISPD_MDB_H_
 
+#include "lpm.h"
 #include "../elibs/patricia/patricia.h"
 #include "../liblisp/lisp_address.h"
 
@@ -41,6 +44,8 @@ typedef struct {
     patricia_tree_t *AF6_ip_db;
     patricia_tree_t *AF4_mc_db;
     patricia_tree_t *AF6_mc_db;
+    lpm_t *AF4_ip_lpm;
+    lpm_t *AF6_ip_lpm;
     int n_entries;
 } mdb_t;
 
@@ -52,6 +57,8 @@ int mdb_add_entry(mdb_t *db, lisp_addr_t *addr, void *data);
 void *mdb_remove_entry(mdb_t *db, lisp_addr_t *laddr);
 void *mdb_lookup_entry(mdb_t *db, lisp_addr_t *laddr);
 void *mdb_lookup_entry_exact(mdb_t *db, lisp_addr_t *laddr);
+int mdb_common_plen(mdb_t *db, lisp_addr_t *laddr);
+void *mdb_lookup_entry_covering(mdb_t *db, lisp_addr_t *laddr);
 inline int mdb_n_entries(mdb_t *);
 
 patricia_tree_t *_get_local_db_for_lcaf_addr(mdb_t *db, lcaf_addr_t *lcaf);
@@ -25,11 +25,12 @@
 
 #include "nonces_table.h"
 #include "lmlog.h"
+#include "obj_pool.h"
 #include "util.h"
 
 
-int nonce_list_cmp_nonce(void *nonce1, void *nonce2);
-void nonce_list_free_nonce(void *nonce);
+static obj_pool_t nonces_lists_pool = OBJ_POOL_INIT("nonces_list_t",
+        nonces_list_t);
 
 
 htable_nonces_t *
@@ -47,10 +48,20 @@ htable_nonces_insert(htable_nonces_t *nonces_ht, uint64_t nonce,
 {
     khiter_t k;
     int ret;
-    uint64_t *nonce_val;
-    nonce_val = xmalloc(sizeof(uint64_t));
-    *nonce_val = nonce;
-    glist_add(nonce_val,nonces_lst->nonces_list);
+
+    /* Full, forget the oldest nonce */
+    if (nonces_lst->n_nonces == NONCES_LIST_MAX) {
+        k = kh_get(nonces,nonces_ht->ht, nonces_lst->nonces[0]);
+        if (k != kh_end(nonces_ht->ht)
+                && kh_value(nonces_ht->ht, k) == nonces_lst){
+            kh_del(nonces,nonces_ht->ht,k);
+        }
+        memmove(&nonces_lst->nonces[0], &nonces_lst->nonces[1],
+                (NONCES_LIST_MAX - 1) * sizeof(uint64_t));
+        nonces_lst->n_nonces--;
+    }
+    nonces_lst->nonces[nonces_lst->n_nonces++] = nonce;
+    nonces_lst->n_sent++;
     k = kh_put(nonces,nonces_ht->ht,nonce,&ret);
     kh_value(nonces_ht->ht, k) = nonces_lst;
 }
@@ -60,33 +71,35 @@ htable_nonces_remove(htable_nonces_t *nonces_ht, uint64_t nonce)
 {
     khiter_t k;
     nonces_list_t *nonces_lst;
+    int i;
 
     k = kh_get(nonces,nonces_ht->ht, nonce);
     if (k == kh_end(nonces_ht->ht)){
         return (NULL);
     }
     nonces_lst = kh_value(nonces_ht->ht, k);
-    glist_remove_obj(&nonce,nonces_lst->nonces_list);
+    for (i = 0; i < nonces_lst->n_nonces; i++) {
+        if (nonces_lst->nonces[i] == nonce) {
+            memmove(&nonces_lst->nonces[i], &nonces_lst->nonces[i + 1],
+                    (nonces_lst->n_nonces - i - 1) * sizeof(uint64_t));
+            nonces_lst->n_nonces--;
+            nonces_lst->n_sent--;
+            break;
+        }
+    }
     /* We don't remove the value as it can be pointed by several nonces*/
     kh_del(nonces,nonces_ht->ht,k);
     return (nonces_lst);
 }
 
+/* The lists belong to their timers, and a list can be pointed by several
+ * nonces, so they are not released here */
 void htable_nonces_destroy(htable_nonces_t *nonces_ht)
 {
-    khiter_t k;
-    nonces_list_t *nonces_lst;
-
     if (!nonces_ht) {
         return;
     }
 
-    for (k = kh_begin(nonces_ht->ht); k != kh_end(nonces_ht->ht); ++k){
-        if (kh_exist(nonces_ht->ht, k)){
-            nonces_lst = kh_value(nonces_ht->ht, k);
-            nonces_list_free(nonces_lst);
-        }
-    }
     kh_destroy(nonces,nonces_ht->ht);
     free (nonces_ht);
 }
@@ -107,20 +120,19 @@ htable_nonces_lookup(htable_nonces_t *nonces_ht, uint64_t nonce)
 void
 htable_nonces_reset_nonces_lst(htable_nonces_t *nonces_ht,nonces_list_t *nonces_lst)
 {
-    glist_t *nonces = nonces_lst->nonces_list;
-    glist_entry_t *nonce_it, *aux_nonce_it;
-    uint64_t *nonce;
     khiter_t k;
+    int i;
 
-    glist_for_each_entry_safe(nonce_it,aux_nonce_it,nonces){
-        nonce = (uint64_t *)glist_entry_data(nonce_it);
-        k = kh_get(nonces,nonces_ht->ht, *nonce);
-        if (k == kh_end(nonces_ht->ht)){
+    for (i = 0; i < nonces_lst->n_nonces; i++) {
+        k = kh_get(nonces,nonces_ht->ht, nonces_lst->nonces[i]);
+        if (k == kh_end(nonces_ht->ht)
+                || kh_value(nonces_ht->ht, k) != nonces_lst){
             continue;
         }
-        glist_remove(nonce_it,nonces);
         kh_del(nonces,nonces_ht->ht,k);
     }
+    nonces_lst->n_nonces = 0;
+    nonces_lst->n_sent = 0;
 }
 
 /*  Generates a nonce random number. Requires librt */
@@ -161,12 +173,6 @@ nonce_new()
     return(nonce_build((unsigned int) time(NULL)));
 }
 
-inline glist_t *
-nonces_list_list(nonces_list_t * nonces_lst)
-{
-    return (nonces_lst->nonces_list);
-}
-
 inline lmtimer_t *
 nonces_list_timer(nonces_list_t * nonces_lst)
 {
@@ -178,14 +184,8 @@ nonces_list_new_init(lmtimer_t *timer)
 {
     nonces_list_t *nonces_lst;
 
-    nonces_lst = xzalloc(sizeof(nonces_list_t));
-    if (!nonces_lst){
-        return (NULL);
-    }
+    nonces_lst = obj_pool_alloc(&nonces_lists_pool);
     nonces_lst->timer = timer;
-    nonces_lst->nonces_list = glist_new_complete(
-            (glist_cmp_fct)nonce_list_cmp_nonce,
-            (glist_del_fct)nonce_list_free_nonce);
     return (nonces_lst);
 }
 
@@ -193,27 +193,11 @@ nonces_list_new_init(lmtimer_t *timer)
 void
 nonces_list_free(nonces_list_t *nonces_lst)
 {
-    glist_destroy(nonces_lst->nonces_list);
-    free(nonces_lst);
+    obj_pool_free(&nonces_lists_pool, nonces_lst);
 }
 
 inline int
 nonces_list_size(nonces_list_t *nonces_lst)
 {
-    return (glist_size(nonces_lst->nonces_list));
-}
-
-int
-nonce_list_cmp_nonce(void *nonce1, void *nonce2)
-{
-    uint64_t nonce_a = *((uint64_t *)nonce1);
-    uint64_t nonce_b = *((uint64_t *)nonce2);
-    return (nonce_a == nonce_b);
+    return (nonces_lst->n_sent);
 }
-void
-nonce_list_free_nonce(void *nonce)
-{
-    free((uint64_t *)nonce);
-}
-
-
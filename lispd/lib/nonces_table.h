@@ -24,8 +24,15 @@
 #include "../elibs/khash/khash.h"
 #include "timers.h"
 
+/* Nonces kept per list: the first message and its retransmissions */
+#define NONCES_LIST_MAX     (LISPD_MAX_RETRANSMITS + 1)
+
 typedef struct {
-    glist_t *nonces_list; //<uint64_t>
+    /* Last nonces sent, oldest first */
+    uint64_t nonces[NONCES_LIST_MAX];
+    int n_nonces;
+    /* Nonces sent since the list was reset */
+    int n_sent;
     lmtimer_t *timer;
 } nonces_list_t;
 
@@ -46,7 +53,6 @@ void htable_nonces_reset_nonces_lst(htable_nonces_t *nonces_ht, nonces_list_t *n
 
 uint64_t nonce_build(int seed);
 uint64_t nonce_new();
-inline glist_t *nonces_list_list(nonces_list_t * nonces_lst);
 inline lmtimer_t *nonces_list_timer(nonces_list_t * nonces_lst);
 inline nonces_list_t *nonces_list_new_init(lmtimer_t *timer);
 void nonces_list_free(nonces_list_t *nonces_lst);
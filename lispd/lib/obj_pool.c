@@ -0,0 +1,117 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "obj_pool.h"
+#include "lmlog.h"
+#include "util.h"
+
+/* Room for the slab link, keeping the objects aligned */
+#define SLAB_HDR_LEN    16
+
+static obj_pool_t *pools = NULL;
+
+static inline size_t
+obj_pool_slot_size(obj_pool_t *pool)
+{
+    size_t size = pool->obj_size;
+
+    if (size < sizeof(void *)) {
+        size = sizeof(void *);
+    }
+    return ((size + 7) & ~(size_t)7);
+}
+
+static void
+obj_pool_grow(obj_pool_t *pool)
+{
+    size_t slot = obj_pool_slot_size(pool);
+    uint8_t *slab, *obj;
+    int i;
+
+    slab = xmalloc(SLAB_HDR_LEN + OBJ_POOL_SLAB_OBJS * slot);
+    *(void **)slab = pool->slabs;
+    pool->slabs = slab;
+
+    obj = slab + SLAB_HDR_LEN;
+    for (i = 0; i < OBJ_POOL_SLAB_OBJS; i++) {
+        *(void **)obj = pool->free_objs;
+        pool->free_objs = obj;
+        obj += slot;
+    }
+    pool->n_free += OBJ_POOL_SLAB_OBJS;
+
+    if (pool->n_slabs++ == 0) {
+        pool->next = pools;
+        pools = pool;
+    }
+}
+
+/* Returns a zeroed object */
+void *
+obj_pool_alloc(obj_pool_t *pool)
+{
+    void *obj;
+
+    if (!pool->free_objs) {
+        obj_pool_grow(pool);
+    }
+    obj = pool->free_objs;
+    pool->free_objs = *(void **)obj;
+    pool->n_free--;
+
+    if (++pool->in_use > pool->peak) {
+        pool->peak = pool->in_use;
+    }
+    pool->allocs++;
+
+    memset(obj, 0, pool->obj_size);
+    return (obj);
+}
+
+void
+obj_pool_free(obj_pool_t *pool, void *obj)
+{
+    if (!obj) {
+        return;
+    }
+    *(void **)obj = pool->free_objs;
+    pool->free_objs = obj;
+    pool->n_free++;
+    pool->in_use--;
+}
+
+void
+obj_pools_dump(int log_level)
+{
+    obj_pool_t *pool;
+
+    if (!is_loggable(log_level)) {
+        return;
+    }
+
+    LMLOG(log_level, "Object pools: name, object size, in use, peak, free, "
+            "slabs, allocations");
+    for (pool = pools; pool; pool = pool->next) {
+        LMLOG(log_level, "  %s %zu %u %u %u %u %"PRIu64, pool->name,
+                pool->obj_size, pool->in_use, pool->peak, pool->n_free,
+                pool->n_slabs, pool->allocs);
+    }
+}
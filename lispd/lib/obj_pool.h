@@ -0,0 +1,62 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef OBJ_POOL_H_
+#define OBJ_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Pool of objects of a fixed size, carved from slabs of OBJ_POOL_SLAB_OBJS
+ * objects. Freed objects are kept in a free list for reuse and the slabs
+ * are never returned, so once the pool reaches its working size, allocation
+ * and release cost a pointer swap. Pools are not thread safe, they are
+ * meant for the objects of the control thread.
+ */
+
+#define OBJ_POOL_SLAB_OBJS  64
+
+typedef struct obj_pool_ {
+    const char *name;
+    size_t obj_size;
+    /* Free objects, linked through their first word */
+    void *free_objs;
+    /* Slabs, linked through their first word */
+    void *slabs;
+    /* Statistics */
+    uint32_t in_use;
+    uint32_t peak;
+    uint32_t n_free;
+    uint32_t n_slabs;
+    uint64_t allocs;
+    /* Pools with at least one slab, for obj_pools_dump */
+    struct obj_pool_ *next;
+} obj_pool_t;
+
+/* Static initializer of a pool of objects of 'type' */
+#define OBJ_POOL_INIT(pool_name, type) \
+    {.name = (pool_name), .obj_size = sizeof(type)}
+
+void *obj_pool_alloc(obj_pool_t *pool);
+void obj_pool_free(obj_pool_t *pool, void *obj);
+void obj_pools_dump(int log_level);
+
+
+#endif /* OBJ_POOL_H_ */
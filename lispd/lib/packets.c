@@ -44,8 +44,8 @@ uint16_t ip_id = 0;
 static inline uint16_t
 get_IP_ID()
 {
-    ip_id++;
-    return (ip_id);
+    /* Shared by the data plane threads */
+    return (__sync_add_and_fetch(&ip_id, 1));
 }
 
 
@@ -144,6 +144,7 @@ pkt_push_ipv6(lbuf_t *b, struct in6_addr *src, struct in6_addr *dst, int proto)
     len = lbuf_size(b);
     ip6h = lbuf_push_uninit(b, sizeof(struct ip6_hdr));
 
+    ip6h->ip6_flow = 0;
     ip6h->ip6_hops = 255;
     ip6h->ip6_vfc = (IP6VERSION << 4);
     ip6h->ip6_nxt = proto;
@@ -208,6 +209,157 @@ pkt_push_udp_and_ip(lbuf_t *b, uint16_t sp, uint16_t dp, ip_addr_t *sip,
     return(GOOD);
 }
 
+/* Build the headers of the UDP packets from 'sip':'sp' to 'dip':'dp'.
+ * 'data' is the start of the payload of all of them and its length must
+ * be even. With UDP_CKSUM_ZERO the UDP checksum is not computed */
+int
+pkt_hdr_tpl_init(pkt_hdr_tpl_t *tpl, uint16_t sp, uint16_t dp,
+        ip_addr_t *sip, ip_addr_t *dip, void *data, int data_len,
+        int udp_cksum)
+{
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    struct udphdr *uh;
+    uint32_t sum;
+
+    if (ip_addr_afi(sip) != ip_addr_afi(dip)) {
+        LMLOG(LDBG_1, "pkt_hdr_tpl_init: src %s and dst %s IP have different "
+                "AFI!", ip_addr_to_char(sip), ip_addr_to_char(dip));
+        return (BAD);
+    }
+
+    memset(tpl, 0, sizeof(pkt_hdr_tpl_t));
+    switch (ip_addr_afi(sip)) {
+    case AF_INET:
+        tpl->ip_hdr_len = sizeof(struct ip);
+        iph = (struct ip *)tpl->hdr;
+        iph->ip_hl = 5;
+        iph->ip_v = IPVERSION;
+        iph->ip_off = htons(IP_DF);
+        iph->ip_ttl = 255;
+        iph->ip_p = IPPROTO_UDP;
+        memcpy(&iph->ip_src, ip_addr_get_addr(sip), sizeof(struct in_addr));
+        memcpy(&iph->ip_dst, ip_addr_get_addr(dip), sizeof(struct in_addr));
+        /* Fields not overwritten for each packet */
+        tpl->ip_sum = cksum_partial(&iph->ip_off, sizeof(iph->ip_off), 0);
+        tpl->ip_sum = cksum_partial(&iph->ip_src, 2 * sizeof(struct in_addr),
+                tpl->ip_sum);
+        sum = cksum_partial(&iph->ip_src, 2 * sizeof(struct in_addr), 0);
+        break;
+    case AF_INET6:
+        tpl->ip_hdr_len = sizeof(struct ip6_hdr);
+        ip6h = (struct ip6_hdr *)tpl->hdr;
+        ip6h->ip6_vfc = (IP6VERSION << 4);
+        ip6h->ip6_nxt = IPPROTO_UDP;
+        ip6h->ip6_hops = 255;
+        memcpy(&ip6h->ip6_src, ip_addr_get_addr(sip), sizeof(struct in6_addr));
+        memcpy(&ip6h->ip6_dst, ip_addr_get_addr(dip), sizeof(struct in6_addr));
+        sum = cksum_partial(&ip6h->ip6_src, 2 * sizeof(struct in6_addr), 0);
+        break;
+    default:
+        return (BAD);
+    }
+
+    if (tpl->ip_hdr_len + sizeof(struct udphdr) + data_len > PKT_TPL_MAX_LEN
+            || data_len % 2) {
+        return (BAD);
+    }
+
+    uh = (struct udphdr *)(tpl->hdr + tpl->ip_hdr_len);
+    uh->source = htons(sp);
+    uh->dest = htons(dp);
+    memcpy((uint8_t *)uh + sizeof(struct udphdr), data, data_len);
+    tpl->len = tpl->ip_hdr_len + sizeof(struct udphdr) + data_len;
+    tpl->udp_cksum = udp_cksum;
+
+    /* Pseudo-header without the length, ports and payload start */
+    sum += htons(IPPROTO_UDP);
+    tpl->udp_sum = cksum_partial(uh, sizeof(struct udphdr) + data_len, sum);
+
+    return (GOOD);
+}
+
+/* Copy 'len' bytes of a template. The usual sizes are copied with plain
+ * moves; a memcpy of variable size becomes a string instruction whose
+ * startup costs more than copying these few bytes */
+static inline void
+pkt_hdr_tpl_copy(void *dst, const void *src, int len)
+{
+    switch (len) {
+    case UDP_HDR_LEN + 8:
+        memcpy(dst, src, UDP_HDR_LEN + 8);
+        break;
+    case sizeof(struct ip):
+        memcpy(dst, src, sizeof(struct ip));
+        break;
+    case sizeof(struct ip6_hdr):
+        memcpy(dst, src, sizeof(struct ip6_hdr));
+        break;
+    default:
+        memcpy(dst, src, len);
+        break;
+    }
+}
+
+/* Prepend the headers of 'tpl' to the payload in 'b', setting the lengths,
+ * the IP ID, 'ttl' and 'tos' and the checksums */
+int
+pkt_push_hdr_tpl(lbuf_t *b, pkt_hdr_tpl_t *tpl, int ttl, int tos)
+{
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    struct udphdr *uh;
+    uint16_t *w;
+    uint32_t sum = 0;
+    uint16_t cksum;
+    int udp_len;
+
+    /* Payload, before the template bytes are pushed in front of it */
+    if (tpl->udp_cksum == UDP_CKSUM_FULL) {
+        sum = cksum_partial(lbuf_data(b), lbuf_size(b), tpl->udp_sum);
+    }
+    udp_len = tpl->len - tpl->ip_hdr_len + lbuf_size(b);
+
+    uh = lbuf_push_uninit(b, tpl->len - tpl->ip_hdr_len);
+    pkt_hdr_tpl_copy(uh, tpl->hdr + tpl->ip_hdr_len,
+            tpl->len - tpl->ip_hdr_len);
+    lbuf_reset_udp(b);
+    uh->len = htons(udp_len);
+    if (tpl->udp_cksum == UDP_CKSUM_FULL) {
+        /* Length of the UDP header and of the pseudo-header */
+        sum += 2 * (uint32_t)uh->len;
+        cksum = cksum_fold(sum);
+        uh->check = cksum ? cksum : 0xffff;
+    }
+
+    iph = lbuf_push_uninit(b, tpl->ip_hdr_len);
+    pkt_hdr_tpl_copy(iph, tpl->hdr, tpl->ip_hdr_len);
+    lbuf_reset_ip(b);
+
+    /* A ttl of 0 keeps the default, see ip_hdr_set_ttl_and_tos */
+    if (tpl->ip_hdr_len == sizeof(struct ip)) {
+        if (ttl != 0) {
+            iph->ip_ttl = ttl;
+        }
+        iph->ip_tos = tos;
+        iph->ip_len = htons(lbuf_size(b));
+        iph->ip_id = htons(get_IP_ID());
+        /* Words with the version and TOS, length, ID and TTL */
+        w = (uint16_t *)iph;
+        sum = tpl->ip_sum + w[0] + w[1] + w[2] + w[4];
+        iph->ip_sum = cksum_fold(sum);
+    } else {
+        ip6h = (struct ip6_hdr *)iph;
+        if (ttl != 0) {
+            ip6h->ip6_hops = ttl;
+        }
+        IPV6_SET_TC(ip6h, tos);
+        ip6h->ip6_plen = htons(udp_len);
+    }
+
+    return (GOOD);
+}
+
 /* Fill the tuple with the 5 tuples of a packet:
  * (SRC IP, DST IP, PROTOCOL, SRC PORT, DST PORT) */
 int
@@ -261,16 +413,17 @@ pkt_parse_5_tuple(lbuf_t *b, packet_tuple_t *tuple)
 }
 
 
-/* Calculate the hash of the 5 tuples of a packet */
+/* Calculate the hash of the 5 tuples of a packet. It is called for each
+ * ttable lookup, so the tuple is laid out in a stack buffer big enough for
+ * IPv6 instead of an allocated one */
 uint32_t
 pkt_tuple_hash(packet_tuple_t *tuple)
 {
-    int hash = 0;
+    uint32_t tuples[10];
     int len = 0;
-    int port = tuple->src_port;
-    uint32_t *tuples = NULL;
+    uint32_t port = tuple->src_port;
 
-    port = port + ((int)tuple->dst_port << 16);
+    port = port + ((uint32_t)tuple->dst_port << 16);
     switch (lisp_addr_ip_afi(&tuple->src_addr)){
     case AF_INET:
         /* 1 integer src_addr
@@ -278,7 +431,6 @@ pkt_tuple_hash(packet_tuple_t *tuple)
          * + 1 integer (ports)
          * + 1 integer protocol */
         len = 4;
-        tuples = xmalloc(len * sizeof(uint32_t));
         lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
         lisp_addr_copy_to(&tuples[1], &tuple->dst_addr);
         tuples[2] = port;
@@ -290,7 +442,6 @@ pkt_tuple_hash(packet_tuple_t *tuple)
          * + 1 integer (ports)
          * + 1 integer protocol */
         len = 10;
-        tuples = xmalloc(len * sizeof(uint32_t));
         lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
         lisp_addr_copy_to(&tuples[4], &tuple->dst_addr);
         tuples[8] = port;
@@ -299,8 +450,28 @@ pkt_tuple_hash(packet_tuple_t *tuple)
     }
 
     /* XXX: why 2013 used as initial value? */
-    hash = hashword(tuples, len, 2013);
-    free(tuples);
+    return (hashword(tuples, len, 2013));
+}
+
+/* Hash of 'len' bytes of a packet, e.g. of a field used as a key */
+uint32_t
+pkt_data_hash(const void *data, size_t len, uint32_t initval)
+{
+    uint32_t words[16];
+    const uint8_t *ptr = data;
+    uint32_t hash = initval;
+    size_t n;
+
+    /* hashword works on 32 bit words: copy the data to align it and pad
+     * the last word with zeros */
+    while (len > 0) {
+        n = MIN(len, sizeof(words));
+        words[(n - 1) / 4] = 0;
+        memcpy(words, ptr, n);
+        hash = hashword(words, (n + 3) / 4, hash);
+        ptr += n;
+        len -= n;
+    }
     return (hash);
 }
 
@@ -337,8 +508,8 @@ pkt_tuple_del(packet_tuple_t *tpl)
 char *
 pkt_tuple_to_char(packet_tuple_t *tpl)
 {
-    static char buf[2][200];
-    static int i=0;
+    static __thread char buf[2][200];
+    static __thread int i=0;
     /* hack to allow more than one locator per line */
     i++; i = i % 2;
     *buf[i] = '\0';
@@ -375,8 +546,14 @@ int
 ip_hdr_set_ttl_and_tos(struct iphdr *iph, int ttl, int tos)
 {
     struct ip6_hdr *ip6h;
+    uint16_t *w, old_w0, old_w4;
 
     if (iph->version == 4) {
+        /* Words with the version and TOS and with the TTL */
+        w = (uint16_t *)iph;
+        old_w0 = w[0];
+        old_w4 = w[4];
+
         /*XXX It seems that there is a bug in uClibc that causes ttl=0 in
          * OpenWRT. This is a quick workaround */
         if (ttl != 0) {
@@ -385,13 +562,10 @@ ip_hdr_set_ttl_and_tos(struct iphdr *iph, int ttl, int tos)
 
         iph->tos = tos;
 
-        /* We need to recompute the checksum since we have changed the TTL
-         * and TOS header fields.
-         *
-         * New checksum must be computed with the checksum header field
-         * with 0s */
-        iph->check = 0;
-        iph->check = ip_checksum((uint16_t*) iph, sizeof(struct iphdr));
+        /* Only the TTL and TOS changed, update the checksum instead of
+         * summing the header again */
+        iph->check = cksum_update16(iph->check, old_w0, w[0]);
+        iph->check = cksum_update16(iph->check, old_w4, w[4]);
 
     } else if (iph->version == 6) {
         ip6h = (struct ip6_hdr *) iph;
@@ -587,7 +761,7 @@ build_ip_udp_pcket(uint8_t *orig_pkt, int orig_pkt_len,lisp_addr_t *addr_from,
 char *
 ip_src_and_dst_to_char(struct iphdr *iph, char *fmt)
 {
-    static char buf[150];
+    static __thread char buf[150];
     struct ip6_hdr *ip6h;
 
     *buf = '\0';
@@ -49,6 +49,25 @@ typedef struct packet_tuple {
 } packet_tuple_t;
 
 
+/* Longest header prebuilt by a template: IPv6, UDP and a LISP data header */
+#define PKT_TPL_MAX_LEN         (sizeof(struct ip6_hdr) + UDP_HDR_LEN + 8)
+
+/*
+ * Outer IP and UDP headers shared by all the packets of a flow, followed by
+ * the first bytes of the UDP payload. They are built once so sending a packet
+ * only requires copying them and fixing the length dependent fields.
+ */
+typedef struct pkt_hdr_tpl {
+    uint8_t     hdr[PKT_TPL_MAX_LEN] __attribute__ ((aligned (8)));
+    uint8_t     len;        /* Bytes of hdr in use */
+    uint8_t     ip_hdr_len;
+    uint8_t     udp_cksum;  /* UDP_CKSUM_ZERO or UDP_CKSUM_FULL */
+    /* Partial sums of the constant fields of the IP header and of the UDP
+     * pseudo-header, header and payload bytes */
+    uint32_t    ip_sum;
+    uint32_t    udp_sum;
+} pkt_hdr_tpl_t;
+
 /*
  * Generate IP header. Returns the poninter to the transport header
  */
@@ -77,11 +96,16 @@ void *pkt_push_udp(lbuf_t *, uint16_t , uint16_t);
 void *pkt_push_ip(lbuf_t *, ip_addr_t *, ip_addr_t *, int proto);
 int pkt_push_udp_and_ip(lbuf_t *, uint16_t, uint16_t, ip_addr_t *,
         ip_addr_t *);
+int pkt_hdr_tpl_init(pkt_hdr_tpl_t *tpl, uint16_t sp, uint16_t dp,
+        ip_addr_t *sip, ip_addr_t *dip, void *data, int data_len,
+        int udp_cksum);
+int pkt_push_hdr_tpl(lbuf_t *b, pkt_hdr_tpl_t *tpl, int ttl, int tos);
 int ip_hdr_set_ttl_and_tos(struct iphdr *, int ttl, int tos);
 int ip_hdr_ttl_and_tos(struct iphdr *, int *ttl, int *tos);
 
 int pkt_parse_5_tuple(lbuf_t *b, packet_tuple_t *tuple);
 uint32_t pkt_tuple_hash(packet_tuple_t *tuple);
+uint32_t pkt_data_hash(const void *data, size_t len, uint32_t initval);
 int pkt_tuple_cmp(packet_tuple_t *t1, packet_tuple_t *t2);
 packet_tuple_t *pkt_tuple_clone(packet_tuple_t *);
 void pkt_tuple_del(packet_tuple_t *tpl);
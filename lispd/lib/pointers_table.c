@@ -68,6 +68,18 @@ htable_ptrs_lookup(htable_ptrs_t *ptr_ht, void *key)
     return (kh_value(ptr_ht->ht,k));
 }
 
+/* Remove all the entries. Values are not freed */
+void
+htable_ptrs_clear(htable_ptrs_t *ptr_ht)
+{
+    kh_clear(ptrs, ptr_ht->ht);
+}
+
+int
+htable_ptrs_size(htable_ptrs_t *ptr_ht)
+{
+    return (kh_size(ptr_ht->ht));
+}
 
 void
 htable_ptrs_destroy(htable_ptrs_t *ptr_ht)
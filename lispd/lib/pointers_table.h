@@ -44,6 +44,9 @@ void htable_ptrs_insert(htable_ptrs_t *ptr_ht, void *key, void *val);
 /* Remove entry of hash table and return the value */
 void* htable_ptrs_remove(htable_ptrs_t *ptr_ht, void *key);
 void *htable_ptrs_lookup(htable_ptrs_t *ptr_ht, void *key);
+void htable_ptrs_clear(htable_ptrs_t *ptr_ht);
+/* Number of entries */
+int htable_ptrs_size(htable_ptrs_t *ptr_ht);
 void htable_ptrs_destroy(htable_ptrs_t *ptr_ht);
 
 /* Add the timer to the list of timers associated to the object. Creats the entry into the
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "rate_limit.h"
+#include "util.h"
+#include "../defs.h"
+
+static uint64_t
+rate_limit_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    /* Never 0, which marks unused buckets */
+    return ((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000 + 1);
+}
+
+/* Create 'nbuckets', rounded up to a power of 2, that let each source send
+ * 'rate' packets per second with bursts of up to 'burst' packets */
+rate_limit_t *
+rate_limit_new(uint32_t nbuckets, uint32_t rate, uint32_t burst)
+{
+    rate_limit_t *rl;
+    uint32_t size = 1;
+    int i;
+
+    while (size < nbuckets) {
+        size <<= 1;
+    }
+
+    rl = xzalloc(sizeof(rate_limit_t));
+    rl->mask = size - 1;
+    rl->rate = rate;
+    rl->burst = burst > 0 ? burst : 1;
+    rl->buckets = xzalloc(size * sizeof(rate_limit_bucket_t));
+    for (i = 0; i < RATE_LIMIT_LOCKS; i++) {
+        pthread_mutex_init(&rl->locks[i], NULL);
+    }
+    return (rl);
+}
+
+void
+rate_limit_del(rate_limit_t *rl)
+{
+    int i;
+
+    if (!rl) {
+        return;
+    }
+    for (i = 0; i < RATE_LIMIT_LOCKS; i++) {
+        pthread_mutex_destroy(&rl->locks[i]);
+    }
+    free(rl->buckets);
+    free(rl);
+}
+
+/* Takes a token from the bucket of the source with hash 'key'. Returns BAD
+ * if the source has none left */
+int
+rate_limit_allow(rate_limit_t *rl, uint32_t key)
+{
+    uint32_t idx = key & rl->mask;
+    rate_limit_bucket_t *b = &rl->buckets[idx];
+    pthread_mutex_t *lock = &rl->locks[idx % RATE_LIMIT_LOCKS];
+    uint64_t now, tokens;
+    int ret = GOOD;
+
+    pthread_mutex_lock(lock);
+    /* Read with the lock held, so it never goes back for the bucket */
+    now = rate_limit_now();
+    if (b->last == 0) {
+        b->tokens = rl->burst * 1000;
+    } else {
+        tokens = b->tokens + (now - b->last) * rl->rate;
+        b->tokens = tokens < rl->burst * 1000 ? tokens : rl->burst * 1000;
+    }
+    b->last = now;
+
+    if (b->tokens < 1000) {
+        __atomic_add_fetch(&rl->dropped, 1, __ATOMIC_RELAXED);
+        ret = BAD;
+    } else {
+        b->tokens -= 1000;
+    }
+    pthread_mutex_unlock(lock);
+    return (ret);
+}
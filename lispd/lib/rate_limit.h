@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef RATE_LIMIT_H_
+#define RATE_LIMIT_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * Token buckets of a fixed number of sources, identified by a hash. Sources
+ * whose hashes fall in the same bucket share its tokens, so the memory used
+ * doesn't grow with the number of sources and a collision, or a spoofer
+ * rotating sources, can only make the limit stricter. Thread safe: the
+ * buckets are protected by a fixed set of locks, so threads checking
+ * different sources rarely wait for each other.
+ */
+
+#define RATE_LIMIT_LOCKS    64
+
+typedef struct rate_limit_bucket_ {
+    uint32_t tokens;    /* thousandths of a token */
+    uint64_t last;      /* milliseconds, 0 if the bucket is unused */
+} rate_limit_bucket_t;
+
+typedef struct rate_limit_ {
+    uint32_t mask;
+    uint32_t rate;      /* tokens per second */
+    uint32_t burst;     /* maximum tokens of a source */
+    uint64_t dropped;
+    rate_limit_bucket_t *buckets;
+    pthread_mutex_t locks[RATE_LIMIT_LOCKS];  /* Bucket i uses lock i % RATE_LIMIT_LOCKS */
+} rate_limit_t;
+
+rate_limit_t *rate_limit_new(uint32_t nbuckets, uint32_t rate, uint32_t burst);
+void rate_limit_del(rate_limit_t *rl);
+int rate_limit_allow(rate_limit_t *rl, uint32_t key);
+
+#endif /* RATE_LIMIT_H_ */
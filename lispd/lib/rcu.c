@@ -0,0 +1,170 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "rcu.h"
+#include "generic_list.h"
+#include "lmlog.h"
+#include "util.h"
+#include "../defs.h"
+
+typedef struct rcu_cb_ {
+    void *data;
+    rcu_del_fct del_fct;
+    uint64_t epoch;
+} rcu_cb_t;
+
+static uint64_t rcu_epoch = 1;
+static rcu_reader_t *rcu_readers[RCU_MAX_READERS];
+static glist_t *rcu_pending = NULL;
+
+
+void
+rcu_thread_offline(rcu_reader_t *reader)
+{
+    __atomic_store_n(&reader->seen, 0, __ATOMIC_RELEASE);
+}
+
+/* After this call the reader may dereference again shared pointers */
+void
+rcu_thread_online(rcu_reader_t *reader)
+{
+    __atomic_store_n(&reader->seen,
+            __atomic_load_n(&rcu_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    /* The writer must see us online before we read any shared pointer */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* Readers are registered offline */
+int
+rcu_register_reader(rcu_reader_t *reader)
+{
+    int i;
+
+    reader->seen = 0;
+    for (i = 0; i < RCU_MAX_READERS; i++) {
+        if (rcu_readers[i] == NULL) {
+            __atomic_store_n(&rcu_readers[i], reader, __ATOMIC_SEQ_CST);
+            return (GOOD);
+        }
+    }
+
+    LMLOG(LERR, "rcu_register_reader: Maximum number of readers reached");
+    return (BAD);
+}
+
+void
+rcu_unregister_reader(rcu_reader_t *reader)
+{
+    int i;
+
+    for (i = 0; i < RCU_MAX_READERS; i++) {
+        if (rcu_readers[i] == reader) {
+            __atomic_store_n(&rcu_readers[i], NULL, __ATOMIC_SEQ_CST);
+            return;
+        }
+    }
+}
+
+/* Release 'data' with 'del_fct' once no reader can hold a reference to it.
+ * 'data' must have been unpublished before calling this function */
+void
+rcu_defer(void *data, rcu_del_fct del_fct)
+{
+    rcu_cb_t *cb;
+
+    if (!rcu_pending) {
+        rcu_pending = glist_new();
+    }
+
+    cb = xmalloc(sizeof(rcu_cb_t));
+    cb->data = data;
+    cb->del_fct = del_fct;
+    cb->epoch = __atomic_add_fetch(&rcu_epoch, 1, __ATOMIC_SEQ_CST);
+    glist_add_tail(cb, rcu_pending);
+
+    rcu_reclaim();
+}
+
+/* Oldest epoch still observed by an online reader */
+static uint64_t
+rcu_min_seen_epoch()
+{
+    uint64_t min = UINT64_MAX;
+    uint64_t seen;
+    int i;
+
+    for (i = 0; i < RCU_MAX_READERS; i++) {
+        if (rcu_readers[i] == NULL) {
+            continue;
+        }
+        seen = __atomic_load_n(&rcu_readers[i]->seen, __ATOMIC_SEQ_CST);
+        if (seen != 0 && seen < min) {
+            min = seen;
+        }
+    }
+
+    return (min);
+}
+
+/* Release the deferred data that is no longer reachable by the readers */
+void
+rcu_reclaim()
+{
+    glist_entry_t *it, *aux_it;
+    rcu_cb_t *cb;
+    uint64_t min;
+
+    if (!rcu_pending || glist_size(rcu_pending) == 0) {
+        return;
+    }
+
+    min = rcu_min_seen_epoch();
+    glist_for_each_entry_safe(it, aux_it, rcu_pending) {
+        cb = (rcu_cb_t *)glist_entry_data(it);
+        /* Deferred in order, so the rest are newer */
+        if (cb->epoch > min) {
+            break;
+        }
+        cb->del_fct(cb->data);
+        free(cb);
+        glist_remove(it, rcu_pending);
+    }
+}
+
+/* Release all the deferred data. Readers must have been stopped */
+void
+rcu_reclaim_all()
+{
+    glist_entry_t *it;
+    rcu_cb_t *cb;
+
+    if (!rcu_pending) {
+        return;
+    }
+
+    glist_for_each_entry(it, rcu_pending) {
+        cb = (rcu_cb_t *)glist_entry_data(it);
+        cb->del_fct(cb->data);
+        free(cb);
+    }
+    glist_destroy(rcu_pending);
+    rcu_pending = NULL;
+}
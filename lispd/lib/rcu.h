@@ -0,0 +1,58 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef RCU_H_
+#define RCU_H_
+
+#include <stdint.h>
+
+/*
+ * Quiescent state based reclamation. Data shared with the data plane threads
+ * is never modified in place: the control thread publishes a new version
+ * with rcu_assign_pointer and hands the old one to rcu_defer. It is released
+ * once all the registered readers have gone through a quiescent state, that
+ * is, a point where they don't hold references to shared data.
+ */
+
+#define RCU_MAX_READERS     32
+
+typedef void (*rcu_del_fct)(void *);
+
+typedef struct rcu_reader_ {
+    /* Last epoch observed by the reader. 0 while it is offline */
+    uint64_t seen __attribute__ ((aligned (64)));
+} rcu_reader_t;
+
+#define rcu_assign_pointer(p_, v_) \
+        __atomic_store_n(&(p_), (v_), __ATOMIC_RELEASE)
+#define rcu_dereference(p_) \
+        __atomic_load_n(&(p_), __ATOMIC_ACQUIRE)
+
+/* Reader side. A reader is in a quiescent state while it is offline */
+void rcu_thread_offline(rcu_reader_t *reader);
+void rcu_thread_online(rcu_reader_t *reader);
+
+/* Writer side. Only to be called from the control thread */
+int rcu_register_reader(rcu_reader_t *reader);
+void rcu_unregister_reader(rcu_reader_t *reader);
+void rcu_defer(void *data, rcu_del_fct del_fct);
+void rcu_reclaim();
+void rcu_reclaim_all();
+
+#endif /* RCU_H_ */
@@ -17,6 +17,11 @@
  *
  */
 
+/* Define _GNU_SOURCE in order to use sendmmsg */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
 #include <errno.h>
 #include <unistd.h>
 #include <netdb.h>
@@ -251,34 +256,39 @@ bind_socket(int sock, int afi, lisp_addr_t *src_addr, int src_port)
 
 
 /* Sends a raw packet out the socket file descriptor 'sfd'  */
-int
-send_raw_packet(int socket, const void *pkt, int plen, ip_addr_t *dip)
+/* Fill 'ss' with the socket address of 'dip'. Returns its length */
+static int
+ip_addr_to_sockaddr(ip_addr_t *dip, struct sockaddr_storage *ss)
 {
-    struct sockaddr *saddr = NULL;
-    int slen, nbytes;
+    struct sockaddr_in *sa4;
+    struct sockaddr_in6 *sa6;
 
-    struct sockaddr_in sa4;
-    struct sockaddr_in6 sa6;
-
-    /* build sock addr */
+    memset(ss, 0, sizeof(struct sockaddr_storage));
     switch (ip_addr_afi(dip)) {
     case AF_INET:
-        memset(&sa4, 0, sizeof(sa4));
-        sa4.sin_family = AF_INET;
-        ip_addr_copy_to(&sa4.sin_addr, dip);
-        slen = sizeof(struct sockaddr_in);
-        saddr = (struct sockaddr *)&sa4;
-        break;
+        sa4 = (struct sockaddr_in *)ss;
+        sa4->sin_family = AF_INET;
+        ip_addr_copy_to(&sa4->sin_addr, dip);
+        return (sizeof(struct sockaddr_in));
     case AF_INET6:
-        memset(&sa6, 0, sizeof(sa6));
-        sa6.sin6_family = AF_INET6;
-        ip_addr_copy_to(&sa6.sin6_addr, dip);
-        slen = sizeof(struct sockaddr_in6);
-        saddr = (struct sockaddr *)&sa6;
-        break;
+        sa6 = (struct sockaddr_in6 *)ss;
+        sa6->sin6_family = AF_INET6;
+        ip_addr_copy_to(&sa6->sin6_addr, dip);
+        return (sizeof(struct sockaddr_in6));
     }
+    return (0);
+}
 
-    nbytes = sendto(socket, pkt, plen, 0, saddr, slen);
+int
+send_raw_packet(int socket, const void *pkt, int plen, ip_addr_t *dip)
+{
+    struct sockaddr_storage ss;
+    int slen, nbytes;
+
+    /* build sock addr */
+    slen = ip_addr_to_sockaddr(dip, &ss);
+
+    nbytes = sendto(socket, pkt, plen, 0, (struct sockaddr *)&ss, slen);
     if (nbytes != plen) {
         LMLOG(LDBG_2, "send_raw_packet: send packet to %s using fail descriptor %d failed -> %s", ip_addr_to_char(dip),
                 socket, strerror(errno));
@@ -288,6 +298,94 @@ send_raw_packet(int socket, const void *pkt, int plen, ip_addr_t *dip)
     return (GOOD);
 }
 
+void
+raw_pkt_batch_init(raw_pkt_batch_t *batch)
+{
+    batch->count = 0;
+}
+
+/* Queue a packet to be sent with send_raw_packet_batch. The packet is not
+ * copied, so 'pkt' must remain valid until the batch is sent. If the batch
+ * is full, it is sent first */
+int
+raw_pkt_batch_add(raw_pkt_batch_t *batch, int sock, const void *pkt,
+        int plen, ip_addr_t *dip)
+{
+    int ret = GOOD;
+
+    if (batch->count == MAX_DATA_BATCH_SIZE) {
+        ret = send_raw_packet_batch(batch);
+    }
+
+    batch->sock[batch->count] = sock;
+    batch->pkt[batch->count] = pkt;
+    batch->plen[batch->count] = plen;
+    ip_addr_copy(&batch->dip[batch->count], dip);
+    batch->count++;
+
+    return (ret);
+}
+
+/* Send all the packets of the batch using one sendmmsg per output socket and
+ * empty it. Packets are sent in order for each socket */
+int
+send_raw_packet_batch(raw_pkt_batch_t *batch)
+{
+    struct mmsghdr msgs[MAX_DATA_BATCH_SIZE];
+    struct iovec iov[MAX_DATA_BATCH_SIZE];
+    struct sockaddr_storage ss[MAX_DATA_BATCH_SIZE];
+    uint8_t queued[MAX_DATA_BATCH_SIZE];
+    int idx[MAX_DATA_BATCH_SIZE];
+    int i, j, n, sock, nsent;
+    int ret = GOOD;
+
+    memset(queued, 0, batch->count);
+    for (i = 0; i < batch->count; i++) {
+        if (queued[i]) {
+            continue;
+        }
+
+        /* Group the packets going out through the same socket */
+        sock = batch->sock[i];
+        n = 0;
+        for (j = i; j < batch->count; j++) {
+            if (queued[j] || batch->sock[j] != sock) {
+                continue;
+            }
+            iov[n].iov_base = (void *)batch->pkt[j];
+            iov[n].iov_len = batch->plen[j];
+            memset(&msgs[n], 0, sizeof(struct mmsghdr));
+            msgs[n].msg_hdr.msg_name = &ss[n];
+            msgs[n].msg_hdr.msg_namelen = ip_addr_to_sockaddr(
+                    &batch->dip[j], &ss[n]);
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+            queued[j] = TRUE;
+            idx[n] = j;
+            n++;
+        }
+
+        /* sendmmsg only reports an error when the first packet fails. Skip
+         * it and continue with the rest */
+        j = 0;
+        while (j < n) {
+            nsent = sendmmsg(sock, &msgs[j], n - j, 0);
+            if (nsent <= 0) {
+                LMLOG(LDBG_2, "send_raw_packet_batch: send packet to %s using "
+                        "fail descriptor %d failed -> %s",
+                        ip_addr_to_char(&batch->dip[idx[j]]), sock, strerror(errno));
+                ret = BAD;
+                j++;
+                continue;
+            }
+            j += nsent;
+        }
+    }
+    batch->count = 0;
+
+    return (ret);
+}
+
 int
 send_datagram_packet (int sock, const void *packet, int packet_length,
         lisp_addr_t *addr_dest, int port_dest)
@@ -21,8 +21,18 @@
 #ifndef SOCKETS_UTIL_H_
 #define SOCKETS_UTIL_H_
 
+#include "../defs.h"
 #include "../liblisp/lisp_address.h"
 
+/* Raw packets queued to be sent with a single system call per socket */
+typedef struct raw_pkt_batch_ {
+    int count;
+    int sock[MAX_DATA_BATCH_SIZE];
+    const void *pkt[MAX_DATA_BATCH_SIZE];
+    int plen[MAX_DATA_BATCH_SIZE];
+    ip_addr_t dip[MAX_DATA_BATCH_SIZE];
+} raw_pkt_batch_t;
+
 int open_ip_raw_socket(int afi);
 int open_udp_raw_socket(int afi);
 
@@ -32,6 +42,10 @@ inline int socket_conf_req_ttl_tos(int sock, int afi);
 
 int bind_socket(int sock,int afi, lisp_addr_t *src_addr, int src_port);
 int send_raw_packet(int, const void *, int, ip_addr_t *);
+void raw_pkt_batch_init(raw_pkt_batch_t *batch);
+int raw_pkt_batch_add(raw_pkt_batch_t *batch, int sock, const void *pkt,
+        int plen, ip_addr_t *dip);
+int send_raw_packet_batch(raw_pkt_batch_t *batch);
 int send_datagram_packet (int sock, const void *packet, int packet_length,
         lisp_addr_t *addr_dest, int port_dest);
 
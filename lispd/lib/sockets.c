@@ -32,6 +32,12 @@
 #include "../iface_list.h"
 #include "../liblisp/liblisp.h"
 
+/* Space for TTL and TOS data of received data packets */
+union data_control {
+    struct cmsghdr cmsg;
+    u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))];
+};
+
 inline fwd_entry_t *
 fwd_entry_new_init(lisp_addr_t *srloc, lisp_addr_t *drloc, int *out_socket)
 {
@@ -62,6 +68,13 @@ sockmstr_create()
 {
     sockmstr_t *sm;
     sm = xzalloc(sizeof(sockmstr_t));
+    sm->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (sm->epoll_fd == -1) {
+        LMLOG(LCRIT, "sockmstr_create: epoll_create1 error: %s",
+                strerror(errno));
+        free(sm);
+        return (NULL);
+    }
     return (sm);
 }
 
@@ -96,16 +109,11 @@ sock_list_add(sock_list_t *lst, sock_t *sock)
 
     lst->tail = sock;
     lst->count++;
-    if (sock->fd > lst->maxfd) {
-        lst->maxfd = sock->fd;
-    }
-
 }
 
 static inline void
 sock_list_remove(sock_list_t *lst, struct sock *sock)
 {
-    int fd;
     if (sock->prev == NULL){
         lst->head = sock->next;
         if (sock->next != NULL){
@@ -117,24 +125,13 @@ sock_list_remove(sock_list_t *lst, struct sock *sock)
             sock->next->prev = sock->prev;
         }
     }
-    fd = sock->fd;
+    if (sock->next == NULL){
+        lst->tail = sock->prev;
+    }
     close(sock->fd);
     free(sock);
 
     lst->count--;
-
-    if (fd == lst->maxfd){
-        sock= lst->head;
-        if (sock == NULL){
-            lst->maxfd = 0;
-        }
-        while (sock != NULL){
-            if (sock->fd > lst->maxfd) {
-                lst->maxfd = sock->fd;
-            }
-            sock = sock->next;
-        }
-    }
 }
 
 
@@ -145,6 +142,7 @@ sockmstr_destroy(sockmstr_t *sm)
         return;
     }
     sock_list_remove_all(&sm->read);
+    close(sm->epoll_fd);
     free(sm);
     LMLOG(LDBG_1,"Sockets closed");
 }
@@ -176,11 +174,24 @@ sockmstr_register_read_listener(sockmstr_t *m,int (*func)(struct sock *),
         void *arg, int fd)
 {
     struct sock *sock;
+    struct epoll_event ev;
+
     sock = xzalloc(sizeof(struct sock));
     sock->recv_cb = func;
     sock->type = SOCK_READ;
     sock->arg = arg;
     sock->fd = fd;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = sock;
+    if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        LMLOG(LERR, "sockmstr_register_read_listener: epoll_ctl error for "
+                "fd %d: %s", fd, strerror(errno));
+        free(sock);
+        return (NULL);
+    }
+
     sock_list_add(&m->read, sock);
     return (sock);
 }
@@ -188,70 +199,67 @@ sockmstr_register_read_listener(sockmstr_t *m,int (*func)(struct sock *),
 int
 sockmstr_unregister_read_listenedr(sockmstr_t *m, struct sock *sock)
 {
-   sock_list_remove(&m->read, sock);
-   return (GOOD);
+    int i;
+
+    epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, sock->fd, NULL);
+
+    /* The socket may be unregistered from the callback of another socket
+     * ready in the same wait. Don't process it */
+    for (i = 0; i < m->nevents; i++) {
+        if (m->events[i].data.ptr == sock) {
+            m->events[i].data.ptr = NULL;
+        }
+    }
+
+    sock_list_remove(&m->read, sock);
+    return (GOOD);
 }
 
 
-static void
-sock_process_fd(struct sock_list *lst, fd_set *fdset)
+void
+sockmstr_process_all(sockmstr_t *m)
 {
-    struct sock *sit;
+    struct sock *sock;
+    int i;
 
-    for (sit = lst->head; sit; sit = sit->next) {
-        if (FD_ISSET(sit->fd, fdset))
-            (*sit->recv_cb)(sit);
+    for (i = 0; i < m->nevents; i++) {
+        sock = (struct sock *)m->events[i].data.ptr;
+        if (sock != NULL) {
+            (*sock->recv_cb)(sock);
+        }
     }
+    m->nevents = 0;
 }
 
+/* Block until at least one of the registered sockets is ready to be read.
+ * Timers, netlink and API events are registered as sockets as well, so there
+ * is no need for a timeout. On Android, lispd_exit wakes up the loop through
+ * an eventfd */
 void
-sockmstr_process_all(sockmstr_t *m)
+sockmstr_wait_on_all_read(sockmstr_t *m)
 {
-    struct timeval tv;
-
-    tv.tv_sec = 0;
-    tv.tv_usec = DEFAULT_SELECT_TIMEOUT;
+    int nevents;
 
     while (1) {
-        if (select(m->read.maxfd + 1, &m->readfds, NULL, NULL, &tv) == -1) {
+        nevents = epoll_wait(m->epoll_fd, m->events, SOCKMSTR_MAX_EVENTS, -1);
+        if (nevents == -1) {
             if (errno == EINTR) {
                 continue;
             } else {
-                LMLOG(LDBG_2, "sock_process_all: select error: %s",
+                LMLOG(LDBG_2, "sockmstr_wait_on_all_read: epoll_wait error: %s",
                         strerror(errno));
-                return;
+                nevents = 0;
             }
-        } else {
-            break;
         }
+        break;
     }
-
-    sock_process_fd(&m->read, &m->readfds);
-}
-
-void
-sockmstr_wait_on_all_read(sockmstr_t *m)
-{
-    struct sock *sit;
-    for (sit = m->read.head; sit; sit = sit->next) {
-        FD_SET(sit->fd, &m->readfds);
-    }
+    m->nevents = nevents;
 }
 
-int
-open_control_input_socket(int afi)
+static int
+socket_conf_req_pktinfo(int sock, int afi)
 {
-
     const int on = 1;
-    int sock = ERR_SOCKET;
-
-    sock = open_udp_datagram_socket(afi);
-    if (sock == ERR_SOCKET) {
-        return (ERR_SOCKET);
-    }
-    bind_socket(sock, afi, NULL, LISP_CONTROL_PORT);
-
-
 
     switch (afi) {
     case AF_INET:
@@ -270,6 +278,61 @@ open_control_input_socket(int afi)
         }
         break;
     default:
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+int
+open_control_input_socket(int afi)
+{
+    int sock = ERR_SOCKET;
+
+    sock = open_udp_datagram_socket(afi);
+    if (sock == ERR_SOCKET) {
+        return (ERR_SOCKET);
+    }
+    bind_socket(sock, afi, NULL, LISP_CONTROL_PORT);
+
+    if (socket_conf_req_pktinfo(sock, afi) != GOOD) {
+        return (ERR_SOCKET);
+    }
+    return (sock);
+}
+
+/* Control input socket that can be opened several times, once per Map-Server
+ * worker. The kernel balances the received messages between them by their
+ * source, so the messages of an xTR always reach the same socket */
+int
+open_control_reuseport_input_socket(int afi)
+{
+    int sock = ERR_SOCKET;
+    int on = 1;
+
+    if ((sock = open_udp_datagram_socket(afi)) < 0){
+        return(ERR_SOCKET);
+    }
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1){
+        LMLOG(LERR, "open_control_reuseport_input_socket: setsockopt "
+                "SO_REUSEPORT: %s", strerror(errno));
+        close(sock);
+        return(ERR_SOCKET);
+    }
+    /* Keep IPv4 messages out of the IPv6 sockets */
+    if (afi == AF_INET6 && setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &on,
+            sizeof(on)) == -1){
+        LMLOG(LERR, "open_control_reuseport_input_socket: setsockopt "
+                "IPV6_V6ONLY: %s", strerror(errno));
+        close(sock);
+        return(ERR_SOCKET);
+    }
+    if (bind_socket(sock, afi, NULL, LISP_CONTROL_PORT) != GOOD){
+        close(sock);
+        return(ERR_SOCKET);
+    }
+
+    if (socket_conf_req_pktinfo(sock, afi) != GOOD) {
+        close(sock);
         return (ERR_SOCKET);
     }
     return (sock);
@@ -299,6 +362,44 @@ open_data_raw_input_socket(int afi)
     return (sock);
 }
 
+/* Data input socket that can be opened several times, once per data plane
+ * worker. The kernel balances the received flows between them */
+int
+open_data_reuseport_input_socket(int afi)
+{
+    int sock = ERR_SOCKET;
+    int on = 1;
+
+    if ((sock = open_udp_datagram_socket(afi)) < 0){
+        return(ERR_SOCKET);
+    }
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1){
+        LMLOG(LERR, "open_data_reuseport_input_socket: setsockopt "
+                "SO_REUSEPORT: %s", strerror(errno));
+        close(sock);
+        return(ERR_SOCKET);
+    }
+    /* Keep IPv4 packets out of the IPv6 sockets */
+    if (afi == AF_INET6 && setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &on,
+            sizeof(on)) == -1){
+        LMLOG(LERR, "open_data_reuseport_input_socket: setsockopt "
+                "IPV6_V6ONLY: %s", strerror(errno));
+        close(sock);
+        return(ERR_SOCKET);
+    }
+    if(bind_socket(sock,afi,NULL,LISP_DATA_PORT) != GOOD){
+        close(sock);
+        return(ERR_SOCKET);
+    }
+
+    if (socket_conf_req_ttl_tos(sock,afi)!= GOOD){
+        close(sock);
+        return (ERR_SOCKET);
+    }
+
+    return (sock);
+}
+
 int
 open_data_datagram_input_socket(int afi)
 {
@@ -327,7 +428,11 @@ sock_recv(int sfd, lbuf_t *b)
 {
     int nread;
     nread = read(sfd, lbuf_data(b), lbuf_tailroom(b));
-    if (nread == 0) {
+    if (nread <= 0) {
+        /* Non-blocking descriptor already drained */
+        if (nread == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return (BAD);
+        }
         LMLOG(LWRN, "sock_recv: recvmsg error: %s", strerror(errno));
         return (BAD);
     }
@@ -407,20 +512,53 @@ sock_ctrl_recv(int sock, struct lbuf *buf, uconn_t *uc)
     return (GOOD);
 }
 
+/* Read the TTL and TOS of a data packet from the ancillary data of 'msg' */
+static void
+sock_data_parse_cmsg(struct msghdr *msg, int *afi, uint8_t *ttl, uint8_t *tos)
+{
+    union sockunion *su = (union sockunion *)msg->msg_name;
+    struct cmsghdr *cmsgptr = NULL;
+
+    if (su->s4.sin_family == AF_INET) {
+        for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr =
+                CMSG_NXTHDR(msg, cmsgptr)) {
+
+            if (cmsgptr->cmsg_level == IPPROTO_IP
+                    && cmsgptr->cmsg_type == IP_TTL) {
+                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+
+            if (cmsgptr->cmsg_level == IPPROTO_IP
+                    && cmsgptr->cmsg_type == IP_TOS) {
+                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+        }
+        *afi = AF_INET;
+    } else {
+        for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr =
+                CMSG_NXTHDR(msg, cmsgptr)) {
+
+            if (cmsgptr->cmsg_level == IPPROTO_IPV6
+                    && cmsgptr->cmsg_type == IPV6_HOPLIMIT) {
+                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+
+            if (cmsgptr->cmsg_level == IPPROTO_IPV6
+                    && cmsgptr->cmsg_type == IPV6_TCLASS) {
+                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
+            }
+        }
+        *afi = AF_INET6;
+    }
+}
+
 int
 sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
 {
-    /* Space for TTL and TOS data */
-    union control_data {
-        struct cmsghdr cmsg;
-        u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))];
-    };
-
     union sockunion su;
     struct msghdr msg;
     struct iovec iov[1];
-    union control_data cmsg;
-    struct cmsghdr *cmsgptr = NULL;
+    union data_control cmsg;
     int nbytes = 0;
 
     iov[0].iov_base = lbuf_data(b);
@@ -441,40 +579,54 @@ sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
     }
 
     lbuf_set_size(b, lbuf_size(b) + nbytes);
+    sock_data_parse_cmsg(&msg, afi, ttl, tos);
 
-    if (su.s4.sin_family == AF_INET) {
-        for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr =
-                CMSG_NXTHDR(&msg, cmsgptr)) {
+    return (GOOD);
+}
 
-            if (cmsgptr->cmsg_level == IPPROTO_IP
-                    && cmsgptr->cmsg_type == IP_TTL) {
-                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
+/* Receive up to 'n' data packets with a single system call. Only the first
+ * packet is waited for. For each received packet i, the data is appended to
+ * bufs[i] and its afi, ttl and tos are returned in afi[i], ttl[i] and tos[i].
+ * Returns the number of packets received or ERR_SOCKET on error */
+int
+sock_data_recv_batch(int sock, lbuf_t *bufs, int n, int *afi, uint8_t *ttl,
+        uint8_t *tos)
+{
+    union sockunion su[MAX_DATA_BATCH_SIZE];
+    struct mmsghdr msgs[MAX_DATA_BATCH_SIZE];
+    struct iovec iov[MAX_DATA_BATCH_SIZE];
+    union data_control cmsg[MAX_DATA_BATCH_SIZE];
+    int i, npkts;
+
+    if (n > MAX_DATA_BATCH_SIZE) {
+        n = MAX_DATA_BATCH_SIZE;
+    }
 
-            if (cmsgptr->cmsg_level == IPPROTO_IP
-                    && cmsgptr->cmsg_type == IP_TOS) {
-                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
-        }
-        *afi = AF_INET;
-    } else {
-        for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr =
-                CMSG_NXTHDR(&msg, cmsgptr)) {
+    memset(msgs, 0, n * sizeof(struct mmsghdr));
+    for (i = 0; i < n; i++) {
+        iov[i].iov_base = lbuf_data(&bufs[i]);
+        iov[i].iov_len = lbuf_tailroom(&bufs[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = &cmsg[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(union data_control);
+        msgs[i].msg_hdr.msg_name = &su[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(union sockunion);
+    }
 
-            if (cmsgptr->cmsg_level == IPPROTO_IPV6
-                    && cmsgptr->cmsg_type == IPV6_HOPLIMIT) {
-                *ttl = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
+    npkts = recvmmsg(sock, msgs, n, MSG_WAITFORONE, NULL);
+    if (npkts == -1) {
+        LMLOG(LWRN, "sock_data_recv_batch: recvmmsg error: %s",
+                strerror(errno));
+        return (ERR_SOCKET);
+    }
 
-            if (cmsgptr->cmsg_level == IPPROTO_IPV6
-                    && cmsgptr->cmsg_type == IPV6_TCLASS) {
-                *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
-            }
-        }
-        *afi = AF_INET6;
+    for (i = 0; i < npkts; i++) {
+        lbuf_set_size(&bufs[i], lbuf_size(&bufs[i]) + msgs[i].msg_len);
+        sock_data_parse_cmsg(&msgs[i].msg_hdr, &afi[i], &ttl[i], &tos[i]);
     }
 
-    return (GOOD);
+    return (npkts);
 }
 
 inline int
@@ -20,6 +20,8 @@
 #ifndef SOCKETS_H_
 #define SOCKETS_H_
 
+#include <sys/epoll.h>
+
 #include "../defs.h"
 #include "sockets-util.h"
 #include "packets.h"
@@ -39,11 +41,13 @@ typedef enum {
  */
 
 
+/* Maximum number of ready descriptors returned by one wait */
+#define SOCKMSTR_MAX_EVENTS     64
+
 typedef struct sock_list {
     struct sock *head;
     struct sock *tail;
     int count;
-    int maxfd;
 }sock_list_t;
 
 typedef struct sock {
@@ -67,9 +71,10 @@ typedef struct sockmstr {
     sock_list_t read;
 //    struct sock_list *write;
 //    struct sock_list *netlink;
-    fd_set readfds;
-//    fd_set *writefds;
-//    fd_set *netlinkfds;
+    int epoll_fd;
+    /* ready descriptors of the last wait, pending to be processed */
+    struct epoll_event events[SOCKMSTR_MAX_EVENTS];
+    int nevents;
 } sockmstr_t;
 
 union sockunion {
@@ -82,6 +87,8 @@ typedef struct fwd_entry {
     lisp_addr_t *srloc;
     lisp_addr_t *drloc;
     int *out_sock;
+    /* Outer headers from srloc to drloc, if prebuilt */
+    pkt_hdr_tpl_t *encap_tpl;
 } fwd_entry_t;
 
 inline fwd_entry_t *fwd_entry_new_init(lisp_addr_t *srloc, lisp_addr_t *drloc,
@@ -102,11 +109,15 @@ void sockmstr_wait_on_all_read(sockmstr_t *m);
 
 int open_data_raw_input_socket(int afi);
 int open_data_datagram_input_socket(int afi);
+int open_data_reuseport_input_socket(int afi);
 int open_control_input_socket(int afi);
+int open_control_reuseport_input_socket(int afi);
 
 int sock_recv(int, lbuf_t *);
 int sock_ctrl_recv(int, lbuf_t *, uconn_t *);
 int sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos);
+int sock_data_recv_batch(int sock, lbuf_t *bufs, int n, int *afi,
+        uint8_t *ttl, uint8_t *tos);
 inline int uconn_init(uconn_t *uc, int lp, int rp, lisp_addr_t *la,
         lisp_addr_t *ra);
 
@@ -0,0 +1,88 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "spsc_ring.h"
+#include "util.h"
+#include "../defs.h"
+
+/* Create a ring able to hold at least 'size' elements */
+spsc_ring_t *
+spsc_ring_new(uint32_t size)
+{
+    spsc_ring_t *ring;
+    uint32_t rsize = 1;
+
+    while (rsize < size) {
+        rsize <<= 1;
+    }
+
+    ring = xzalloc(sizeof(spsc_ring_t));
+    ring->size = rsize;
+    ring->mask = rsize - 1;
+    ring->elems = xzalloc(rsize * sizeof(void *));
+    return (ring);
+}
+
+/* The elements still in the ring are not released */
+void
+spsc_ring_del(spsc_ring_t *ring)
+{
+    if (!ring) {
+        return;
+    }
+    free(ring->elems);
+    free(ring);
+}
+
+/* Called from the producer thread. Returns BAD if the ring is full */
+int
+spsc_ring_push(spsc_ring_t *ring, void *elem)
+{
+    uint32_t head, tail;
+
+    tail = ring->tail;
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (tail - head == ring->size) {
+        return (BAD);
+    }
+
+    ring->elems[tail & ring->mask] = elem;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return (GOOD);
+}
+
+/* Called from the consumer thread. Returns NULL if the ring is empty */
+void *
+spsc_ring_pop(spsc_ring_t *ring)
+{
+    uint32_t head, tail;
+    void *elem;
+
+    head = ring->head;
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return (NULL);
+    }
+
+    elem = ring->elems[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return (elem);
+}
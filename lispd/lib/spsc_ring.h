@@ -0,0 +1,46 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <stdint.h>
+
+/*
+ * Lock-free ring of pointers with a single producer thread and a single
+ * consumer thread.
+ */
+
+typedef struct spsc_ring_ {
+    uint32_t size;      /* power of 2 */
+    uint32_t mask;
+    void **elems;
+    /* Written only by the consumer */
+    uint32_t head __attribute__ ((aligned (64)));
+    /* Written only by the producer */
+    uint32_t tail __attribute__ ((aligned (64)));
+} spsc_ring_t;
+
+spsc_ring_t *spsc_ring_new(uint32_t size);
+void spsc_ring_del(spsc_ring_t *ring);
+int spsc_ring_push(spsc_ring_t *ring, void *elem);
+void *spsc_ring_pop(spsc_ring_t *ring);
+
+
+#endif /* SPSC_RING_H_ */
@@ -18,118 +18,272 @@
  */
 
 #include <errno.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <sys/time.h>
+#include <sys/timerfd.h>
 #include <time.h>
 
 #include "lmlog.h"
+#include "obj_pool.h"
 #include "timers.h"
 #include "util.h"
 #include "../defs.h"
 #include "../lispd_external.h"
 
+/*
+ * Hierarchical timer wheel driven by a timerfd.
+ *
+ * Time is counted in ticks of TICK_MS since the wheel was created. Level 0
+ * has one slot per tick for the next WHEEL_L0_SIZE ticks. Each following
+ * level has WHEEL_LN_SIZE slots, each spanning a whole rotation of the level
+ * below. Timers are linked in the slot of their expiration tick at the
+ * lowest level that reaches it, so starting and stopping one is O(1). When
+ * level 0 completes a rotation, the next slot of level 1 is cascaded: its
+ * timers are moved down to the levels that now reach them, and so on up the
+ * levels. Timers far in the future are only touched when they cascade, a
+ * few times in their whole life.
+ *
+ * The timerfd is armed at the next non empty tick of level 0 or, if there is
+ * none, at the next cascade. On expiration, all the ticks up to the current
+ * monotonic time are processed, so late wakeups do not lose ticks.
+ */
+
+#define TICK_MS             10
 
-/* Seconds */
-#define TICK_INTERVAL 1
+#define WHEEL_L0_BITS       8
+#define WHEEL_LN_BITS       6
+#define WHEEL_L0_SIZE       (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE       (1 << WHEEL_LN_BITS)
+#define WHEEL_L0_MASK       (WHEEL_L0_SIZE - 1)
+#define WHEEL_LN_MASK       (WHEEL_LN_SIZE - 1)
+/* With 10 ms ticks: 2.56 s, 163 s, 2.9 h, 7.7 days and 1.3 years */
+#define WHEEL_LEVELS        5
+#define WHEEL_NUM_SLOTS     (WHEEL_L0_SIZE + (WHEEL_LEVELS - 1) * WHEEL_LN_SIZE)
 
-/* Good for a little over an hour */
-#define WHEEL_SIZE 4096
+/* Ticks reached by levels 0 to 'l' */
+#define WHEEL_LEVEL_SPAN(l) (1ULL << (WHEEL_L0_BITS + (l) * WHEEL_LN_BITS))
 
 struct timer_wheel_{
-    int num_spokes;
-    int current_spoke;
+    /* Level 0 slots followed by the WHEEL_LN_SIZE slots of each level */
     lmtimer_links_t *spokes;
-    timer_t tick_timer_id;
+    int level_timers[WHEEL_LEVELS];
+    /* Next tick to be processed */
+    uint64_t cur_tick;
+    /* Tick at which the timerfd expires, 0 if disarmed */
+    uint64_t armed_tick;
+    /* Monotonic time of tick 1. Ticks start at 1, 0 means no tick */
+    struct timespec base;
+    int processing;
     int running_timers;
     int expirations;
 } timer_wheel = {.spokes=NULL};
 
-/* We don't have signalfd in bionic, fake it. */
-static int signal_pipe[2];
+/* timers file descriptor */
+int timers_fd = -1;
 
-static timer_t timer_id;
+static obj_pool_t timers_pool = OBJ_POOL_INIT("lmtimer_t", lmtimer_t);
 
-/* timers file descriptor */
-int timers_fd = 0;
+static int process_timer_fd(sock_t *sl);
+static void handle_timers(uint64_t now);
 
-static int destroy_timers_event_socket();
-static int build_timers_event_socket(int *timers_fd);
-static int process_timer_signal(sock_t *sl);
-static void handle_timers(void);
 
+static uint64_t
+wheel_now()
+{
+    struct timespec now;
+    int64_t ms;
 
-/*
- * create_timer_wheel()
- *
- * Creates the timer wheel structure and starts
- * the rotation timer.
- */
-static int
-create_timer_wheel(void)
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (int64_t)(now.tv_sec - timer_wheel.base.tv_sec) * 1000
+            + (now.tv_nsec - timer_wheel.base.tv_nsec) / 1000000;
+    return (ms / TICK_MS + 1);
+}
+
+static inline lmtimer_links_t *
+wheel_spoke(int level, int slot)
+{
+    if (level == 0) {
+        return (&timer_wheel.spokes[slot]);
+    }
+    return (&timer_wheel.spokes[WHEEL_L0_SIZE + (level - 1) * WHEEL_LN_SIZE
+            + slot]);
+}
+
+static inline void
+links_unlink(lmtimer_links_t *l)
+{
+    l->prev->next = l->next;
+    l->next->prev = l->prev;
+    l->next = NULL;
+    l->prev = NULL;
+}
+
+/* Move all the timers of 'spoke' to the list headed by 'head' */
+static inline void
+links_splice(lmtimer_links_t *spoke, lmtimer_links_t *head)
 {
-    //timer_t tid;
-    struct sigevent sev;
-    struct itimerspec timerspec;
-    sev.sigev_notify = SIGEV_SIGNAL;
-    sev.sigev_signo = SIGRTMIN;
-    sev.sigev_value.sival_ptr = &timer_id;
-    if (timer_create(CLOCK_MONOTONIC, &sev, &timer_id) == -1) {
-        LMLOG(LINF, "timer_create(): %s", strerror(errno));
-        return (BAD);
+    if (spoke->next == spoke) {
+        head->next = head;
+        head->prev = head;
+        return;
     }
+    head->next = spoke->next;
+    head->prev = spoke->prev;
+    head->next->prev = head;
+    head->prev->next = head;
+    spoke->next = spoke;
+    spoke->prev = spoke;
+}
 
-    timerspec.it_value.tv_nsec = 0;
-    timerspec.it_value.tv_sec = TICK_INTERVAL;
-    timerspec.it_interval.tv_nsec = 0;
-    timerspec.it_interval.tv_sec = TICK_INTERVAL;
+/* Program the timerfd to expire at 'tick', or disarm it if 0 */
+static void
+wheel_arm(uint64_t tick)
+{
+    struct itimerspec its;
+    uint64_t ms = (tick - 1) * TICK_MS;
+
+    memset(&its, 0, sizeof(its));
+    if (tick != 0) {
+        its.it_value.tv_sec = timer_wheel.base.tv_sec + ms / 1000;
+        its.it_value.tv_nsec = timer_wheel.base.tv_nsec + (ms % 1000) * 1000000;
+        if (its.it_value.tv_nsec >= 1000000000) {
+            its.it_value.tv_sec++;
+            its.it_value.tv_nsec -= 1000000000;
+        }
+    }
+    if (timerfd_settime(timers_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        LMLOG(LERR, "wheel_arm: timerfd_settime() failed: %s",
+                strerror(errno));
+    }
+    timer_wheel.armed_tick = tick;
+}
+
+/* First tick with something to do: a timer of level 0 expiring before the
+ * next cascade, or else the next cascade. 0 if there are no timers */
+static uint64_t
+wheel_next_tick()
+{
+    uint64_t tick = timer_wheel.cur_tick;
 
-    if (timer_settime(timer_id, 0, &timerspec, NULL) == -1) {
-        LMLOG(LINF, "create_wheel_timer: timer start failed for %d %s",
-                timer_id, strerror(errno));
-        return (BAD);
+    if (timer_wheel.running_timers == 0) {
+        return (0);
+    }
+    /* The cascade of the current tick is still pending */
+    if ((tick & WHEEL_L0_MASK) == 0
+            && timer_wheel.running_timers > timer_wheel.level_timers[0]) {
+        return (tick);
+    }
+    if (timer_wheel.level_timers[0] > 0) {
+        do {
+            if (wheel_spoke(0, tick & WHEEL_L0_MASK)->next
+                    != wheel_spoke(0, tick & WHEEL_L0_MASK)) {
+                return (tick);
+            }
+            tick++;
+        } while (tick & WHEEL_L0_MASK);
+        return (tick);
     }
+    return ((tick | WHEEL_L0_MASK) + 1);
+}
 
-    return(GOOD);
+/* Link a timer in the slot of its expiration tick at the lowest level that
+ * reaches it */
+static void
+wheel_insert(lmtimer_t *tptr)
+{
+    lmtimer_links_t *prev, *spoke;
+    uint64_t expires = tptr->expires;
+    uint64_t delta;
+    int level, slot;
+
+    /* Already due, expire on the next tick processed */
+    if (expires < timer_wheel.cur_tick) {
+        expires = timer_wheel.cur_tick;
+    }
+    delta = expires - timer_wheel.cur_tick;
+
+    for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+        if (delta < WHEEL_LEVEL_SPAN(level)) {
+            break;
+        }
+    }
+    if (delta >= WHEEL_LEVEL_SPAN(level)) {
+        /* Beyond the wheel, wait in its last slot and cascade again */
+        expires = timer_wheel.cur_tick + WHEEL_LEVEL_SPAN(level) - 1;
+    }
+    if (level == 0) {
+        slot = expires & WHEEL_L0_MASK;
+    } else {
+        slot = (expires >> (WHEEL_L0_BITS + (level - 1) * WHEEL_LN_BITS))
+                & WHEEL_LN_MASK;
+    }
+    tptr->level = level;
+    timer_wheel.level_timers[level]++;
+
+    /* append to end of spoke  */
+    spoke = wheel_spoke(level, slot);
+    prev = spoke->prev;
+    tptr->links.next = spoke;
+    tptr->links.prev = prev;
+    prev->next = &tptr->links;
+    spoke->prev = &tptr->links;
 }
 
+static void
+wheel_remove(lmtimer_t *tptr)
+{
+    links_unlink(&tptr->links);
+    timer_wheel.level_timers[tptr->level]--;
+}
+
+/* Move the timers of a slot of 'level' to the lower levels. Returns the
+ * index of the slot */
+static int
+wheel_cascade(int level)
+{
+    lmtimer_links_t head;
+    lmtimer_t *tptr;
+    int slot;
+
+    slot = (timer_wheel.cur_tick >> (WHEEL_L0_BITS + (level - 1)
+            * WHEEL_LN_BITS)) & WHEEL_LN_MASK;
+    links_splice(wheel_spoke(level, slot), &head);
+    while (head.next != &head) {
+        tptr = CONTAINER_OF(head.next, lmtimer_t, links);
+        wheel_remove(tptr);
+        wheel_insert(tptr);
+    }
+    return (slot);
+}
 
 
 int
 lmtimers_init()
 {
-    int i = 0;
-    lmtimer_links_t *spoke;
+    int i;
 
     LMLOG(LDBG_1, "Initializing lmtimers...");
 
-    /* create timers event socket */
-    if (build_timers_event_socket(&timers_fd) == 0) {
-        LMLOG(LCRIT, " Error programming the timer signal. Exiting...");
+    timers_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timers_fd == -1) {
+        LMLOG(LCRIT, "lmtimers_init: timerfd_create() failed: %s",
+                strerror(errno));
         return(BAD);
     }
 
-    if (create_timer_wheel() != GOOD) {
-        LMLOG(LINF, "Failed to set up timers.");
-        return(BAD);
+    timer_wheel.spokes = xmalloc(sizeof(lmtimer_links_t) * WHEEL_NUM_SLOTS);
+    for (i = 0; i < WHEEL_NUM_SLOTS; i++) {
+        timer_wheel.spokes[i].next = &timer_wheel.spokes[i];
+        timer_wheel.spokes[i].prev = &timer_wheel.spokes[i];
     }
-
-    timer_wheel.num_spokes = WHEEL_SIZE;
-    timer_wheel.spokes = xmalloc(sizeof(lmtimer_links_t) * WHEEL_SIZE);
-    timer_wheel.current_spoke = 0;
+    memset(timer_wheel.level_timers, 0, sizeof(timer_wheel.level_timers));
+    clock_gettime(CLOCK_MONOTONIC, &timer_wheel.base);
+    timer_wheel.cur_tick = 1;
+    timer_wheel.armed_tick = 0;
+    timer_wheel.processing = FALSE;
     timer_wheel.running_timers = 0;
     timer_wheel.expirations = 0;
 
-    spoke = &timer_wheel.spokes[0];
-    for (i = 0; i < WHEEL_SIZE; i++) {
-        spoke->next = spoke;
-        spoke->prev = spoke;
-        spoke++;
-    }
-
-
     /* register timer fd with the socket master */
-    sockmstr_register_read_listener(smaster, process_timer_signal, NULL,
+    sockmstr_register_read_listener(smaster, process_timer_fd, NULL,
             timers_fd);
 
     return(GOOD);
@@ -139,8 +293,7 @@ void
 lmtimers_destroy()
 {
     int i;
-    lmtimer_links_t *spoke, *sit, *next;
-    lmtimer_t *t;
+    lmtimer_links_t *spoke;
 
     if (timer_wheel.spokes == NULL){
         return;
@@ -148,23 +301,17 @@ lmtimers_destroy()
 
     LMLOG(LDBG_1, "Destroying lmtimers ... ");
 
-    destroy_timers_event_socket();
-
-    spoke = &timer_wheel.spokes[0];
-    for (i = 0; i < WHEEL_SIZE; i++) {
+    for (i = 0; i < WHEEL_NUM_SLOTS; i++) {
+        spoke = &timer_wheel.spokes[i];
         /* the first link is NOT a timer */
-        sit = spoke->next;
-        while (sit != spoke){
-            next = sit->next;
-            t = CONTAINER_OF(sit, lmtimer_t, links);
-            lmtimer_stop(t);
-            sit = next;
+        while (spoke->next != spoke) {
+            lmtimer_stop(CONTAINER_OF(spoke->next, lmtimer_t, links));
         }
-        spoke++;
     }
     free(timer_wheel.spokes);
-    timer_delete(timer_id);
-
+    timer_wheel.spokes = NULL;
+    close(timers_fd);
+    timers_fd = -1;
 }
 
 /*
@@ -175,7 +322,7 @@ lmtimers_destroy()
 lmtimer_t *
 lmtimer_create(timer_type type)
 {
-    lmtimer_t *new_timer = xzalloc(sizeof(lmtimer_t));
+    lmtimer_t *new_timer = obj_pool_alloc(&timers_pool);
     new_timer->type = type;
     new_timer->links.prev = NULL;
     new_timer->links.next = NULL;
@@ -217,69 +364,49 @@ lmtimer_nonces(lmtimer_t *timer)
     return (timer->nonces_lst);
 }
 
-/* Insert a timer in the wheel at the appropriate location. */
-static void
-insert_timer(lmtimer_t *tptr)
-{
-    lmtimer_links_t *prev, *spoke;
-    uint32_t pos;
-    uint32_t ticks;
-    uint32_t td;
-
-    /* Number of ticks for this timer. */
-    ticks = tptr->duration;
-
-    /* tick position, referenced from the
-     * current index. */
-    td = (ticks % timer_wheel.num_spokes);
-
-    /* Full rotations required before this timer expires */
-    tptr->rotation_count = (ticks / timer_wheel.num_spokes);
-
-    /* Find the right spoke, and link the timer into the list at this position */
-    pos = ((timer_wheel.current_spoke + td) % timer_wheel.num_spokes);
-    spoke = &timer_wheel.spokes[pos];
-
-    /* append to end of spoke  */
-    prev = spoke->prev;
-    tptr->links.next = spoke;
-    tptr->links.prev = prev;
-    prev->next = (lmtimer_links_t *) tptr;
-    spoke->prev = (lmtimer_links_t *) tptr;
-    return;
-}
-
 /*
  * start_timer()
  *
- * Starts a new timer with given expiration time, callback function,
- * and arguments. Returns a pointer to the new timer, which must be kept
- * to stop the timer later if desired.
+ * Starts, or restarts if it is running, a timer that expires in 'msexpiry'
+ * milliseconds, rounded up to the wheel resolution.
  */
 void
-lmtimer_start(lmtimer_t *tptr, int sexpiry)
+lmtimer_start_ms(lmtimer_t *tptr, int msexpiry)
 {
-    lmtimer_links_t *next, *prev;
+    int was_next = FALSE;
 
     /* See if this timer is also running. */
-    next = tptr->links.next;
-
-    if (next != NULL) {
-        prev = tptr->links.prev;
-        next->prev = prev;
-        prev->next = next;
-
-        /* Update stats */
+    if (tptr->links.next != NULL) {
+        was_next = (tptr->expires == timer_wheel.armed_tick);
+        wheel_remove(tptr);
         timer_wheel.running_timers--;
     }
 
-    /* Hook up the callback  */
+    if (msexpiry < 0) {
+        msexpiry = 0;
+    }
+    tptr->expires = wheel_now() + (msexpiry + TICK_MS - 1) / TICK_MS;
+    wheel_insert(tptr);
+    timer_wheel.running_timers++;
 
-    tptr->duration = sexpiry;
-    insert_timer(tptr);
+    /* The timerfd is armed again once the expired timers are processed */
+    if (timer_wheel.processing) {
+        return;
+    }
+    if (was_next) {
+        /* Restarted later, the next expiration may be another timer */
+        wheel_arm(wheel_next_tick());
+    } else if (timer_wheel.armed_tick == 0
+            || tptr->expires < timer_wheel.armed_tick) {
+        wheel_arm(tptr->expires);
+    }
+}
 
-    timer_wheel.running_timers++;
-    return;
+/* Same with an expiration time in seconds */
+void
+lmtimer_start(lmtimer_t *tptr, int sexpiry)
+{
+    lmtimer_start_ms(tptr, sexpiry * 1000);
 }
 
 
@@ -291,177 +418,100 @@ lmtimer_start(lmtimer_t *tptr, int sexpiry)
 void
 lmtimer_stop(lmtimer_t *tptr)
 {
-    lmtimer_links_t *next, *prev;
-
     if (tptr == NULL) {
         return;
     }
 
-    next = tptr->links.next;
-    prev = tptr->links.prev;
-    if (next != NULL) {
-        next->prev = prev;
-    }
-    if (prev != NULL) {
-        prev->next = next;
-    }
-    tptr->links.next = NULL;
-    tptr->links.prev = NULL;
-
-    /* Update stats */
-    if (next != NULL || prev != NULL) {
+    if (tptr->links.next != NULL) {
+        wheel_remove(tptr);
+        /* Update stats */
         timer_wheel.running_timers--;
+
+        /* It was the next to expire, program the following one */
+        if (!timer_wheel.processing
+                && tptr->expires == timer_wheel.armed_tick) {
+            wheel_arm(wheel_next_tick());
+        }
     }
+
     /* Free timer argument */
     if (tptr->del_arg_fn){
         tptr->del_arg_fn(tptr->cb_argument);
     }
 
-    free(tptr);
+    obj_pool_free(&timers_pool, tptr);
 }
 
 
 /*
  * handle_timers()
  *
- * Update the wheel index, and expire any timers there, calling
- * the appropriate function to deal with it.
+ * Process all the ticks up to 'now', cascading the timers of the upper
+ * levels and expiring those of level 0, calling the appropriate function to
+ * deal with them.
  */
 static void
-handle_timers(void)
+handle_timers(uint64_t now)
 {
-    struct timeval  nowtime;
-    lmtimer_links_t    *current_spoke, *next, *prev;
-    lmtimer_t          *tptr;
-    lmtimer_callback_t  callback;
-
-    gettimeofday(&nowtime, NULL);
-    timer_wheel.current_spoke = (timer_wheel.current_spoke + 1) % timer_wheel.num_spokes;
-    current_spoke = &timer_wheel.spokes[timer_wheel.current_spoke];
+    lmtimer_links_t expired;
+    lmtimer_t *tptr;
+    int slot, level;
+
+    while (timer_wheel.cur_tick <= now) {
+        slot = timer_wheel.cur_tick & WHEEL_L0_MASK;
+
+        /* Nothing expires in level 0 until the next cascade. Do not go
+         * beyond 'now', timers started later are relative to cur_tick */
+        if (slot != 0 && timer_wheel.level_timers[0] == 0) {
+            timer_wheel.cur_tick = MIN((timer_wheel.cur_tick | WHEEL_L0_MASK)
+                    + 1, now + 1);
+            continue;
+        }
 
-    tptr = (lmtimer_t *)current_spoke->next;
-    while ((lmtimer_links_t *)tptr != current_spoke) {
-        next = tptr->links.next;
-        prev = tptr->links.prev;
+        if (slot == 0) {
+            for (level = 1; level < WHEEL_LEVELS; level++) {
+                if (wheel_cascade(level) != 0) {
+                    break;
+                }
+            }
+        }
 
-        if (tptr->rotation_count > 0) {
-            tptr->rotation_count--;
-        } else {
+        /* Timers started by the callbacks for the current tick go to the
+         * next one */
+        timer_wheel.cur_tick++;
+        links_splice(wheel_spoke(0, slot), &expired);
 
-            prev->next = next;
-            next->prev = prev;
-            tptr->links.next = NULL;
-            tptr->links.prev = NULL;
+        /* The callbacks may stop or restart any of the expired timers, take
+         * them one by one from the head */
+        while (expired.next != &expired) {
+            tptr = CONTAINER_OF(expired.next, lmtimer_t, links);
+            wheel_remove(tptr);
 
             /* Update stats */
             timer_wheel.running_timers--;
             timer_wheel.expirations++;
 
-            callback = tptr->cb;
-            (*callback)(tptr);
+            (*tptr->cb)(tptr);
         }
-        /* We can not use directly "next" as it could be released  in the
-         *  callback function  previously to be used */
-        tptr = (lmtimer_t *)(prev->next);
     }
 }
 
 static int
-process_timer_signal(sock_t *sl)
+process_timer_fd(sock_t *sl)
 {
-    int sig;
-    int bytes;
-
-    bytes = read(sl->fd, &sig, sizeof(sig));
+    uint64_t exp;
 
-    if (bytes != sizeof(sig)) {
-        LMLOG(LWRN, "process_event_signal(): nothing to read");
+    if (read(sl->fd, &exp, sizeof(exp)) != sizeof(exp)) {
+        if (errno != EAGAIN) {
+            LMLOG(LWRN, "process_timer_fd: read failed: %s", strerror(errno));
+        }
         return(-1);
     }
 
-    if (sig == SIGRTMIN) {
-        handle_timers();
-    }
-    return(0);
-}
-
-
-
-/*
- * event_sig_handler
- *
- * Forward signal to the fd for handling in the event loop
- */
-static void event_sig_handler(int sig)
-{
-    if (write(signal_pipe[1], &sig, sizeof(sig)) != sizeof(sig)) {
-        LMLOG(LWRN, "write signal %d: %s", sig, strerror(errno));
-    }
-}
-
-
-/*
- * build_timer_event_socket
- *
- * Set up the event handler socket. This is
- * used to serialize events like timer expirations that
- * we would rather deal with synchronously. This avoids
- * having to deal with all sorts of locking and multithreading
- * nonsense.
- */
-static int
-build_timers_event_socket(int *timers_fd)
-{
-    int flags;
-    struct sigaction sa;
-
-    if (pipe(signal_pipe) == -1) {
-        LMLOG(LERR, "build_timers_event_socket: signal pipe setup failed %s",
-                strerror(errno));
-        return (BAD);
-    }
-    *timers_fd = signal_pipe[0];
-
-    if ((flags = fcntl(*timers_fd, F_GETFL, 0)) == -1) {
-        LMLOG(LERR, "build_timers_event_socket: fcntl() F_GETFL failed %s",
-                strerror(errno));
-        return (BAD);
-    }
-    if (fcntl(*timers_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
-        LMLOG(LERR, "build_timers_event_socket: fcntl() set O_NONBLOCK failed "
-                "%s", strerror(errno));
-        return (BAD);
-    }
-
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = event_sig_handler;
-    sa.sa_flags = 0;
-    sigemptyset(&sa.sa_mask);
-
-    if (sigaction(SIGRTMIN, &sa, NULL) == -1) {
-        LMLOG(LERR, "build_timers_event_socket: sigaction() failed %s",
-                strerror(errno));
-        exit_cleanup();
-    }
-    return(GOOD);
-}
+    timer_wheel.processing = TRUE;
+    handle_timers(wheel_now());
+    timer_wheel.processing = FALSE;
 
-static int
-destroy_timers_event_socket()
-{
-    struct sigaction sa;
-
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = NULL;
-    sa.sa_flags = 0;
-    sigemptyset(&sa.sa_mask);
-
-    if (sigaction(SIGRTMIN, &sa, NULL) == -1) {
-        LMLOG(LERR, "destroy_timers_event_socket: sigaction() failed %s",
-                strerror(errno));
-    }
-
-    close(signal_pipe[0]);
-    close(signal_pipe[1]);
-    return(GOOD);
+    wheel_arm(wheel_next_tick());
+    return(0);
 }
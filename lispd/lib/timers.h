@@ -24,6 +24,8 @@
 
 typedef enum {
     EXPIRE_MAP_CACHE_TIMER,
+    REFRESH_MAP_CACHE_TIMER,
+    REFRESH_MAP_REQUEST_TIMER,
     MAP_REGISTER_TIMER,
     MAP_REQUEST_RETRY_TIMER,
     RLOC_PROBING_TIMER,
@@ -48,8 +50,10 @@ typedef void (*lmtimer_del_cb_arg_fn)(void *arg);
 
 typedef struct lmtimer {
     lmtimer_links_t links;
-    int duration;
-    int rotation_count;
+    /* Tick of the timer wheel at which it expires */
+    uint64_t expires;
+    /* Level of the wheel it is linked in */
+    int level;
     lmtimer_callback_t cb;
     lmtimer_del_cb_arg_fn del_arg_fn;
     void *cb_argument;
@@ -68,6 +72,7 @@ void lmtimer_init(lmtimer_t *new_timer, void *owner, lmtimer_callback_t cb_fn,
         void *arg, lmtimer_del_cb_arg_fn del_arg_fn, void *nonces_lst);
 
 void lmtimer_start(lmtimer_t *, int);
+void lmtimer_start_ms(lmtimer_t *, int);
 
 void lmtimer_stop(lmtimer_t *);
 
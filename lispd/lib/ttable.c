@@ -17,82 +17,148 @@
  *
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "ttable.h"
 #include "util.h"
 #include "packets.h"
 #include "lmlog.h"
-#include "sockets.h"
-#include "../fwd_policies/fwd_policy.h"
 #include "../liblisp/liblisp.h"
 
-/* Time after which an entry is considered to have timed out and
- * is removed from the table */
-#define TIMEOUT 3
-
-/* Time after which a negative entry is considered to have timed
- * out and is removed from the table */
-#define NEGATIVE_TIMEOUT 0.1
-
-/* Maximum size of the tuple table */
-#define MAX_SIZE 10000
-#define OLD_ENTRIES 1000
+static inline uint32_t
+ttable_hash(packet_tuple_t *tpl)
+{
+    uint32_t hash = pkt_tuple_hash(tpl);
 
-static void ttable_remove_with_khiter(ttable_t *tt, khiter_t k);
+    /* 0 marks free slots */
+    return (hash ? hash : 1);
+}
 
-static double
-time_diff(struct timespec *x , struct timespec *y)
+static inline void
+ttable_key_from_tuple(ttable_key_t *key, packet_tuple_t *tpl)
 {
-    double x_s, y_s, diff;
+    memset(key, 0, sizeof(ttable_key_t));
+    lisp_addr_copy_to(key->src, &tpl->src_addr);
+    lisp_addr_copy_to(key->dst, &tpl->dst_addr);
+    key->src_port = tpl->src_port;
+    key->dst_port = tpl->dst_port;
+    key->protocol = tpl->protocol;
+    key->afi = lisp_addr_ip_afi(&tpl->src_addr);
+}
 
-    x_s = (double)x->tv_sec + 1.0e-9*x->tv_nsec;
-    y_s = (double)y->tv_sec + 1.0e-9*y->tv_nsec;
+/* Returns the slot of the bucket holding the flow or -1 */
+static inline int
+ttable_find(ttable_t *tt, ttable_bucket_t *b, uint32_t hash, ttable_key_t *key)
+{
+    ttable_entry_t *entries;
+    int i;
+
+    entries = &tt->entries[(b - tt->buckets) * TTABLE_BUCKET_SLOTS];
+    for (i = 0; i < TTABLE_BUCKET_SLOTS; i++) {
+        if (b->hash[i] == hash
+                && memcmp(&entries[i].key, key, sizeof(ttable_key_t)) == 0) {
+            return (i);
+        }
+    }
 
-    diff = (double)y_s - (double)x_s;
+    return (-1);
+}
 
-    return diff;
+static inline ttable_entry_t *
+ttable_entry(ttable_t *tt, ttable_bucket_t *b, int slot)
+{
+    return (&tt->entries[(b - tt->buckets) * TTABLE_BUCKET_SLOTS + slot]);
 }
 
-static double
-time_elapsed(struct timespec *time_node)
+static inline void
+ttable_free_slot(ttable_t *tt, ttable_bucket_t *b, int slot)
 {
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    return(time_diff(time_node, &now));
+    b->hash[slot] = 0;
+    tt->n_entries--;
 }
 
+/* Copy the forwarding info into the entry and build the outer headers of
+ * the flow, whose source port depends on its 'hash'. RLOCs are IP
+ * addresses, so no memory is allocated */
 static void
-ttable_node_del(ttable_node_t *tn)
+tentry_set_fwd_info(ttable_entry_t *te, fwd_info_t *fi, uint32_t hash)
 {
-    pkt_tuple_del(tn->tpl);
-    fwd_info_del(tn->fi,(fwd_info_data_del)fwd_entry_del);
-    free(tn);
+    fwd_entry_t *fe = (fwd_entry_t *)fi->fwd_info;
+
+    te->fi = *fi;
+    te->fi.fwd_info = NULL;
+    if (!fe) {
+        return;
+    }
+
+    memset(&te->fe, 0, sizeof(fwd_entry_t));
+    te->fe.out_sock = fe->out_sock;
+    if (fe->srloc) {
+        lisp_addr_copy(&te->srloc, fe->srloc);
+        te->fe.srloc = &te->srloc;
+    }
+    if (fe->drloc) {
+        lisp_addr_copy(&te->drloc, fe->drloc);
+        te->fe.drloc = &te->drloc;
+    }
+    if (fe->srloc && fe->drloc && lisp_data_encap_tpl_init(&te->encap_tpl,
+            lisp_data_src_port(hash), LISP_DATA_PORT, &te->srloc,
+            &te->drloc) == GOOD) {
+        te->fe.encap_tpl = &te->encap_tpl;
+    }
+    te->fi.fwd_info = &te->fe;
 }
 
-void
-ttable_init(ttable_t *tt)
+/* 'size' is rounded up to a power of 2 number of buckets */
+int
+ttable_init(ttable_t *tt, uint32_t size)
 {
-    tt->htable =  kh_init(ttable);
-    list_init(&tt->head_list);
+    uint32_t nbuckets = 1;
+
+    while (nbuckets * TTABLE_BUCKET_SLOTS < size) {
+        nbuckets <<= 1;
+    }
+
+    memset(tt, 0, sizeof(ttable_t));
+    if (posix_memalign((void **)&tt->buckets, 64,
+            nbuckets * sizeof(ttable_bucket_t)) != 0
+            || posix_memalign((void **)&tt->entries, 64,
+            nbuckets * TTABLE_BUCKET_SLOTS * sizeof(ttable_entry_t)) != 0) {
+        LMLOG(LCRIT, "ttable_init: Couldn't allocate a table of %u flows",
+                nbuckets * TTABLE_BUCKET_SLOTS);
+        free(tt->buckets);
+        tt->buckets = NULL;
+        return (BAD);
+    }
+    memset(tt->buckets, 0, nbuckets * sizeof(ttable_bucket_t));
+    tt->mask = nbuckets - 1;
+
+    LMLOG(LDBG_1, "ttable_init: Flow table of %u flows (%u KB)",
+            nbuckets * TTABLE_BUCKET_SLOTS, (unsigned int)(nbuckets
+            * (sizeof(ttable_bucket_t) + TTABLE_BUCKET_SLOTS
+            * sizeof(ttable_entry_t)) / 1024));
+
+    return (GOOD);
 }
 
 void
 ttable_uninit(ttable_t *tt)
 {
-    khiter_t k;
-
-    for (k = kh_begin(tt->htable); k != kh_end(tt->htable); ++k){
-        if (kh_exist(tt->htable, k)){
-            ttable_node_del(kh_value(tt->htable,k));
-        }
-    }
-    kh_destroy(ttable, tt->htable);
+    free(tt->buckets);
+    free(tt->entries);
+    tt->buckets = NULL;
+    tt->entries = NULL;
 }
 
 ttable_t *
-ttable_create()
+ttable_create(uint32_t size)
 {
    ttable_t *tt = xzalloc(sizeof(ttable_t));
-   ttable_init(tt);
+   if (ttable_init(tt, size) != GOOD) {
+       free(tt);
+       return (NULL);
+   }
    return(tt);
 }
 
@@ -103,118 +169,101 @@ ttable_destroy(ttable_t *tt)
     free(tt);
 }
 
-static int
-tnode_expired(ttable_node_t *tn)
-{
-    return(time_elapsed(&tn->ts) > TIMEOUT);
-}
-
-void
+/* Store the forwarding info of a flow, replacing the previous one if any.
+ * 'fi' is released. Returns the stored copy, valid until the next insert.
+ * The flow is kept until the mappings used to obtain 'fi' change or it is
+ * evicted */
+fwd_info_t *
 ttable_insert(ttable_t *tt, packet_tuple_t *tpl, fwd_info_t *fi)
 {
-    khiter_t k;
-    int ret,i,removed,to_remove;
-    ttable_node_t *node;
-    struct ovs_list *list_elt;
-
-    /* If table is full, lookup and remove expired entries. If it is still
-     * full, remove old entries */
-    if (kh_size(tt->htable) >= MAX_SIZE) {
-        LMLOG(LDBG_1,"ttable_insert: Max size of forwarding table reached. Removing expired entries");
-        removed = 0;
-        for (k = kh_begin(tt->htable); k != kh_end(tt->htable); ++k){
-            if (!kh_exist(tt->htable, k)){
-                continue;
+    ttable_bucket_t *b;
+    ttable_entry_t *te;
+    ttable_key_t key;
+    uint32_t hash, age, max_age = 0;
+    int i, slot;
+
+    hash = ttable_hash(tpl);
+    ttable_key_from_tuple(&key, tpl);
+    b = &tt->buckets[hash & tt->mask];
+
+    slot = ttable_find(tt, b, hash, &key);
+    if (slot < 0) {
+        /* Free slot or, if the bucket is full, the least recently used */
+        for (i = 0; i < TTABLE_BUCKET_SLOTS; i++) {
+            if (b->hash[i] == 0) {
+                slot = i;
+                break;
             }
-            if (tnode_expired(kh_value(tt->htable,k))){
-                ttable_remove_with_khiter(tt,k);
-                removed++;
+            age = tt->clock - b->last_use[i];
+            if (slot < 0 || age > max_age) {
+                slot = i;
+                max_age = age;
             }
         }
-        if (removed <  OLD_ENTRIES){
-            LMLOG(LDBG_1,"ttable_insert: Max size of forwarding table reached. Removing older entries");
-            to_remove = OLD_ENTRIES - removed;
-            for (i = 0 ; i < to_remove ; i++){
-                list_elt = list_back(&tt->head_list);
-                node = CONTAINER_OF(list_elt, ttable_node_t, list_elt);
-                ttable_remove(tt, node->tpl);
-            }
+        if (b->hash[slot] != 0) {
+            LMLOG(LDBG_3, "ttable_insert: Bucket full. Evicting oldest flow");
+            ttable_free_slot(tt, b, slot);
         }
+        b->hash[slot] = hash;
+        tt->n_entries++;
     }
 
-    node = xzalloc(sizeof(ttable_node_t));
-    node->fi = fi;
-    node->tpl = tpl;
-    clock_gettime(CLOCK_MONOTONIC, &node->ts);
+    te = ttable_entry(tt, b, slot);
+    te->key = key;
+    tentry_set_fwd_info(te, fi, hash);
+    b->last_use[slot] = ++tt->clock;
 
-    list_init(&node->list_elt);
-    list_push_front(&tt->head_list, &node->list_elt);
+    fwd_info_del(fi, (fwd_info_data_del)fwd_entry_del);
 
-    k = kh_put(ttable,tt->htable,tpl,&ret);
-    kh_value(tt->htable, k) = node;
     LMLOG(LDBG_3,"ttable_insert: Inserted tupla: %s ", pkt_tuple_to_char(tpl));
+    return (&te->fi);
 }
 
 void
 ttable_remove(ttable_t *tt, packet_tuple_t *tpl)
 {
-    khiter_t k;
-    ttable_node_t *tn;
+    ttable_bucket_t *b;
+    ttable_key_t key;
+    uint32_t hash;
+    int slot;
+
+    hash = ttable_hash(tpl);
+    ttable_key_from_tuple(&key, tpl);
+    b = &tt->buckets[hash & tt->mask];
 
-    k = kh_get(ttable,tt->htable, tpl);
-    if (k == kh_end(tt->htable)){
+    slot = ttable_find(tt, b, hash, &key);
+    if (slot < 0) {
         return;
     }
-    tn = kh_value(tt->htable,k);
-    LMLOG(LDBG_3,"ttable_remove: Remove tupla: %s ", pkt_tuple_to_char(tn->tpl));
-    list_remove(&tn->list_elt);
-    ttable_node_del(tn);
-    kh_del(ttable,tt->htable,k);
-}
-
-static void
-ttable_remove_with_khiter(ttable_t *tt, khiter_t k)
-{
-    ttable_node_t *node;
-
-    node = kh_value(tt->htable,k);
-    LMLOG(LDBG_3,"ttable_remove_with_khiter: Remove tupla: %s ", pkt_tuple_to_char(node->tpl));
-    list_remove(&node->list_elt);
-    ttable_node_del(node);
-    kh_del(ttable,tt->htable,k);
+    LMLOG(LDBG_3,"ttable_remove: Remove tupla: %s ", pkt_tuple_to_char(tpl));
+    ttable_free_slot(tt, b, slot);
 }
 
 fwd_info_t *
 ttable_lookup(ttable_t *tt, packet_tuple_t *tpl)
 {
-    ttable_node_t *tn;
-    khiter_t k;
-    double elapsed;
-
-    k = kh_get(ttable,tt->htable, tpl);
-    if (k == kh_end(tt->htable)){
+    ttable_bucket_t *b;
+    ttable_entry_t *te;
+    ttable_key_t key;
+    uint32_t hash;
+    int slot;
+
+    hash = ttable_hash(tpl);
+    ttable_key_from_tuple(&key, tpl);
+    b = &tt->buckets[hash & tt->mask];
+
+    slot = ttable_find(tt, b, hash, &key);
+    if (slot < 0) {
         return (NULL);
     }
-    tn = kh_value(tt->htable,k);
 
-    elapsed = time_elapsed(&tn->ts);
-    if (!tn->fi->temporal){
-        if (elapsed > TIMEOUT){
-            goto expired;
-        }
-    }else{
-        if (elapsed > NEGATIVE_TIMEOUT){
-            goto expired;
-        }
+    te = ttable_entry(tt, b, slot);
+    if (!fwd_info_is_valid(&te->fi)) {
+        ttable_free_slot(tt, b, slot);
+        return (NULL);
     }
+    b->last_use[slot] = ++tt->clock;
+    fwd_info_mark_used(&te->fi);
 
-    list_remove(&tn->list_elt);
-    list_push_front(&tt->head_list, &tn->list_elt);
-
-    return (tn->fi);
-
-expired:
-    ttable_remove_with_khiter(tt, k);
-    return(NULL);
+    return (&te->fi);
 }
-
@@ -20,32 +20,58 @@
 #ifndef TTABLE_H_
 #define TTABLE_H_
 
-#include <time.h>
 #include "packets.h"
-#include "../elibs/khash/khash.h"
-#include "../elibs/ovs/list.h"
+#include "sockets.h"
+#include "../fwd_policies/fwd_policy.h"
 
-typedef struct fwd_info_ fwd_info_t;
+/* Flows per bucket. The tags of a bucket fill a cache line */
+#define TTABLE_BUCKET_SLOTS 8
 
-typedef struct ttable_node {
-    struct ovs_list list_elt;
-    packet_tuple_t *tpl;
-    fwd_info_t *fi;
-    struct timespec ts;
-} ttable_node_t;
+/* Tuple of a flow. IPv4 addresses use the first word of src and dst */
+typedef struct ttable_key {
+    uint32_t src[4];
+    uint32_t dst[4];
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t protocol;
+    uint8_t afi;
+} ttable_key_t;
 
-KHASH_INIT(ttable, packet_tuple_t *, ttable_node_t *, 1, pkt_tuple_hash, pkt_tuple_cmp)
+/* Flow with its forwarding info and outer headers stored inline */
+typedef struct ttable_entry {
+    ttable_key_t key;
+    fwd_info_t fi;
+    fwd_entry_t fe;
+    lisp_addr_t srloc;
+    lisp_addr_t drloc;
+    pkt_hdr_tpl_t encap_tpl;
+} __attribute__ ((aligned (64))) ttable_entry_t;
 
+typedef struct ttable_bucket {
+    /* Hash of the flow in each slot. 0 if the slot is free */
+    uint32_t hash[TTABLE_BUCKET_SLOTS];
+    /* Value of the table clock when the slot was last used */
+    uint32_t last_use[TTABLE_BUCKET_SLOTS];
+} __attribute__ ((aligned (64))) ttable_bucket_t;
+
+/*
+ * Fixed capacity flow table. A flow can only be stored in the slots of the
+ * bucket selected by its hash, so lookups read at most one bucket and
+ * inserting into a full bucket evicts its least recently used flow.
+ */
 typedef struct ttable {
-    khash_t(ttable) *htable;
-    struct ovs_list head_list; /* To order flows */
+    ttable_bucket_t *buckets;
+    ttable_entry_t *entries;
+    uint32_t mask;              /* Number of buckets - 1 */
+    uint32_t clock;
+    uint32_t n_entries;
 } ttable_t;
 
-void ttable_init(ttable_t *tt);
+int ttable_init(ttable_t *tt, uint32_t size);
 void ttable_uninit(ttable_t *tt);
-ttable_t *ttable_create();
+ttable_t *ttable_create(uint32_t size);
 void ttable_destroy(ttable_t *tt);
-void ttable_insert(ttable_t *, packet_tuple_t *tpl, fwd_info_t *fe);
+fwd_info_t *ttable_insert(ttable_t *, packet_tuple_t *tpl, fwd_info_t *fe);
 void ttable_remove(ttable_t *tt, packet_tuple_t *tpl);
 fwd_info_t *ttable_lookup(ttable_t *tt, packet_tuple_t *tpl);
 
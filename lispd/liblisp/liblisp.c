@@ -264,6 +264,68 @@ err:
     return(BAD);
 }
 
+/* Length of the address at 'addr' as written in a message, without parsing
+ * it. Returns 0 if its AFI is unknown or it exceeds 'avail' bytes */
+static int
+msg_addr_len(uint8_t *addr, int avail)
+{
+    int len;
+
+    if (avail < (int)sizeof(uint16_t)) {
+        return(0);
+    }
+
+    switch (ntohs(*((uint16_t *)addr))) {
+    case LISP_AFI_NO_ADDR:
+        len = sizeof(uint16_t);
+        break;
+    case LISP_AFI_IP:
+        len = sizeof(uint16_t) + sizeof(struct in_addr);
+        break;
+    case LISP_AFI_IPV6:
+        len = sizeof(uint16_t) + sizeof(struct in6_addr);
+        break;
+    case LISP_AFI_LCAF:
+        if (avail < (int)sizeof(lcaf_hdr_t)) {
+            return(0);
+        }
+        len = sizeof(lcaf_hdr_t) + ntohs(((lcaf_hdr_t *)addr)->len);
+        break;
+    default:
+        return(0);
+    }
+
+    return(len <= avail ? len : 0);
+}
+
+/* Returns the length of the mapping record at the start of 'b' without
+ * parsing it, and in 'eid_len' the one of its EID-prefix field. Returns 0
+ * if the record is truncated or has an address with unknown AFI */
+int
+lisp_msg_mapping_record_len(lbuf_t *b, int *eid_len)
+{
+    uint8_t *rec = lbuf_data(b);
+    int avail = lbuf_size(b);
+    int len, alen, i;
+
+    len = sizeof(mapping_record_hdr_t);
+    if (avail < len || !(alen = msg_addr_len(rec + len, avail - len))) {
+        return(0);
+    }
+    *eid_len = alen;
+    len += alen;
+
+    for (i = 0; i < MAP_REC_LOC_COUNT(rec); i++) {
+        len += sizeof(locator_hdr_t);
+        if (len > avail || !(alen = msg_addr_len(rec + len, avail - len))) {
+            return(0);
+        }
+        len += alen;
+    }
+
+    return(len);
+}
+
 static unsigned int
 msg_type_to_hdr_len(lisp_msg_type_e type)
 {
@@ -330,7 +392,10 @@ lisp_msg_put_locator(lbuf_t *b, locator_t *locator)
     loc_ptr->weight = locator->weight;
     loc_ptr->mpriority = locator->mpriority;
     loc_ptr->mweight = locator->mweight;
+    loc_ptr->unused1 = 0;
+    loc_ptr->unused2 = 0;
     loc_ptr->local = 1;
+    loc_ptr->probed = 0;
     loc_ptr->reachable = locator->state;
 
     lisp_msg_put_addr(b, locator_addr(locator));
@@ -362,6 +427,17 @@ increment_record_count(lbuf_t *b)
 
 }
 
+/* Copies a mapping record of 'len' bytes, as found in a received message,
+ * to the message 'b' */
+void *
+lisp_msg_put_raw_mapping(lbuf_t *b, void *rec, int len)
+{
+    void *ptr = lbuf_put(b, rec, len);
+
+    increment_record_count(b);
+    return(ptr);
+}
+
 void *
 lisp_msg_put_mapping_hdr(lbuf_t *b)
 {
@@ -503,12 +579,14 @@ lisp_msg_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra)
     return(lbuf_data(b));
 }
 
+/* Buffer from the lbuf pool to receive a control message. Its memory is
+ * not zeroed */
 lbuf_t *
 lisp_msg_create_buf()
 {
     lbuf_t* b;
 
-    b = lbuf_new_with_headroom(MAX_IP_PKT_LEN, MAX_LISP_MSG_ENCAP_LEN);
+    b = lbuf_pool_new(MAX_IP_PKT_LEN, MAX_LISP_MSG_ENCAP_LEN);
     lbuf_reset_lisp(b);
     return(b);
 }
@@ -519,7 +597,8 @@ lisp_msg_create(lisp_msg_type_e type)
     lbuf_t* b;
     void *hdr;
 
-    b = lisp_msg_create_buf();
+    b = lbuf_pool_new(LISP_MSG_BUF_LEN, MAX_LISP_MSG_ENCAP_LEN);
+    lbuf_reset_lisp(b);
 
     switch(type) {
     case LISP_MAP_REQUEST:
@@ -589,6 +668,7 @@ lisp_msg_neg_mrep_create(lisp_addr_t *eid, int ttl, lisp_action_e ac,
     return(b);
 }
 
+/* With a NULL mapping, the Map-Register is created without records */
 lbuf_t *
 lisp_msg_mreg_create(mapping_t *m, lisp_key_type_e keyid)
 {
@@ -598,13 +678,39 @@ lisp_msg_mreg_create(mapping_t *m, lisp_key_type_e keyid)
         return(NULL);
     }
 
-    if (!lisp_msg_put_mapping(b, m, NULL)) {
+    if (m && !lisp_msg_put_mapping(b, m, NULL)) {
         return(NULL);
     }
 
     return(b);
 }
 
+/* Appends the record of the mapping to a Map-Register if the message doesn't
+ * exceed max_len bytes. Otherwise the message is left unchanged and NULL is
+ * returned. The first record is always added */
+void *
+lisp_msg_mreg_put_mapping(lbuf_t *b, mapping_t *m, int max_len)
+{
+    uint32_t len = lbuf_size(b);
+    void *hdr, *rec;
+
+    rec = lisp_msg_put_mapping(b, m, NULL);
+    if (!rec) {
+        lbuf_set_size(b, len);
+        return(NULL);
+    }
+
+    /* The buffer may have been reallocated */
+    hdr = lisp_msg_hdr(b);
+    if (MREG_REC_COUNT(hdr) > 1 && lbuf_size(b) > max_len) {
+        lbuf_set_size(b, len);
+        MREG_REC_COUNT(hdr) -= 1;
+        return(NULL);
+    }
+
+    return(rec);
+}
+
 lbuf_t *
 lisp_msg_nat_mreg_create(mapping_t *m, char *key, lisp_site_id *site_id,
         lisp_xtr_id *xtr_id, lisp_key_type_e keyid)
@@ -691,36 +797,68 @@ lisp_msg_fill_auth_data(lbuf_t *b, lisp_key_type_e keyid, const char *key)
     return(GOOD);
 }
 
-
-
-/* Checks auth field of Map-Reply and Map-Request messages */
+/* Same with a precomputed key. The auth record must be of its type */
 int
-lisp_msg_check_auth_field(lbuf_t *b, const char *key)
+lisp_msg_fill_auth_data_key(lbuf_t *b, hmac_key_t *hk)
 {
-    lisp_key_type_e keyid;
-    uint16_t        ad_len  = 0;
-    int             ret     = BAD;
+    void *hdr = lisp_msg_auth_record(b);
 
-    auth_record_hdr_t *hdr;
+    return(hmac_key_complete_auth_fields(hk, lbuf_lisp(b), lbuf_size(b),
+            AUTH_REC_DATA(hdr)));
+}
 
-    hdr = lisp_msg_auth_record(b);
+static auth_record_hdr_t *
+lisp_msg_valid_auth_record(lbuf_t *b)
+{
+    auth_record_hdr_t *hdr = lisp_msg_auth_record(b);
+    uint16_t ad_len = auth_data_get_len_for_type(ntohs(AUTH_REC_KEY_ID(hdr)));
 
-    keyid = ntohs(AUTH_REC_KEY_ID(hdr));
-    ad_len = auth_data_get_len_for_type(keyid);
     if (ad_len != ntohs(AUTH_REC_DATA_LEN(hdr))) {
         LMLOG(LDBG_3, "Auth Record record length is wrong: %d instead of %d",
                 ntohs(AUTH_REC_DATA_LEN(hdr)), ad_len);
+        return(NULL);
+    }
+    return(hdr);
+}
+
+/* Checks auth field of Map-Reply and Map-Request messages */
+int
+lisp_msg_check_auth_field(lbuf_t *b, const char *key)
+{
+    auth_record_hdr_t *hdr;
+
+    hdr = lisp_msg_valid_auth_record(b);
+    if (!hdr) {
         return(BAD);
     }
 
-    ret = check_auth_field(
-            keyid,
+    return(check_auth_field(
+            ntohs(AUTH_REC_KEY_ID(hdr)),
             key,
             lbuf_lisp(b),
             lbuf_size(b),
-            AUTH_REC_DATA(hdr));
+            AUTH_REC_DATA(hdr)));
+}
+
+/* Same with a precomputed key. Messages authenticated with another type of
+ * key are not valid */
+int
+lisp_msg_check_auth_field_key(lbuf_t *b, hmac_key_t *hk)
+{
+    auth_record_hdr_t *hdr;
+
+    hdr = lisp_msg_valid_auth_record(b);
+    if (!hdr || !hk) {
+        return(BAD);
+    }
+    if (ntohs(AUTH_REC_KEY_ID(hdr)) != hk->key_id) {
+        LMLOG(LDBG_3, "Auth Record key type %d doesn't match the key type %d",
+                ntohs(AUTH_REC_KEY_ID(hdr)), hk->key_id);
+        return(BAD);
+    }
 
-    return(ret);
+    return(hmac_key_check_auth_field(hk, lbuf_lisp(b), lbuf_size(b),
+            AUTH_REC_DATA(hdr)));
 }
 
 void *
@@ -745,10 +883,24 @@ lisp_data_push_hdr(lbuf_t *b)
     return(lhdr);
 }
 
+/* Outer UDP source port of the flow with tuple hash 'hash'. Spreads the
+ * flows between two RLOCs over the configured range, so that the underlay
+ * can balance them over equal cost paths and the receivers over their
+ * queues and sockets (RFC 6830, section 5.3) */
+uint16_t
+lisp_data_src_port(uint32_t hash)
+{
+    return(data_src_port_min
+            + hash % (uint32_t)(data_src_port_max - data_src_port_min + 1));
+}
+
+/* Encapsulate without a prebuilt template. Used when it can't be kept.
+ * Pushing the headers is cheaper than building a template for one packet */
 void *
 lisp_data_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra)
 {
     int ttl = 0, tos = 0;
+    int udp_cksum;
 
     /* read ttl and tos */
     ip_hdr_ttl_and_tos(lbuf_data(b), &ttl, &tos);
@@ -756,14 +908,69 @@ lisp_data_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra)
     /* push lisp data hdr */
     lisp_data_push_hdr(b);
 
+    if (ip_addr_afi(lisp_addr_ip(la)) == AF_INET) {
+        udp_cksum = data_udp_cksum_ipv4;
+    } else {
+        udp_cksum = data_udp_cksum_ipv6;
+    }
+
     /* push outer UDP and IP */
-    pkt_push_udp_and_ip(b, lp, rp, lisp_addr_ip(la), lisp_addr_ip(ra));
+    if (udp_cksum == UDP_CKSUM_FULL) {
+        if (pkt_push_udp_and_ip(b, lp, rp, lisp_addr_ip(la),
+                lisp_addr_ip(ra)) != GOOD) {
+            return(NULL);
+        }
+    } else {
+        pkt_push_udp(b, lp, rp);
+        lbuf_reset_udp(b);
+        if (pkt_push_ip(b, lisp_addr_ip(la), lisp_addr_ip(ra),
+                IPPROTO_UDP) == NULL) {
+            return(NULL);
+        }
+        lbuf_reset_ip(b);
+    }
 
     ip_hdr_set_ttl_and_tos(lbuf_data(b), ttl, tos);
 
     return(lbuf_data(b));
 }
 
+/* Prebuild the outer headers used by lisp_data_encap_tpl to encapsulate
+ * packets from RLOC 'la' to RLOC 'ra' */
+int
+lisp_data_encap_tpl_init(pkt_hdr_tpl_t *tpl, int lp, int rp, lisp_addr_t *la,
+        lisp_addr_t *ra)
+{
+    lisphdr_t lhdr;
+    int udp_cksum;
+
+    memset(&lhdr, 0, sizeof(lisphdr_t));
+    lisp_data_hdr_init(&lhdr);
+
+    if (ip_addr_afi(lisp_addr_ip(la)) == AF_INET) {
+        udp_cksum = data_udp_cksum_ipv4;
+    } else {
+        udp_cksum = data_udp_cksum_ipv6;
+    }
+
+    return(pkt_hdr_tpl_init(tpl, lp, rp, lisp_addr_ip(la), lisp_addr_ip(ra),
+            &lhdr, sizeof(lisphdr_t), udp_cksum));
+}
+
+/* Same as lisp_data_encap but copying the headers from 'tpl' */
+void *
+lisp_data_encap_tpl(lbuf_t *b, pkt_hdr_tpl_t *tpl)
+{
+    int ttl = 0, tos = 0;
+
+    /* read ttl and tos */
+    ip_hdr_ttl_and_tos(lbuf_data(b), &ttl, &tos);
+
+    pkt_push_hdr_tpl(b, tpl, ttl, tos);
+
+    return(lbuf_data(b));
+}
+
 void *
 lisp_data_pull_hdr(lbuf_t *b)
 {
@@ -805,7 +1012,7 @@ laddr_list_get_addr(glist_t *l, int afi, lisp_addr_t *addr)
 char *
 laddr_list_to_char(glist_t *l)
 {
-    static char buf[50*INET6_ADDRSTRLEN]; /* 50 addresses */
+    static __thread char buf[50*INET6_ADDRSTRLEN]; /* 50 addresses */
     int i = 1, n;
     glist_entry_t *it;
 
@@ -26,13 +26,17 @@
 #include "lisp_messages.h"
 #include "lisp_data.h"
 #include "../lib/generic_list.h"
+#include "../lib/hmac.h"
 #include "../lib/lbuf.h"
+#include "../lib/packets.h"
 
 
 #define LISP_DATA_HDR_LEN       8
 #define LISP_ECM_HDR_LEN        4
 #define MAX_LISP_MSG_ENCAP_LEN  2*(MAX_IP_HDR_LEN + UDP_HDR_LEN)+ LISP_ECM_HDR_LEN
 #define MAX_LISP_PKT_ENCAP_LEN  MAX_IP_HDR_LEN + UDP_HDR_LEN + LISP_DATA_HDR_LEN
+/* Initial room of the messages built, they grow if needed */
+#define LISP_MSG_BUF_LEN        1500
 
 #define LISP_CONTROL_PORT               4342
 #define LISP_DATA_PORT                  4341
@@ -46,6 +50,7 @@ int lisp_msg_parse_loc(lbuf_t *, locator_t *);
 int lisp_msg_parse_mapping_record_split(lbuf_t *, lisp_addr_t *, glist_t *,
                                         locator_t **);
 int lisp_msg_parse_mapping_record(lbuf_t *, mapping_t *, locator_t **);
+int lisp_msg_mapping_record_len(lbuf_t *, int *);
 
 int lisp_msg_ecm_decap(struct lbuf *, uint16_t *);
 
@@ -53,6 +58,7 @@ void *lisp_msg_put_addr(lbuf_t *, lisp_addr_t *);
 void *lisp_msg_put_locator(lbuf_t *, locator_t *);
 void *lisp_msg_put_mapping_hdr(lbuf_t *) ;
 void *lisp_msg_put_mapping(lbuf_t *, mapping_t *, lisp_addr_t *);
+void *lisp_msg_put_raw_mapping(lbuf_t *, void *, int);
 void *lisp_msg_put_neg_mapping(lbuf_t *, lisp_addr_t *, int, lisp_action_e,
         lisp_authoritative_e a);
 void *lisp_msg_put_itr_rlocs(lbuf_t *, glist_t *);
@@ -68,6 +74,7 @@ lbuf_t *lisp_msg_mreq_create(lisp_addr_t *, glist_t *, lisp_addr_t *);
 lbuf_t *lisp_msg_neg_mrep_create(lisp_addr_t *, int, lisp_action_e,
         lisp_authoritative_e, uint64_t);
 lbuf_t *lisp_msg_mreg_create(mapping_t *, lisp_key_type_e);
+void *lisp_msg_mreg_put_mapping(lbuf_t *, mapping_t *, int);
 lbuf_t *lisp_msg_nat_mreg_create(mapping_t *, char *, lisp_site_id *,
         lisp_xtr_id *, lisp_key_type_e );
 
@@ -76,6 +83,8 @@ char *lisp_msg_ecm_hdr_to_char(lbuf_t *b);
 
 int lisp_msg_fill_auth_data(lbuf_t *, lisp_key_type_e , const char *);
 int lisp_msg_check_auth_field(lbuf_t *, const char *);
+int lisp_msg_fill_auth_data_key(lbuf_t *, hmac_key_t *);
+int lisp_msg_check_auth_field_key(lbuf_t *, hmac_key_t *);
 void *lisp_msg_put_empty_auth_record(lbuf_t *, lisp_key_type_e);
 static inline void *lisp_msg_auth_record(lbuf_t *);
 
@@ -84,7 +93,11 @@ void *lisp_msg_pull_auth_field(lbuf_t *b);
 
 void *lisp_data_push_hdr(lbuf_t *b);
 void *lisp_data_pull_hdr(lbuf_t *b);
+uint16_t lisp_data_src_port(uint32_t hash);
 void *lisp_data_encap(lbuf_t *, int, int, lisp_addr_t *, lisp_addr_t *);
+int lisp_data_encap_tpl_init(pkt_hdr_tpl_t *, int, int, lisp_addr_t *,
+        lisp_addr_t *);
+void *lisp_data_encap_tpl(lbuf_t *, pkt_hdr_tpl_t *);
 
 static inline glist_t *laddr_list_new();
 static inline void laddr_list_init(glist_t *);
@@ -578,8 +578,8 @@ mc_type_get_grp_plen(mc_t *mc)
 char *
 mc_type_to_char(void *mc)
 {
-    static char buf[10][INET6_ADDRSTRLEN*2+4];
-    static unsigned int i   = 0;
+    static __thread char buf[10][INET6_ADDRSTRLEN*2+4];
+    static __thread unsigned int i   = 0;
 
     i++;
     i = i % 10;
@@ -806,8 +806,8 @@ iid_type_parse(uint8_t *offset, void **iid)
 char *
 iid_type_to_char(void *iid)
 {
-    static char buf[10][INET6_ADDRSTRLEN*2+4];
-    static unsigned int i   = 0;
+    static __thread char buf[10][INET6_ADDRSTRLEN*2+4];
+    static __thread unsigned int i   = 0;
 
     i++;
     i = i % 10;
@@ -986,8 +986,8 @@ geo_type_get_addr(geo_t *geo)
 char *
 geo_type_to_char(void *geo)
 {
-    static char buf[10][INET6_ADDRSTRLEN*2+4];
-    static unsigned int i   = 0;
+    static __thread char buf[10][INET6_ADDRSTRLEN*2+4];
+    static __thread unsigned int i   = 0;
 
     i++;
     i = i % 10;
@@ -1003,7 +1003,7 @@ geo_type_to_char(void *geo)
 char *
 geo_coord_to_char(geo_coordinates *coord)
 {
-    static char buf[INET6_ADDRSTRLEN*2+4];
+    static __thread char buf[INET6_ADDRSTRLEN*2+4];
     *buf= '\0';
     sprintf(buf, "dir %d deg %d min %d sec %d",
             coord->dir, coord->deg, coord->min, coord->sec);
@@ -1168,8 +1168,8 @@ err:
 char *
 elp_type_to_char(void *elp)
 {
-    static char buf[5][500];
-    static unsigned int i = 0;
+    static __thread char buf[5][500];
+    static __thread unsigned int i = 0;
     int j = 0;
     glist_entry_t * it = NULL;
     elp_node_t * node = NULL;
@@ -1438,8 +1438,8 @@ rle_type_get_size_to_write(void *rle)
 char *
 rle_type_to_char(void *rle)
 {
-    static char buf[3][500];
-    static unsigned int i = 0;
+    static __thread char buf[3][500];
+    static __thread unsigned int i = 0;
     int j = 0;
     glist_entry_t * it = NULL;
     rle_node_t * node = NULL;
@@ -1638,8 +1638,8 @@ afi_list_type_to_char(void *afil)
 {
     lisp_addr_t * addr = NULL;
     glist_entry_t * it = NULL;
-    static char buf[3][500];
-    static int i = 0;
+    static __thread char buf[3][500];
+    static __thread int i = 0;
     int j = 0;
 
     i++;
@@ -52,8 +52,8 @@ locator_new_init(lisp_addr_t* addr,uint8_t state, uint8_t priority, uint8_t weig
 char *
 locator_to_char(locator_t *l)
 {
-    static char buf[5][500];
-    static int i=0;
+    static __thread char buf[5][500];
+    static __thread int i=0;
     if (l == NULL){
         sprintf(buf[i], "_NULL_");
         return (buf[i]);
@@ -144,7 +144,7 @@ mapping_to_char(mapping_t *m)
     locator_t *locator = NULL;
     glist_entry_t * it_list = NULL;
     glist_entry_t * it_loct = NULL;
-    static char buf[100];
+    static __thread char buf[100];
 
     *buf = '\0';
     sprintf(buf, "EID: %s, ttl: %d, loc-count: %d, action: %s, "
@@ -39,7 +39,7 @@ mapping_record_init_hdr(mapping_record_hdr_t *h) {
 
 char *
 mapping_action_to_char(int act) {
-    static char buf[30];
+    static __thread char buf[30];
 
     *buf = '\0';
     switch(act) {
@@ -64,7 +64,7 @@ mapping_action_to_char(int act) {
 char *
 mapping_record_hdr_to_char(mapping_record_hdr_t *h)
 {
-    static char buf[100];
+    static __thread char buf[100];
 
     if (!h) {
         return(NULL);
@@ -83,7 +83,7 @@ mapping_record_hdr_to_char(mapping_record_hdr_t *h)
 char *
 locator_record_flags_to_char(locator_hdr_t *h)
 {
-    static char buf[5];
+    static __thread char buf[5];
     *buf = '\0';
     h->local ? sprintf(buf+strlen(buf), "L=1,") : sprintf(buf+strlen(buf), "L=0,");
     h->probed ? sprintf(buf+strlen(buf), "p=1,") : sprintf(buf+strlen(buf), "p=0,");
@@ -94,7 +94,7 @@ locator_record_flags_to_char(locator_hdr_t *h)
 char *
 locator_record_hdr_to_char(locator_hdr_t *h)
 {
-   static char buf[100];
+   static __thread char buf[100];
 
    if (!h) {
        return(NULL);
@@ -111,8 +111,10 @@ uint16_t
 auth_data_get_len_for_type(lisp_key_type_e key_id)
 {
     switch (key_id) {
+    case HMAC_SHA_256_128:
+        return (LISP_SHA256_AUTH_DATA_LEN);
     default: // HMAC_SHA_1_96
-        return (LISP_SHA1_AUTH_DATA_LEN);   //TODO support more auth algorithms
+        return (LISP_SHA1_AUTH_DATA_LEN);
     }
 }
 
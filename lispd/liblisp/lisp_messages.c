@@ -75,6 +75,7 @@ map_register_hdr_init(void *ptr)
     mrp->type = LISP_MAP_REGISTER;
     mrp->proxy_reply = 0;               /* default no proxy-map-reply */
     mrp->map_notify = 1;                /* default want map-notify */
+    mrp->lisp_mn = 0;
     mrp->nonce = 0;                     /* to be filled in later */
     mrp->record_count = 0;              /* to be filled in later */
     mrp->rbit = 0;                      /* default not NATT */
@@ -114,7 +115,7 @@ ecm_hdr_init(void *ptr)
 char *
 mreq_flags_to_char(map_request_hdr_t *h)
 {
-    static char buf[25];
+    static __thread char buf[25];
 
     *buf = '\0';
     h->authoritative ? sprintf(buf+strlen(buf), "a=1,") : sprintf(buf+strlen(buf), "a=0,");
@@ -130,7 +131,7 @@ mreq_flags_to_char(map_request_hdr_t *h)
 char *
 map_request_hdr_to_char(map_request_hdr_t *h)
 {
-    static char buf[100];
+    static __thread char buf[100];
 
     if (!h) {
         return(NULL);
@@ -145,7 +146,7 @@ map_request_hdr_to_char(map_request_hdr_t *h)
 char *
 mrep_flags_to_char(map_reply_hdr_t *h)
 {
-    static char buf[10];
+    static __thread char buf[10];
 
     *buf = '\0';
     h->rloc_probe ? sprintf(buf+strlen(buf), "P=1,") : sprintf(buf+strlen(buf), "P=0,");
@@ -157,7 +158,7 @@ mrep_flags_to_char(map_reply_hdr_t *h)
 char *
 map_reply_hdr_to_char(map_reply_hdr_t *h)
 {
-    static char buf[100];
+    static __thread char buf[100];
 
     if (!h) {
         return(NULL);
@@ -171,7 +172,7 @@ map_reply_hdr_to_char(map_reply_hdr_t *h)
 char *
 mreg_flags_to_char(map_register_hdr_t *h)
 {
-    static char buf[10];
+    static __thread char buf[10];
 
     *buf = '\0';
     h->proxy_reply ? sprintf(buf+strlen(buf), "P") : sprintf(buf+strlen(buf), "p");
@@ -184,7 +185,7 @@ mreg_flags_to_char(map_register_hdr_t *h)
 char *
 map_register_hdr_to_char(map_register_hdr_t *h)
 {
-    static char buf[100];
+    static __thread char buf[100];
 
     if (!h) {
         return(NULL);
@@ -198,7 +199,7 @@ map_register_hdr_to_char(map_register_hdr_t *h)
 char *
 mntf_flags_to_char(map_notify_hdr_t *h)
 {
-    static char buf[5];
+    static __thread char buf[5];
 
     *buf = '\0';
     h->xtr_id_present ? sprintf(buf+strlen(buf), "I") : sprintf(buf+strlen(buf), "i");
@@ -209,7 +210,7 @@ mntf_flags_to_char(map_notify_hdr_t *h)
 char *
 map_notify_hdr_to_char(map_notify_hdr_t *h)
 {
-    static char buf[100];
+    static __thread char buf[100];
 
     if (!h) {
         return(NULL);
@@ -224,7 +225,7 @@ map_notify_hdr_to_char(map_notify_hdr_t *h)
 char *
 ecm_flags_to_char(ecm_hdr_t *h)
 {
-    static char buf[10];
+    static __thread char buf[10];
 
     *buf = '\0';
     h->s_bit ? sprintf(buf+strlen(buf), "S") : sprintf(buf+strlen(buf), "s");
@@ -234,7 +235,7 @@ ecm_flags_to_char(ecm_hdr_t *h)
 char *
 ecm_hdr_to_char(ecm_hdr_t *h)
 {
-    static char buf[50];
+    static __thread char buf[50];
 
     if (!h) {
         return(NULL);
@@ -21,6 +21,7 @@
 #include <linux/capability.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
+#include <sys/eventfd.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -35,8 +36,10 @@
 #include "iface_list.h"
 #include "iface_mgmt.h"
 #include "data-plane/data-plane.h"
+#include "lib/lbuf.h"
 #include "lib/lmlog.h"
 #include "lib/nonces_table.h"
+#include "lib/obj_pool.h"
 #include "lib/pointers_table.h"
 #include "lib/sockets.h"
 #include "lib/timers.h"
@@ -67,6 +70,22 @@ char    *config_file                        = NULL;
 int      debug_level                        = -1;
 int      default_rloc_afi                   = AF_UNSPEC;
 int      daemonize                          = FALSE;
+int      data_batch_size                    = DEFAULT_DATA_BATCH_SIZE;
+int      data_plane_threads                 = 0;
+int      flow_table_size                    = DEFAULT_FLOW_TABLE_SIZE;
+int      data_udp_cksum_ipv4                = DEFAULT_UDP_CKSUM_IPV4;
+int      data_udp_cksum_ipv6                = DEFAULT_UDP_CKSUM_IPV6;
+int      data_src_port_min                  = DEFAULT_DATA_SRC_PORT_MIN;
+int      data_src_port_max                  = DEFAULT_DATA_SRC_PORT_MAX;
+int      pending_packets_per_eid            = DEFAULT_PENDING_PACKETS_PER_EID;
+int      pending_packets_memory             = DEFAULT_PENDING_PACKETS_MEMORY;
+int      map_request_window                 = DEFAULT_MAP_REQUEST_WINDOW;
+int      map_cache_refresh                  = DEFAULT_MAP_CACHE_REFRESH;
+int      map_cache_max_entries              = DEFAULT_MAP_CACHE_MAX_ENTRIES;
+int      map_cache_max_memory               = DEFAULT_MAP_CACHE_MAX_MEMORY;
+int      map_register_jitter                = DEFAULT_MAP_REGISTER_JITTER;
+int      map_server_threads                 = 0;
+int      map_request_rate_limit             = 0;
 
 uint32_t iseed                              = 0;  /* initial random number generator */
 
@@ -78,6 +97,7 @@ pid_t  sid                                  = 0;
 int     ipv4_data_input_fd                  = -1;
 int     ipv6_data_input_fd                  = -1;
 int     netlink_fd                          = -1;
+int     stats_fd                            = -1; /* written on SIGUSR1 */
 
 /* NAT */
 int nat_aware = FALSE;
@@ -89,6 +109,7 @@ lisp_ctrl_dev_t *ctrl_dev;
 lisp_ctrl_t *lctrl;
 #ifdef VPNAPI
 int lispd_running;
+int stop_fd = -1;   /* written by lispd_exit to wake up the event loop */
 #endif
 #ifndef ANDROID
 /* LISPmob's API connection structure */
@@ -235,6 +256,16 @@ signal_handler(int sig) {
         /* TODO: SIGHUP should trigger reloading the configuration file */
         LMLOG(LDBG_1, "Received SIGHUP signal.");
         break;
+    case SIGUSR1:
+        /* The statistics are dumped from the event loop. Only write(2) is
+         * async-signal-safe here */
+        if (stats_fd != -1) {
+            uint64_t one = 1;
+            if (write(stats_fd, &one, sizeof(one)) != sizeof(one)) {
+                /* Already pending */
+            }
+        }
+        break;
     case SIGTERM:
         /* SIGTERM is the default signal sent by 'kill'. Exit cleanly */
         LMLOG(LDBG_1, "Received SIGTERM signal. Cleaning up...");
@@ -270,10 +301,13 @@ exit_cleanup(void) {
 
     ifaces_destroy();
 
-    if (!data_plane){
+    if (data_plane){
         data_plane->datap_uninit();
     }
 
+#ifdef VPNAPI
+    stop_fd = -1;   /* closed with the socket master */
+#endif
     sockmstr_destroy(smaster);
 
     lmtimers_destroy();
@@ -372,8 +406,84 @@ setup_signal_handlers()
     signal(SIGTERM, signal_handler);
     signal(SIGINT,  signal_handler);
     signal(SIGQUIT, signal_handler);
+    signal(SIGUSR1, signal_handler);
+}
+
+/* Statistics of the pools of timers, timer arguments and buffers, and of the
+ * map cache. Requested with SIGUSR1 */
+static int
+process_stats_fd(sock_t *sl)
+{
+    uint64_t count;
+
+    if (read(sl->fd, &count, sizeof(count)) != sizeof(count)
+            && errno != EAGAIN) {
+        LMLOG(LDBG_2, "process_stats_fd: read error: %s", strerror(errno));
+    }
+
+    obj_pools_dump(LINF);
+    lbuf_pool_dump(LINF);
+    if (ctrl_dev && ctrl_dev_mode(ctrl_dev) != MS_MODE) {
+        mcache_stats_dump(
+                CONTAINER_OF(ctrl_dev, lisp_xtr_t, super)->map_cache, LINF);
+    }
+
+    return (GOOD);
 }
 
+static void
+init_stats_fd()
+{
+    int fd;
+
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        LMLOG(LWRN, "init_stats_fd: eventfd: %s. SIGUSR1 is ignored",
+                strerror(errno));
+        return;
+    }
+    if (!sockmstr_register_read_listener(smaster, process_stats_fd, NULL,
+            fd)) {
+        close(fd);
+        return;
+    }
+    stats_fd = fd;
+}
+
+#ifdef VPNAPI
+/* Only wakes up the event loop, that checks lispd_running */
+static int
+process_stop_fd(sock_t *sl)
+{
+    uint64_t count;
+
+    if (read(sl->fd, &count, sizeof(count)) != sizeof(count)
+            && errno != EAGAIN) {
+        LMLOG(LDBG_2, "process_stop_fd: read error: %s", strerror(errno));
+    }
+    return (GOOD);
+}
+
+static int
+init_stop_fd()
+{
+    int fd;
+
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        LMLOG(LCRIT, "init_stop_fd: eventfd: %s", strerror(errno));
+        return (BAD);
+    }
+    if (!sockmstr_register_read_listener(smaster, process_stop_fd, NULL,
+            fd)) {
+        close(fd);
+        return (BAD);
+    }
+    stop_fd = fd;
+    return (GOOD);
+}
+#endif
+
 static void
 init_netlink()
 {
@@ -466,7 +576,10 @@ main(int argc, char **argv)
     demonize_start();
 
     /* create socket master, timer wheel, initialize interfaces */
-    smaster = sockmstr_create();
+    if ((smaster = sockmstr_create()) == NULL){
+        exit_cleanup();
+    }
+    init_stats_fd();
     lmtimers_init();
     ifaces_init();
 
@@ -488,6 +601,10 @@ main(int argc, char **argv)
     if (dev_type == xTR_MODE || dev_type == RTR_MODE || dev_type == MN_MODE) {
         data_plane->datap_init(dev_type);
     }
+    if (dev_type != MS_MODE && map_server_threads > 0) {
+        LMLOG(LWRN, "map-server-threads is only used in MS mode. Ignoring it");
+        map_server_threads = 0;
+    }
 
     ctrl_init(lctrl);
     init_netlink();
@@ -508,7 +625,6 @@ main(int argc, char **argv)
     for (;;) {
         sockmstr_wait_on_all_read(smaster);
         sockmstr_process_all(smaster);
-        lmapi_loop(&lmapi_connection);
     }
 #else
     for (;;) {
@@ -523,9 +639,6 @@ main(int argc, char **argv)
     for (;;) {
         sockmstr_wait_on_all_read(smaster);
         sockmstr_process_all(smaster);
-#ifndef ANDROID
-        lmapi_loop(&lmapi_connection);
-#endif
     }
 
     /* event_loop returned: bad! */
@@ -553,7 +666,15 @@ JNIEXPORT jint JNICALL Java_org_lispmob_noroot_LISPmob_1JNI_startLispd
     jni_init(env,thisObj);
 
     /* create socket master, timer wheel, initialize interfaces */
-    smaster = sockmstr_create();
+    if ((smaster = sockmstr_create()) == NULL){
+        exit_cleanup();
+        return (BAD);
+    }
+    if (init_stop_fd() != GOOD){
+        exit_cleanup();
+        return (BAD);
+    }
+    init_stats_fd();
     lmtimers_init();
     ifaces_init();
 
@@ -616,7 +737,14 @@ JNIEXPORT void JNICALL Java_org_lispmob_noroot_LISPmob_1JNI_lispd_1loop(JNIEnv *
 
 JNIEXPORT void JNICALL Java_org_lispmob_noroot_LISPmob_1JNI_lispd_1exit
    (JNIEnv * env, jclass cl){
+    uint64_t one = 1;
+
     lispd_running = false;
+    /* The loop may be blocked waiting for a socket */
+    if (stop_fd != -1 && write(stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        LMLOG(LDBG_1, "lispd_exit: Couldn't wake up the event loop: %s",
+                strerror(errno));
+    }
 }
 
 #endif
@@ -108,6 +108,36 @@ lmapi_result_msg_new(uint8_t **buf,lmapi_msg_device_e  dev,
 }
 
 
+int
+lmapi_get_fd(lmapi_connection_t *conn)
+{
+    int fd;
+    size_t fd_len = sizeof(fd);
+
+    if (zmq_getsockopt(conn->socket, ZMQ_FD, &fd, &fd_len) != 0){
+        LMLOG(LERR,"LMAPI: Error while getting ZMQ file descriptor: %s\n",
+                zmq_strerror (errno));
+        return (LMAPI_ERROR);
+    }
+
+    return (fd);
+}
+
+int
+lmapi_msg_pending(lmapi_connection_t *conn)
+{
+    int events;
+    size_t events_len = sizeof(events);
+
+    /* The ZMQ file descriptor is edge triggered, the state of the socket has
+     * to be checked after each operation */
+    if (zmq_getsockopt(conn->socket, ZMQ_EVENTS, &events, &events_len) != 0){
+        return (FALSE);
+    }
+
+    return ((events & ZMQ_POLLIN) ? TRUE : FALSE);
+}
+
 int
 lmapi_recv(lmapi_connection_t *conn, void *buffer, int flags)
 {
@@ -128,6 +128,12 @@ int lmapi_send(lmapi_connection_t *conn, void *msg, int len, int flags);
 
 int lmapi_recv(lmapi_connection_t *conn, void *buffer, int flags);
 
+/* File descriptor signaled when the state of the API socket changes */
+int lmapi_get_fd(lmapi_connection_t *conn);
+
+/* Check if there is an API message ready to be received */
+int lmapi_msg_pending(lmapi_connection_t *conn);
+
 void fill_lmapi_hdr(lmapi_msg_hdr_t *hdr, lmapi_msg_device_e dev,
         lmapi_msg_target_e trgt, lmapi_msg_opr_e opr,
         lmapi_msg_type_e type, int dlen);
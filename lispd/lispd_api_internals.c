@@ -20,7 +20,10 @@
 #include "lispd_api_internals.h"
 
 #include "lispd_config_functions.h"
+#include "lispd_external.h"
+#include "control/lisp_fwd_state.h"
 #include "lib/lmlog.h"
+#include "lib/sockets.h"
 #include "liblisp/liblisp.h"
 #include "lib/util.h"
 #include <libxml/tree.h>
@@ -337,8 +340,9 @@ lxml_update_map_server_list(xmlNodePtr xml_map_servers, uint8_t proxy_reply,
             key_type = HMAC_SHA_256_128;
         }
         free(key_type_aux);
-        if (key_type != HMAC_SHA_1_96){
-            LMLOG(LERR, "Configuraton file: Only SHA-1 (1) authentication is supported");
+        if (key_type != HMAC_SHA_1_96 && key_type != HMAC_SHA_256_128){
+            LMLOG(LERR, "Configuraton file: Only SHA-1 (1) and SHA-256 (2) "
+                    "authentication are supported");
             free(str_addr);
             free(key);
             return (BAD);
@@ -396,11 +400,25 @@ lxml_update_map_server_list(xmlNodePtr xml_map_servers, uint8_t proxy_reply,
 }
 
 
+/* Serve all the API requests pending in the connection */
+static int
+lmapi_recv_cb(sock_t *sl)
+{
+    lmapi_connection_t *conn = (lmapi_connection_t *)sl->arg;
+
+    while (lmapi_msg_pending(conn)){
+        lmapi_loop(conn);
+    }
+
+    return (GOOD);
+}
+
 int
 lmapi_init_server(lmapi_connection_t *conn)
 {
 
 	int error;
+	int fd;
 
     conn->context = zmq_ctx_new();
     LMLOG(LDBG_3,"LMAPI: zmq_ctx_new errno: %s\n",zmq_strerror (errno));
@@ -417,6 +435,14 @@ lmapi_init_server(lmapi_connection_t *conn)
     	goto err;
     }
 
+    /* Requests are served from the main event loop. The descriptor belongs to
+     * ZMQ, register a copy so the socket master can close it */
+    fd = lmapi_get_fd(conn);
+    if (fd == LMAPI_ERROR){
+        goto err;
+    }
+    sockmstr_register_read_listener(smaster, lmapi_recv_cb, conn, dup(fd));
+
     LMLOG(LDBG_2,"LMAPI: API server initiated using ZMQ\n");
 
     return (GOOD);
@@ -893,6 +919,8 @@ lmapi_xtr_petrs_create(lmapi_connection_t *conn, lmapi_msg_hdr_t *hdr,
             xtr->fwd_policy_dev_parm,
             mcache_entry_routing_info(xtr->petrs),
             mcache_entry_mapping(xtr->petrs));
+    fwd_epoch_bump();
+    fwd_state_changed();
 
     LMLOG(LDBG_1, "LMAPI: List of Proxy ETRs successfully created");
     LMLOG(LDBG_1, "************************* Proxy ETRs List ****************************");
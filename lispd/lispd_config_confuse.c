@@ -1062,6 +1062,22 @@ handle_config_file(char **lispdconf_conf_file)
             CFG_INT("control-port",         0, CFGF_NONE),
             CFG_INT("debug",                0, CFGF_NONE),
             CFG_STR("log-file",             0, CFGF_NONE),
+            CFG_INT("data-batch-size",      DEFAULT_DATA_BATCH_SIZE, CFGF_NONE),
+            CFG_INT("data-plane-threads",   0, CFGF_NONE),
+            CFG_INT("flow-table-size",      DEFAULT_FLOW_TABLE_SIZE, CFGF_NONE),
+            CFG_STR("udp-checksum-ipv4",    0, CFGF_NONE),
+            CFG_STR("udp-checksum-ipv6",    0, CFGF_NONE),
+            CFG_INT("data-src-port-min",    DEFAULT_DATA_SRC_PORT_MIN, CFGF_NONE),
+            CFG_INT("data-src-port-max",    DEFAULT_DATA_SRC_PORT_MAX, CFGF_NONE),
+            CFG_INT("pending-packets-per-eid", DEFAULT_PENDING_PACKETS_PER_EID, CFGF_NONE),
+            CFG_INT("pending-packets-memory", DEFAULT_PENDING_PACKETS_MEMORY, CFGF_NONE),
+            CFG_INT("map-request-window",   DEFAULT_MAP_REQUEST_WINDOW, CFGF_NONE),
+            CFG_INT("map-cache-refresh",    DEFAULT_MAP_CACHE_REFRESH, CFGF_NONE),
+            CFG_INT("map-cache-max-entries", DEFAULT_MAP_CACHE_MAX_ENTRIES, CFGF_NONE),
+            CFG_INT("map-cache-max-memory", DEFAULT_MAP_CACHE_MAX_MEMORY, CFGF_NONE),
+            CFG_INT("map-register-jitter",  DEFAULT_MAP_REGISTER_JITTER, CFGF_NONE),
+            CFG_INT("map-server-threads",   0, CFGF_NONE),
+            CFG_INT("map-request-rate-limit", 0, CFGF_NONE),
             CFG_INT("rloc-probing-interval",0, CFGF_NONE),
             CFG_STR_LIST("map-resolver",    0, CFGF_NONE),
             CFG_STR_LIST("proxy-itrs",      0, CFGF_NONE),
@@ -1132,6 +1148,125 @@ handle_config_file(char **lispdconf_conf_file)
         open_log_file(log_file);
     }
 
+    /* Data packets processed per readiness event */
+    ret = cfg_getint(cfg, "data-batch-size");
+    if (ret >= 1 && ret <= MAX_DATA_BATCH_SIZE){
+        data_batch_size = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: data-batch-size should be between 1 "
+                "and %d. Using default value: %d",MAX_DATA_BATCH_SIZE,
+                DEFAULT_DATA_BATCH_SIZE);
+    }
+
+    /* Threads processing data packets */
+    ret = cfg_getint(cfg, "data-plane-threads");
+    if (ret >= 0 && ret <= MAX_DATA_PLANE_THREADS){
+        data_plane_threads = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: data-plane-threads should be between 0 "
+                "and %d. Using default value: 0",MAX_DATA_PLANE_THREADS);
+    }
+
+    /* Flows cached by the data plane */
+    ret = cfg_getint(cfg, "flow-table-size");
+    if (ret >= 1 && ret <= MAX_FLOW_TABLE_SIZE){
+        flow_table_size = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: flow-table-size should be between 1 "
+                "and %d. Using default value: %d",
+                MAX_FLOW_TABLE_SIZE, DEFAULT_FLOW_TABLE_SIZE);
+    }
+
+    /* UDP checksum of encapsulated data packets */
+    set_data_udp_cksum(cfg_getstr(cfg, "udp-checksum-ipv4"),
+            cfg_getstr(cfg, "udp-checksum-ipv6"));
+
+    /* Outer UDP source ports of encapsulated data packets */
+    set_data_src_ports(cfg_getint(cfg, "data-src-port-min"),
+            cfg_getint(cfg, "data-src-port-max"));
+
+    ret = cfg_getint(cfg, "pending-packets-per-eid");
+    if (ret >= 0 && ret <= MAX_PENDING_PACKETS_PER_EID){
+        pending_packets_per_eid = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: pending-packets-per-eid should be between 0 "
+                "and %d. Using default value: %d",
+                MAX_PENDING_PACKETS_PER_EID, DEFAULT_PENDING_PACKETS_PER_EID);
+    }
+
+    ret = cfg_getint(cfg, "pending-packets-memory");
+    if (ret >= 1 && ret <= MAX_PENDING_PACKETS_MEMORY){
+        pending_packets_memory = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: pending-packets-memory should be between 1 "
+                "and %d. Using default value: %d",
+                MAX_PENDING_PACKETS_MEMORY, DEFAULT_PENDING_PACKETS_MEMORY);
+    }
+
+    ret = cfg_getint(cfg, "map-request-window");
+    if (ret >= 0 && ret <= MAX_MAP_REQUEST_WINDOW){
+        map_request_window = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-request-window should be between 0 "
+                "and %d. Using default value: %d",
+                MAX_MAP_REQUEST_WINDOW, DEFAULT_MAP_REQUEST_WINDOW);
+    }
+
+    ret = cfg_getint(cfg, "map-cache-refresh");
+    if (ret >= 0 && ret <= MAX_MAP_CACHE_REFRESH){
+        map_cache_refresh = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-cache-refresh should be between 0 "
+                "and %d. Using default value: %d",
+                MAX_MAP_CACHE_REFRESH, DEFAULT_MAP_CACHE_REFRESH);
+    }
+
+    ret = cfg_getint(cfg, "map-cache-max-entries");
+    if (ret >= 0 && ret <= MAX_MAP_CACHE_MAX_ENTRIES){
+        map_cache_max_entries = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-cache-max-entries should be between 0 "
+                "and %d. Using default value: %d",
+                MAX_MAP_CACHE_MAX_ENTRIES, DEFAULT_MAP_CACHE_MAX_ENTRIES);
+    }
+
+    ret = cfg_getint(cfg, "map-cache-max-memory");
+    if (ret >= 0 && ret <= MAX_MAP_CACHE_MAX_MEMORY){
+        map_cache_max_memory = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-cache-max-memory should be between 0 "
+                "and %d. Using default value: %d",
+                MAX_MAP_CACHE_MAX_MEMORY, DEFAULT_MAP_CACHE_MAX_MEMORY);
+    }
+
+    /* Spread of the Map-Register rounds */
+    ret = cfg_getint(cfg, "map-register-jitter");
+    if (ret >= 0 && ret <= MAX_MAP_REGISTER_JITTER){
+        map_register_jitter = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-register-jitter should be between 0 "
+                "and %d. Using default value: %d",
+                MAX_MAP_REGISTER_JITTER, DEFAULT_MAP_REGISTER_JITTER);
+    }
+
+    /* Threads serving control messages of the Map-Server */
+    ret = cfg_getint(cfg, "map-server-threads");
+    if (ret >= 0 && ret <= MAX_MAP_SERVER_THREADS){
+        map_server_threads = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-server-threads should be between 0 "
+                "and %d. Using default value: 0",MAX_MAP_SERVER_THREADS);
+    }
+
+    /* Map-Requests accepted per second from each source */
+    ret = cfg_getint(cfg, "map-request-rate-limit");
+    if (ret >= 0 && ret <= MAX_MAP_REQUEST_RATE_LIMIT){
+        map_request_rate_limit = ret;
+    }else{
+        LMLOG(LWRN, "Configuration file: map-request-rate-limit should be between 0 "
+                "and %d. Using default value: 0",MAX_MAP_REQUEST_RATE_LIMIT);
+    }
+
     mode = cfg_getstr(cfg, "operating-mode");
     if (mode) {
         if (strcmp(mode, "xTR") == 0) {
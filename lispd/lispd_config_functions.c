@@ -244,6 +244,51 @@ validate_priority_weight(int p, int w)
     return (GOOD);
 }
 
+static int
+parse_udp_cksum_mode(char *str, int *mode)
+{
+    if (strcmp(str, "zero") == 0) {
+        *mode = UDP_CKSUM_ZERO;
+    } else if (strcmp(str, "full") == 0) {
+        *mode = UDP_CKSUM_FULL;
+    } else {
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+/*
+ *  UDP checksum of the encapsulated data packets of each AFI. NULL keeps
+ *  the default
+ */
+void
+set_data_udp_cksum(char *ipv4_mode, char *ipv6_mode)
+{
+    if (ipv4_mode && parse_udp_cksum_mode(ipv4_mode,
+            &data_udp_cksum_ipv4) != GOOD) {
+        LMLOG(LWRN, "Configuration file: Unknown UDP checksum mode %s for "
+                "IPv4. Using default value", ipv4_mode);
+    }
+    if (ipv6_mode && parse_udp_cksum_mode(ipv6_mode,
+            &data_udp_cksum_ipv6) != GOOD) {
+        LMLOG(LWRN, "Configuration file: Unknown UDP checksum mode %s for "
+                "IPv6. Using default value", ipv6_mode);
+    }
+}
+
+void
+set_data_src_ports(int min, int max)
+{
+    if (min < 1 || max > 65535 || min > max) {
+        LMLOG(LWRN, "Configuration file: The data source port range %d-%d "
+                "is not valid. Using default values: %d-%d", min, max,
+                DEFAULT_DATA_SRC_PORT_MIN, DEFAULT_DATA_SRC_PORT_MAX);
+        return;
+    }
+    data_src_port_min = min;
+    data_src_port_max = max;
+}
+
 /*
  *  add a map-resolver to the list
  */
@@ -300,8 +345,9 @@ add_map_server(glist_t *ms_list, char *str_addr, int key_type, char *key,
         exit_cleanup();
     }
 
-    if (key_type != HMAC_SHA_1_96){
-        LMLOG(LERR, "Configuraton file: Only SHA-1 (1) authentication is supported");
+    if (key_type != HMAC_SHA_1_96 && key_type != HMAC_SHA_256_128){
+        LMLOG(LERR, "Configuraton file: Only SHA-1 (1) and SHA-256 (2) "
+                "authentication are supported");
         exit_cleanup();
     }
 
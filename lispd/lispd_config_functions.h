@@ -112,6 +112,12 @@ validate_rloc_probing_parameters(int *interval,int *retries,int *retries_int);
 int
 validate_priority_weight(int p, int w);
 
+void
+set_data_udp_cksum(char *ipv4_mode, char *ipv6_mode);
+
+void
+set_data_src_ports(int min, int max);
+
 int
 add_server(char *str_addr, glist_t *list);
 
@@ -98,6 +98,20 @@ handle_config_file(char **uci_conf_file_path)
     struct uci_section *sect;
     struct uci_element *element;
     int uci_debug;
+    int uci_batch_size;
+    int uci_threads;
+    int uci_flow_table_size;
+    int uci_mreg_jitter;
+    int uci_ms_threads;
+    int uci_mreq_rate;
+    int uci_sport_min;
+    int uci_sport_max;
+    int uci_pending_pkts;
+    int uci_pending_mem;
+    int uci_mreq_window;
+    int uci_mc_refresh;
+    int uci_mc_max_entries;
+    int uci_mc_max_memory;
     char *uci_log_file;
     char *uci_op_mode;
     int res = BAD;
@@ -158,6 +172,149 @@ handle_config_file(char **uci_conf_file_path)
                 open_log_file(uci_log_file);
             }
 
+            if (uci_lookup_option_string(ctx, sect, "data_batch_size") != NULL){
+                uci_batch_size = strtol(uci_lookup_option_string(ctx, sect, "data_batch_size"),NULL,10);
+                if (uci_batch_size >= 1 && uci_batch_size <= MAX_DATA_BATCH_SIZE){
+                    data_batch_size = uci_batch_size;
+                }else{
+                    LMLOG(LWRN, "Configuration file: data_batch_size should be between 1 "
+                            "and %d. Using default value: %d",MAX_DATA_BATCH_SIZE,
+                            DEFAULT_DATA_BATCH_SIZE);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "data_plane_threads") != NULL){
+                uci_threads = strtol(uci_lookup_option_string(ctx, sect, "data_plane_threads"),NULL,10);
+                if (uci_threads >= 0 && uci_threads <= MAX_DATA_PLANE_THREADS){
+                    data_plane_threads = uci_threads;
+                }else{
+                    LMLOG(LWRN, "Configuration file: data_plane_threads should be between 0 "
+                            "and %d. Using default value: 0",MAX_DATA_PLANE_THREADS);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "flow_table_size") != NULL){
+                uci_flow_table_size = strtol(uci_lookup_option_string(ctx, sect, "flow_table_size"),NULL,10);
+                if (uci_flow_table_size >= 1 && uci_flow_table_size <= MAX_FLOW_TABLE_SIZE){
+                    flow_table_size = uci_flow_table_size;
+                }else{
+                    LMLOG(LWRN, "Configuration file: flow_table_size should be between 1 "
+                            "and %d. Using default value: %d",
+                            MAX_FLOW_TABLE_SIZE, DEFAULT_FLOW_TABLE_SIZE);
+                }
+            }
+
+            set_data_udp_cksum(
+                    (char *)uci_lookup_option_string(ctx, sect, "udp_checksum_ipv4"),
+                    (char *)uci_lookup_option_string(ctx, sect, "udp_checksum_ipv6"));
+
+            uci_sport_min = data_src_port_min;
+            uci_sport_max = data_src_port_max;
+            if (uci_lookup_option_string(ctx, sect, "data_src_port_min") != NULL){
+                uci_sport_min = strtol(uci_lookup_option_string(ctx, sect, "data_src_port_min"),NULL,10);
+            }
+            if (uci_lookup_option_string(ctx, sect, "data_src_port_max") != NULL){
+                uci_sport_max = strtol(uci_lookup_option_string(ctx, sect, "data_src_port_max"),NULL,10);
+            }
+            set_data_src_ports(uci_sport_min, uci_sport_max);
+
+            if (uci_lookup_option_string(ctx, sect, "pending_packets_per_eid") != NULL){
+                uci_pending_pkts = strtol(uci_lookup_option_string(ctx, sect, "pending_packets_per_eid"),NULL,10);
+                if (uci_pending_pkts >= 0 && uci_pending_pkts <= MAX_PENDING_PACKETS_PER_EID){
+                    pending_packets_per_eid = uci_pending_pkts;
+                }else{
+                    LMLOG(LWRN, "Configuration file: pending_packets_per_eid should be between 0 "
+                            "and %d. Using default value: %d",
+                            MAX_PENDING_PACKETS_PER_EID, DEFAULT_PENDING_PACKETS_PER_EID);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "pending_packets_memory") != NULL){
+                uci_pending_mem = strtol(uci_lookup_option_string(ctx, sect, "pending_packets_memory"),NULL,10);
+                if (uci_pending_mem >= 1 && uci_pending_mem <= MAX_PENDING_PACKETS_MEMORY){
+                    pending_packets_memory = uci_pending_mem;
+                }else{
+                    LMLOG(LWRN, "Configuration file: pending_packets_memory should be between 1 "
+                            "and %d. Using default value: %d",
+                            MAX_PENDING_PACKETS_MEMORY, DEFAULT_PENDING_PACKETS_MEMORY);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_request_window") != NULL){
+                uci_mreq_window = strtol(uci_lookup_option_string(ctx, sect, "map_request_window"),NULL,10);
+                if (uci_mreq_window >= 0 && uci_mreq_window <= MAX_MAP_REQUEST_WINDOW){
+                    map_request_window = uci_mreq_window;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_request_window should be between 0 "
+                            "and %d. Using default value: %d",
+                            MAX_MAP_REQUEST_WINDOW, DEFAULT_MAP_REQUEST_WINDOW);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_cache_refresh") != NULL){
+                uci_mc_refresh = strtol(uci_lookup_option_string(ctx, sect, "map_cache_refresh"),NULL,10);
+                if (uci_mc_refresh >= 0 && uci_mc_refresh <= MAX_MAP_CACHE_REFRESH){
+                    map_cache_refresh = uci_mc_refresh;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_cache_refresh should be between 0 "
+                            "and %d. Using default value: %d",
+                            MAX_MAP_CACHE_REFRESH, DEFAULT_MAP_CACHE_REFRESH);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_cache_max_entries") != NULL){
+                uci_mc_max_entries = strtol(uci_lookup_option_string(ctx, sect, "map_cache_max_entries"),NULL,10);
+                if (uci_mc_max_entries >= 0 && uci_mc_max_entries <= MAX_MAP_CACHE_MAX_ENTRIES){
+                    map_cache_max_entries = uci_mc_max_entries;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_cache_max_entries should be between 0 "
+                            "and %d. Using default value: %d",
+                            MAX_MAP_CACHE_MAX_ENTRIES, DEFAULT_MAP_CACHE_MAX_ENTRIES);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_cache_max_memory") != NULL){
+                uci_mc_max_memory = strtol(uci_lookup_option_string(ctx, sect, "map_cache_max_memory"),NULL,10);
+                if (uci_mc_max_memory >= 0 && uci_mc_max_memory <= MAX_MAP_CACHE_MAX_MEMORY){
+                    map_cache_max_memory = uci_mc_max_memory;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_cache_max_memory should be between 0 "
+                            "and %d. Using default value: %d",
+                            MAX_MAP_CACHE_MAX_MEMORY, DEFAULT_MAP_CACHE_MAX_MEMORY);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_register_jitter") != NULL){
+                uci_mreg_jitter = strtol(uci_lookup_option_string(ctx, sect, "map_register_jitter"),NULL,10);
+                if (uci_mreg_jitter >= 0 && uci_mreg_jitter <= MAX_MAP_REGISTER_JITTER){
+                    map_register_jitter = uci_mreg_jitter;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_register_jitter should be between 0 "
+                            "and %d. Using default value: %d",
+                            MAX_MAP_REGISTER_JITTER, DEFAULT_MAP_REGISTER_JITTER);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_server_threads") != NULL){
+                uci_ms_threads = strtol(uci_lookup_option_string(ctx, sect, "map_server_threads"),NULL,10);
+                if (uci_ms_threads >= 0 && uci_ms_threads <= MAX_MAP_SERVER_THREADS){
+                    map_server_threads = uci_ms_threads;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_server_threads should be between 0 "
+                            "and %d. Using default value: 0",MAX_MAP_SERVER_THREADS);
+                }
+            }
+
+            if (uci_lookup_option_string(ctx, sect, "map_request_rate_limit") != NULL){
+                uci_mreq_rate = strtol(uci_lookup_option_string(ctx, sect, "map_request_rate_limit"),NULL,10);
+                if (uci_mreq_rate >= 0 && uci_mreq_rate <= MAX_MAP_REQUEST_RATE_LIMIT){
+                    map_request_rate_limit = uci_mreq_rate;
+                }else{
+                    LMLOG(LWRN, "Configuration file: map_request_rate_limit should be between 0 "
+                            "and %d. Using default value: 0",MAX_MAP_REQUEST_RATE_LIMIT);
+                }
+            }
+
             uci_op_mode = (char *)uci_lookup_option_string(ctx, sect, "operating_mode");
 
             if (uci_op_mode != NULL) {
@@ -24,6 +24,22 @@
 
 extern char *config_file;
 extern int daemonize;
+extern int data_batch_size;
+extern int data_plane_threads;
+extern int flow_table_size;
+extern int data_udp_cksum_ipv4;
+extern int data_udp_cksum_ipv6;
+extern int data_src_port_min;
+extern int data_src_port_max;
+extern int pending_packets_per_eid;
+extern int pending_packets_memory;
+extern int map_request_window;
+extern int map_cache_refresh;
+extern int map_cache_max_entries;
+extern int map_cache_max_memory;
+extern int map_register_jitter;
+extern int map_server_threads;
+extern int map_request_rate_limit;
 extern int default_rloc_afi;
 extern int netlink_fd;
 extern int nat_aware;
@@ -0,0 +1,107 @@
+/*
+ * Throughput benchmark of the one's complement sum of lib/cksum.c. Compares
+ * the former 16 bit loop of udp_ipv4_checksum, which folded the carries
+ * inside the loop, with each variant of cksum_partial supported by the CPU,
+ * over buffers of 64 to 9000 bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lispd/lib/cksum.c"
+
+#define TOTAL_BYTES (1 << 30)
+#define NIMPLS      (int)(sizeof(cksum_impls) / sizeof(cksum_impls[0]))
+
+int debug_level = 0;
+
+void
+llog(int lisp_log_level, const char *format, ...)
+{
+}
+
+/* Former implementation */
+static uint64_t
+sum_legacy(const uint8_t *b, int len, uint64_t acc)
+{
+    const uint16_t *buf = (const uint16_t *)b;
+    uint32_t sum = acc;
+
+    while (len > 1) {
+        sum += *buf++;
+        if (sum & 0x80000000)
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        len -= 2;
+    }
+    if (len & 1)
+        sum += *((uint8_t *) buf);
+    return (sum);
+}
+
+static double
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+/* ns per buffer */
+static double
+run(cksum_sum_fn fn, const uint8_t *buf, int len, uint16_t *res)
+{
+    volatile uint64_t sink = 0;
+    double start;
+    int i, n = TOTAL_BYTES / len;
+
+    start = now_ns();
+    for (i = 0; i < n; i++) {
+        sink += fn(buf, len, 0);
+    }
+    *res = cksum_fold(cksum_fold64(fn(buf, len, 0)));
+    return ((now_ns() - start) / n);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t buf[9000];
+    int lens[] = {64, 128, 256, 512, 1500, 4096, 9000};
+    uint16_t ref, res;
+    double t;
+    int i, l, ret = 0;
+
+    srandom(argc > 1 ? atoi(argv[1]) : 2013);
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = random();
+    }
+
+    printf("%6s %10s", "bytes", "legacy");
+    for (i = 0; i < NIMPLS; i++) {
+        if (!cksum_impls[i].supported || cksum_impls[i].supported()) {
+            printf(" %10s", cksum_impls[i].name);
+        }
+    }
+    printf("   (ns/buffer)\n");
+
+    for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        t = run(sum_legacy, buf, lens[l], &ref);
+        printf("%6d %10.1f", lens[l], t);
+        for (i = 0; i < NIMPLS; i++) {
+            if (cksum_impls[i].supported && !cksum_impls[i].supported()) {
+                continue;
+            }
+            t = run(cksum_impls[i].sum, buf, lens[l], &res);
+            printf(" %10.1f", t);
+            if (res != ref) {
+                printf("\n%s: wrong checksum\n", cksum_impls[i].name);
+                ret = 1;
+            }
+        }
+        printf("\n");
+    }
+
+    return (ret);
+}
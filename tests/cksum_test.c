@@ -0,0 +1,195 @@
+/*
+ * Property test of lib/cksum.c. Every variant of the one's complement sum
+ * supported by the CPU is checked against a plain 16 bit reference over
+ * random buffers, lengths, alignments and initial sums, the UDP checksums
+ * against the reference with their pseudo-headers, and the incremental
+ * update against a full recomputation after random TTL and TOS rewrites.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lispd/lib/cksum.c"
+
+#define MAX_LEN     9000
+#define ROUNDS      200000
+#define NIMPLS      (int)(sizeof(cksum_impls) / sizeof(cksum_impls[0]))
+
+int debug_level = 0;
+
+static int errors = 0;
+
+void
+llog(int lisp_log_level, const char *format, ...)
+{
+}
+
+/* RFC 1071, 16 bits at a time */
+static uint64_t
+ref_sum(const uint8_t *buf, int len, uint64_t acc)
+{
+    uint16_t w;
+
+    while (len > 1) {
+        memcpy(&w, buf, 2);
+        acc += w;
+        buf += 2;
+        len -= 2;
+    }
+    if (len) {
+        acc += htons(*buf << 8);
+    }
+    return (acc);
+}
+
+static uint16_t
+ref_fold(uint64_t acc)
+{
+    while (acc >> 16) {
+        acc = (acc & 0xffff) + (acc >> 16);
+    }
+    return ((uint16_t)~acc);
+}
+
+static void
+check(const char *what, uint16_t val, uint16_t ref, int len, int off)
+{
+    if (val != ref) {
+        printf("%s: len %d offset %d: %04x != %04x\n", what, len, off, val,
+                ref);
+        errors++;
+    }
+}
+
+static void
+check_sums(uint8_t *buf, int len, int off, uint32_t init)
+{
+    uint16_t ref = ref_fold(ref_sum(buf + off, len, init));
+    uint32_t sum;
+    int i;
+
+    sum = cksum_partial(buf + off, len, init);
+    if (sum > 0xffff) {
+        printf("cksum_partial: len %d offset %d: %x not folded\n", len, off,
+                sum);
+        errors++;
+    }
+    check("cksum_partial", cksum_fold(sum), ref, len, off);
+    for (i = 0; i < NIMPLS; i++) {
+        if (cksum_impls[i].supported && !cksum_impls[i].supported()) {
+            continue;
+        }
+        check(cksum_impls[i].name, cksum_fold(cksum_fold64(
+                cksum_impls[i].sum(buf + off, len, init))), ref, len, off);
+    }
+    if (init == 0) {
+        check("ip_checksum", ip_checksum((uint16_t *)(buf + off), len), ref,
+                len, off);
+    }
+}
+
+static void
+check_udp(uint8_t *buf, int len, int off)
+{
+    struct ip6_hdr ip6h;
+    in_addr_t src, dst;
+    uint8_t ph[40];
+    uint32_t ph_len;
+    uint16_t ref;
+    int i;
+
+    /* IPv4 pseudo-header: addresses, zero, protocol and UDP length */
+    src = random();
+    dst = random();
+    memcpy(ph, &src, 4);
+    memcpy(ph + 4, &dst, 4);
+    ph[8] = 0;
+    ph[9] = IPPROTO_UDP;
+    ph[10] = len >> 8;
+    ph[11] = len;
+    ref = ref_fold(ref_sum(buf + off, len, ref_sum(ph, 12, 0)));
+    check("udp_ipv4_checksum", udp_ipv4_checksum(buf + off, len, src, dst),
+            ref, len, off);
+
+    /* IPv6 pseudo-header: addresses, 32 bit length, zeros and next header */
+    memset(&ip6h, 0, sizeof(ip6h));
+    memset(ph, 0, sizeof(ph));
+    for (i = 0; i < 32; i++) {
+        ph[i] = random();
+    }
+    memcpy(&ip6h.ip6_src, ph, 16);
+    memcpy(&ip6h.ip6_dst, ph + 16, 16);
+    ph_len = htonl(len);
+    memcpy(ph + 32, &ph_len, 4);
+    ph[39] = IPPROTO_UDP;
+    ref = ref_fold(ref_sum(buf + off, len, ref_sum(ph, 40, 0)));
+    check("udp_ipv6_checksum", udp_ipv6_checksum(&ip6h,
+            (struct udphdr *)(buf + off), len), ref, len, off);
+}
+
+/* TTL and TOS rewrite of ip_hdr_set_ttl_and_tos */
+static void
+check_update(int i)
+{
+    uint8_t hdr[60];
+    struct ip *iph = (struct ip *)hdr;
+    uint16_t *w = (uint16_t *)hdr;
+    uint16_t old_w0, old_w4, cksum;
+    int j, len;
+
+    len = 20 + 4 * (random() % 11);
+    for (j = 0; j < len; j++) {
+        hdr[j] = (i % 5 == 0) ? 0xff : random();
+    }
+    iph->ip_hl = len / 4;
+    iph->ip_sum = 0;
+    iph->ip_sum = ref_fold(ref_sum(hdr, len, 0));
+
+    old_w0 = w[0];
+    old_w4 = w[4];
+    iph->ip_ttl = (i % 7 == 0) ? 0 : random();
+    iph->ip_tos = (i % 11 == 0) ? 0xff : random();
+    cksum = cksum_update16(iph->ip_sum, old_w0, w[0]);
+    cksum = cksum_update16(cksum, old_w4, w[4]);
+
+    iph->ip_sum = 0;
+    check("cksum_update16", cksum, ref_fold(ref_sum(hdr, len, 0)), len, 0);
+    /* What the receiver verifies */
+    iph->ip_sum = cksum;
+    check("cksum_update16 verify", ref_fold(ref_sum(hdr, len, 0)), 0, len, 0);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t buf[MAX_LEN + 64];
+    int i, j, len, off;
+
+    srandom(argc > 1 ? atoi(argv[1]) : 2013);
+
+    printf("Variants:");
+    for (i = 0; i < NIMPLS; i++) {
+        if (!cksum_impls[i].supported || cksum_impls[i].supported()) {
+            printf(" %s", cksum_impls[i].name);
+        }
+    }
+    printf("\n");
+
+    for (i = 0; i < ROUNDS && errors <= 10; i++) {
+        /* Short lengths are the most common in the headers */
+        len = (i % 4 == 0) ? random() % (MAX_LEN + 1) : random() % 128;
+        off = random() % 32;
+        /* Mostly random data, sometimes all ones to stress the carries */
+        for (j = 0; j < len; j++) {
+            buf[off + j] = (i % 5 == 0) ? 0xff : random();
+        }
+
+        check_sums(buf, len, off, (i % 3 == 0) ? 0 : random());
+        check_sums(buf, len, off, 0xffffffff);
+        check_udp(buf, len, off);
+        check_update(i);
+    }
+
+    printf("%s: %d rounds, %d errors\n", errors ? "FAIL" : "OK", i, errors);
+    return (errors != 0);
+}
@@ -0,0 +1,187 @@
+/*
+ * Microbenchmark of the LISP data encapsulation of the tun data plane, linked
+ * with liblisp and lib/packets.c. Compares lisp_data_encap, which pushes the
+ * outer IP and UDP headers of each packet field by field, with
+ * lisp_data_encap_tpl and the header template of the flow built once, with
+ * the UDP checksum computed or set to zero. Both must produce the same
+ * packets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lispd/liblisp/liblisp.h"
+#include "../lispd/lib/cksum.h"
+#include "../lispd/lib/packets.h"
+
+#define NPACKETS    1000000
+#define HEADROOM    128
+#define LISP_PORT   4341
+
+int debug_level = 0;
+int data_udp_cksum_ipv4;
+int data_udp_cksum_ipv6;
+int data_src_port_min = DEFAULT_DATA_SRC_PORT_MIN;
+int data_src_port_max = DEFAULT_DATA_SRC_PORT_MAX;
+
+/* IP ID counter of lib/packets.c */
+extern uint16_t ip_id;
+
+void
+llog(int lisp_log_level, const char *format, ...)
+{
+}
+
+static double
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void
+set_udp_cksum(int udp_cksum)
+{
+    data_udp_cksum_ipv4 = udp_cksum;
+    data_udp_cksum_ipv6 = udp_cksum;
+}
+
+/* Encapsulates 'saved' with lisp_data_encap and with 'tpl' and compares the
+ * packets, IP ID included */
+static int
+check_same(lbuf_t *saved, pkt_hdr_tpl_t *tpl, lisp_addr_t *la,
+        lisp_addr_t *ra)
+{
+    lbuf_t *ref, b1, b2 = *saved;
+    int ret = GOOD;
+
+    /* In a copy, both would write the same headroom */
+    ref = lbuf_clone_packet(saved, HEADROOM);
+    b1 = *ref;
+    ip_id = 0;
+    lisp_data_encap(&b1, LISP_PORT, LISP_PORT, la, ra);
+    ip_id = 0;
+    lisp_data_encap_tpl(&b2, tpl);
+    if (lbuf_size(&b1) != lbuf_size(&b2)
+            || memcmp(lbuf_data(&b1), lbuf_data(&b2), lbuf_size(&b1)) != 0) {
+        ret = BAD;
+    }
+    lbuf_del(ref);
+    return (ret);
+}
+
+static double
+run_encap(lbuf_t *saved, lisp_addr_t *la, lisp_addr_t *ra)
+{
+    lbuf_t b;
+    double start;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < NPACKETS; i++) {
+        b = *saved;
+        lisp_data_encap(&b, LISP_PORT, LISP_PORT, la, ra);
+    }
+    return ((now_ns() - start) / NPACKETS);
+}
+
+static double
+run_encap_tpl(lbuf_t *saved, pkt_hdr_tpl_t *tpl)
+{
+    lbuf_t b;
+    double start;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < NPACKETS; i++) {
+        b = *saved;
+        lisp_data_encap_tpl(&b, tpl);
+    }
+    return ((now_ns() - start) / NPACKETS);
+}
+
+static void
+fill_inner(lbuf_t *b, int afi, int len)
+{
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    uint8_t *data;
+    int i;
+
+    data = lbuf_put_uninit(b, len);
+    for (i = 0; i < len; i++) {
+        data[i] = random();
+    }
+    if (afi == AF_INET) {
+        iph = (struct ip *)data;
+        iph->ip_v = 4;
+        iph->ip_hl = 5;
+    } else {
+        ip6h = (struct ip6_hdr *)data;
+        ip6h->ip6_vfc = (6 << 4) | (ip6h->ip6_vfc & 0x0f);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    lbuf_t *inner, saved;
+    pkt_hdr_tpl_t tpl, tpl_zero;
+    lisp_addr_t la, ra;
+    uint8_t src[16], dst[16];
+    int afis[2] = {AF_INET, AF_INET6};
+    int lens[3] = {64, 512, 1400};
+    double t_encap, t_encap_zero, t_tpl, t_tpl_zero;
+    int a, l, i, ret = 0;
+
+    srandom(argc > 1 ? atoi(argv[1]) : 2013);
+    for (i = 0; i < 16; i++) {
+        src[i] = random();
+        dst[i] = random();
+    }
+
+    for (a = 0; a < 2; a++) {
+        lisp_addr_set_lafi(&la, LM_AFI_IP);
+        lisp_addr_set_lafi(&ra, LM_AFI_IP);
+        lisp_addr_ip_init(&la, src, afis[a]);
+        lisp_addr_ip_init(&ra, dst, afis[a]);
+        set_udp_cksum(UDP_CKSUM_FULL);
+        lisp_data_encap_tpl_init(&tpl, LISP_PORT, LISP_PORT, &la, &ra);
+        set_udp_cksum(UDP_CKSUM_ZERO);
+        lisp_data_encap_tpl_init(&tpl_zero, LISP_PORT, LISP_PORT, &la, &ra);
+
+        for (l = 0; l < 3; l++) {
+            inner = lbuf_new_with_headroom(lens[l], HEADROOM);
+            fill_inner(inner, afis[a], lens[l]);
+            /* The encapsulation only writes in the headroom */
+            saved = *inner;
+
+            set_udp_cksum(UDP_CKSUM_FULL);
+            if (check_same(&saved, &tpl, &la, &ra) != GOOD) {
+                printf("Encapsulated packets differ\n");
+                ret = 1;
+            }
+            t_encap = run_encap(&saved, &la, &ra);
+            t_tpl = run_encap_tpl(&saved, &tpl);
+
+            set_udp_cksum(UDP_CKSUM_ZERO);
+            if (check_same(&saved, &tpl_zero, &la, &ra) != GOOD) {
+                printf("Encapsulated packets with zero checksum differ\n");
+                ret = 1;
+            }
+            t_encap_zero = run_encap(&saved, &la, &ra);
+            t_tpl_zero = run_encap_tpl(&saved, &tpl_zero);
+
+            printf("%s %4d bytes: lisp_data_encap %.1f, template %.1f; with "
+                    "zero UDP checksum %.1f, %.1f ns/packet\n",
+                    afis[a] == AF_INET ? "IPv4" : "IPv6", lens[l], t_encap,
+                    t_tpl, t_encap_zero, t_tpl_zero);
+            lbuf_del(inner);
+        }
+    }
+
+    return (ret);
+}
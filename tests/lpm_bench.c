@@ -0,0 +1,221 @@
+/*
+ * Benchmark of the longest prefix match lookups of the mapping databases
+ * over 1M prefixes of each family. Compares the former path, that built a
+ * prefix_t on the heap for each lookup and searched the patricia trie, with
+ * the compressed multibit trie of lib/lpm.c. Both have to return the same
+ * entries, also after removing half of the prefixes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lispd/defs.h"
+#include "../lispd/elibs/patricia/patricia.h"
+#include "../lispd/lib/lpm.h"
+
+#define NPREFS      1000000
+#define NLOOKUPS    1000000
+
+int debug_level = 0;
+
+void
+llog(int lisp_log_level, const char *format, ...)
+{
+}
+
+void *
+xzalloc(size_t size)
+{
+    return (calloc(1, size));
+}
+
+void *
+xmalloc(size_t size)
+{
+    return (malloc(size));
+}
+
+void *
+xcalloc(size_t count, size_t size)
+{
+    return (calloc(count, size));
+}
+
+void *
+xrealloc(void *p, size_t size)
+{
+    return (realloc(p, size));
+}
+
+static double
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void
+random_bytes(uint8_t *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = random();
+    }
+}
+
+/* Lengths close to those of the Internet routing tables */
+static int
+random_plen(int afi)
+{
+    int r = random() % 100;
+
+    if (afi == AF_INET) {
+        if (r < 60) {
+            return (24);
+        } else if (r < 75) {
+            return (22 + random() % 2);
+        } else if (r < 95) {
+            return (16 + random() % 6);
+        } else {
+            return (8 + random() % 8);
+        }
+    } else {
+        if (r < 50) {
+            return (48);
+        } else if (r < 80) {
+            return (32 + random() % 16);
+        } else if (r < 95) {
+            return (49 + random() % 16);
+        } else {
+            return (20 + random() % 12);
+        }
+    }
+}
+
+/* Former lookup of the mapping databases */
+static void *
+pt_lookup(patricia_tree_t *pt, int afi, uint8_t *addr, int maxbits)
+{
+    patricia_node_t *node;
+    prefix_t *prefix;
+
+    prefix = New_Prefix(afi, addr, maxbits);
+    node = patricia_search_best(pt, prefix);
+    Deref_Prefix(prefix);
+    return (node ? node->data : NULL);
+}
+
+static int
+bench_afi(int afi)
+{
+    int maxbits = afi == AF_INET ? 32 : 128;
+    int len = maxbits / 8;
+    patricia_tree_t *pt;
+    patricia_node_t *node;
+    prefix_t *prefix;
+    lpm_t *lpm;
+    uint8_t *prefs, *addrs;
+    int *plens;
+    double start, t_pt, t_lpm;
+    void *r;
+    int i, j, n = 0, errors = 0;
+
+    pt = New_Patricia(maxbits);
+    lpm = lpm_new(maxbits);
+    prefs = malloc(NPREFS * len);
+    plens = malloc(NPREFS * sizeof(int));
+    addrs = malloc(NLOOKUPS * len);
+
+    for (i = 0; i < NPREFS; i++) {
+        plens[n] = random_plen(afi);
+        random_bytes(prefs + n * len, len);
+        prefix = New_Prefix(afi, prefs + n * len, plens[n]);
+        node = patricia_lookup(pt, prefix);
+        Deref_Prefix(prefix);
+        if (node->data) {
+            continue;
+        }
+        node->data = node;
+        lpm_add(lpm, prefs + n * len, plens[n], node);
+        n++;
+    }
+
+    /* Half of the addresses inside the prefixes, half anywhere */
+    for (i = 0; i < NLOOKUPS; i++) {
+        random_bytes(addrs + i * len, len);
+        if (i % 2 == 0) {
+            j = random() % n;
+            memcpy(addrs + i * len, prefs + j * len, plens[j] / 8);
+        }
+    }
+
+    start = now_ns();
+    for (i = 0; i < NLOOKUPS; i++) {
+        r = pt_lookup(pt, afi, addrs + i * len, maxbits);
+        /* Keep the loop from being optimized out */
+        errors += r == (void *)1;
+    }
+    t_pt = (now_ns() - start) / 1e9;
+
+    start = now_ns();
+    for (i = 0; i < NLOOKUPS; i++) {
+        r = lpm_lookup(lpm, addrs + i * len);
+        errors += r == (void *)1;
+    }
+    t_lpm = (now_ns() - start) / 1e9;
+
+    for (i = 0; i < NLOOKUPS; i++) {
+        if (pt_lookup(pt, afi, addrs + i * len, maxbits)
+                != lpm_lookup(lpm, addrs + i * len)) {
+            errors++;
+        }
+    }
+
+    printf("IPv%d %d prefixes (%d trie nodes): %.1f Mlookups/s with patricia, "
+            "%.1f with lpm\n", afi == AF_INET ? 4 : 6, n, lpm->n_nodes,
+            NLOOKUPS / t_pt / 1e6, NLOOKUPS / t_lpm / 1e6);
+
+    /* Remove half of the prefixes and check again */
+    for (i = 0; i < n; i += 2) {
+        prefix = New_Prefix(afi, prefs + i * len, plens[i]);
+        node = patricia_search_exact(pt, prefix);
+        Deref_Prefix(prefix);
+        if (lpm_remove(lpm, prefs + i * len, plens[i]) != node) {
+            errors++;
+        }
+        patricia_remove(pt, node);
+    }
+    for (i = 0; i < NLOOKUPS; i++) {
+        r = pt_lookup(pt, afi, addrs + i * len, maxbits);
+        if (r != lpm_lookup(lpm, addrs + i * len)) {
+            errors++;
+        }
+    }
+
+    Destroy_Patricia(pt, NULL);
+    lpm_del(lpm);
+    free(prefs);
+    free(plens);
+    free(addrs);
+    return (errors);
+}
+
+int main(int argc, char **argv)
+{
+    int errors = 0;
+
+    srandom(argc > 1 ? atoi(argv[1]) : 2013);
+
+    errors += bench_afi(AF_INET);
+    errors += bench_afi(AF_INET6);
+
+    if (errors) {
+        printf("%d errors\n", errors);
+    }
+    return (errors != 0);
+}
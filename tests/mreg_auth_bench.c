@@ -0,0 +1,188 @@
+/*
+ * Benchmark of the authentication work of a Map-Server per registration:
+ * check the auth data of the Map-Register and fill the one of the
+ * Map-Notify. Compares the former path, which called mbedtls_md_hmac with the
+ * key in clear for every message and copied the received auth data to the
+ * heap, with the precomputed keys of lib/hmac.c. Both have to produce the
+ * same auth data for random keys and messages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lispd/defs.h"
+#include "../lispd/elibs/mbedtls/md.h"
+#include "../lispd/lib/hmac.h"
+#include "../lispd/liblisp/lisp_message_fields.h"
+
+#define NREGS       200000
+#define MAX_LEN     1400
+#define AUTH_OFF    16      /* Auth data after the header and auth record header */
+
+int debug_level = 0;
+
+void
+llog(int lisp_log_level, const char *format, ...)
+{
+}
+
+void *
+xzalloc(size_t size)
+{
+    return (calloc(1, size));
+}
+
+void *
+xmalloc(size_t size)
+{
+    return (malloc(size));
+}
+
+/* Former implementation */
+static int
+old_complete(uint8_t key_id, const char *key, void *packet, size_t len,
+        void *auth_data_pos)
+{
+    const mbedtls_md_info_t *md_info;
+    size_t auth_data_len = hmac_auth_data_len(key_id);
+
+    md_info = mbedtls_md_info_from_type(key_id == HMAC_SHA_1_96
+            ? MBEDTLS_MD_SHA1 : MBEDTLS_MD_SHA256);
+    memset(auth_data_pos, 0, auth_data_len);
+    if (mbedtls_md_hmac(md_info, (const unsigned char *)key, strlen(key),
+            packet, len, auth_data_pos) != 0) {
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+static int
+old_check(uint8_t key_id, const char *key, void *packet, size_t len,
+        void *auth_data_pos)
+{
+    size_t auth_data_len = hmac_auth_data_len(key_id);
+    uint8_t *copy;
+    int ret;
+
+    copy = xmalloc(auth_data_len);
+    memcpy(copy, auth_data_pos, auth_data_len);
+    old_complete(key_id, key, packet, len, auth_data_pos);
+    ret = memcmp(copy, auth_data_pos, auth_data_len) == 0 ? GOOD : BAD;
+    free(copy);
+    return (ret);
+}
+
+static double
+now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e9 + ts.tv_nsec);
+}
+
+static void
+random_bytes(uint8_t *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = random();
+    }
+}
+
+static int
+check_same(uint8_t key_id)
+{
+    static uint8_t pkt[MAX_LEN];
+    uint8_t auth[SHA256_AUTH_DATA_LEN];
+    char key[160];
+    hmac_key_t hk;
+    int i, j, len, key_len, errors = 0;
+    size_t auth_len = hmac_auth_data_len(key_id);
+
+    for (i = 0; i < 2000; i++) {
+        /* Keys shorter and longer than the block */
+        key_len = 1 + random() % (sizeof(key) - 1);
+        for (j = 0; j < key_len; j++) {
+            key[j] = 'a' + random() % 26;
+        }
+        key[key_len] = '\0';
+        len = AUTH_OFF + auth_len + random() % (MAX_LEN - AUTH_OFF - auth_len);
+        random_bytes(pkt, len);
+
+        hmac_key_init(&hk, key_id, key);
+        old_complete(key_id, key, pkt, len, pkt + AUTH_OFF);
+        memcpy(auth, pkt + AUTH_OFF, auth_len);
+        hmac_key_complete_auth_fields(&hk, pkt, len, pkt + AUTH_OFF);
+        if (memcmp(auth, pkt + AUTH_OFF, auth_len) != 0
+                || hmac_key_check_auth_field(&hk, pkt, len, pkt + AUTH_OFF) != GOOD
+                || memcmp(auth, pkt + AUTH_OFF, auth_len) != 0) {
+            errors++;
+        }
+        pkt[random() % len] ^= 1 << (random() % 8);
+        if (hmac_key_check_auth_field(&hk, pkt, len, pkt + AUTH_OFF) == GOOD) {
+            errors++;
+        }
+    }
+    return (errors);
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t mreg[MAX_LEN], mntf[MAX_LEN];
+    const char *key = "password";
+    uint8_t key_ids[2] = {HMAC_SHA_1_96, HMAC_SHA_256_128};
+    /* One record with two locators and a full Map-Register */
+    int lens[2] = {96, MAX_LEN};
+    hmac_key_t *hk;
+    double start, t_old, t_new;
+    int k, l, i, errors = 0;
+
+    srandom(argc > 1 ? atoi(argv[1]) : 2013);
+
+    for (k = 0; k < 2; k++) {
+        errors += check_same(key_ids[k]);
+        hk = hmac_key_new(key_ids[k], key);
+        for (l = 0; l < 2; l++) {
+            random_bytes(mreg, lens[l]);
+            random_bytes(mntf, lens[l]);
+            complete_auth_fields(key_ids[k], key, mreg, lens[l],
+                    mreg + AUTH_OFF);
+
+            start = now_ns();
+            for (i = 0; i < NREGS; i++) {
+                if (old_check(key_ids[k], key, mreg, lens[l], mreg + AUTH_OFF)
+                        != GOOD) {
+                    errors++;
+                }
+                old_complete(key_ids[k], key, mntf, lens[l], mntf + AUTH_OFF);
+            }
+            t_old = (now_ns() - start) / 1e9;
+
+            start = now_ns();
+            for (i = 0; i < NREGS; i++) {
+                if (hmac_key_check_auth_field(hk, mreg, lens[l],
+                        mreg + AUTH_OFF) != GOOD) {
+                    errors++;
+                }
+                hmac_key_complete_auth_fields(hk, mntf, lens[l],
+                        mntf + AUTH_OFF);
+            }
+            t_new = (now_ns() - start) / 1e9;
+
+            printf("%s %4d bytes: %.0f registrations/s before, %.0f with "
+                    "precomputed keys\n", key_ids[k] == HMAC_SHA_1_96
+                    ? "HMAC-SHA-1-96   " : "HMAC-SHA-256-128", lens[l],
+                    NREGS / t_old, NREGS / t_new);
+        }
+        hmac_key_del(hk);
+    }
+
+    if (errors) {
+        printf("%d errors\n", errors);
+    }
+    return (errors != 0);
+}
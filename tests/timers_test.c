@@ -0,0 +1,160 @@
+/*
+ * Regression test of the timer wheel of lib/timers.c, run against the real
+ * timerfd and monotonic clock. Short timers have to expire on time after
+ * a wakeup with nothing to do, like the one of a timer that was stopped, and
+ * stopping the next timer to expire has to program the timerfd again.
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lispd/lib/timers.c"
+#include "../lispd/lib/obj_pool.c"
+
+/* Tolerance of the expiration of a timer */
+#define SLACK_MS    40
+
+int debug_level = 0;
+sockmstr_t *smaster = NULL;
+
+static int errors = 0;
+static int fired = 0;
+
+void
+llog(int lisp_log_level, const char *format, ...)
+{
+}
+
+void *
+xmalloc(size_t size)
+{
+    return (malloc(size));
+}
+
+void *
+xzalloc(size_t size)
+{
+    return (calloc(1, size));
+}
+
+sock_t *
+sockmstr_register_read_listener(sockmstr_t *m, int (*func)(sock_t *),
+        void *arg, int fd)
+{
+    return (NULL);
+}
+
+static uint64_t
+now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static int
+test_cb(lmtimer_t *t)
+{
+    fired++;
+    lmtimer_stop(t);
+    return (GOOD);
+}
+
+/* Process the wakeups of the timerfd for up to 'ms' milliseconds or until
+ * a timer fires. Returns the milliseconds waited */
+static int
+run_for(int ms)
+{
+    struct pollfd pfd;
+    sock_t sl;
+    uint64_t start = now_ms();
+    int before = fired;
+
+    memset(&sl, 0, sizeof(sl));
+    sl.fd = timers_fd;
+    pfd.fd = timers_fd;
+    pfd.events = POLLIN;
+    while (fired == before && now_ms() - start < (uint64_t)ms) {
+        if (poll(&pfd, 1, 5) > 0) {
+            process_timer_fd(&sl);
+        }
+    }
+    return ((int)(now_ms() - start));
+}
+
+static void
+check(const char *what, int ok)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        errors++;
+    }
+}
+
+static lmtimer_t *
+start_ms(int ms)
+{
+    lmtimer_t *t = lmtimer_create(MAP_REQUEST_RETRY_TIMER);
+
+    lmtimer_init(t, NULL, test_cb, NULL, NULL, NULL);
+    lmtimer_start_ms(t, ms);
+    return (t);
+}
+
+int
+main()
+{
+    struct itimerspec its;
+    lmtimer_t *t;
+    int waited;
+
+    if (lmtimers_init() != GOOD) {
+        return (1);
+    }
+
+    /* Stopping the only timer disarms the timerfd */
+    t = start_ms(20);
+    lmtimer_stop(t);
+    timerfd_gettime(timers_fd, &its);
+    check("timerfd disarmed after stopping the only timer",
+            its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0);
+
+    /* Stale wakeup with an empty level 0, then a short timer */
+    usleep(30 * 1000);
+    timer_wheel.processing = TRUE;
+    handle_timers(wheel_now());
+    timer_wheel.processing = FALSE;
+    check("wheel not ahead of the clock after an empty wakeup",
+            timer_wheel.cur_tick <= wheel_now() + 1);
+    start_ms(20);
+    waited = run_for(3000);
+    check("20 ms timer fired", fired == 1);
+    check("20 ms timer on time after an empty wakeup",
+            waited <= 20 + SLACK_MS);
+
+    /* Stopping the next timer programs the one after it */
+    t = start_ms(10);
+    start_ms(60);
+    lmtimer_stop(t);
+    waited = run_for(3000);
+    check("60 ms timer fired after stopping the 10 ms one", fired == 2);
+    check("60 ms timer not early", waited >= 50);
+    check("60 ms timer on time", waited <= 60 + SLACK_MS);
+
+    /* Restarting the next timer later */
+    t = start_ms(10);
+    lmtimer_start_ms(t, 40);
+    waited = run_for(3000);
+    check("restarted timer fired", fired == 3);
+    check("restarted timer not early", waited >= 30);
+
+    lmtimers_destroy();
+    if (errors) {
+        return (1);
+    }
+    printf("timers: all checks passed\n");
+    return (0);
+}